@@ -0,0 +1,583 @@
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "../src/codegen.hh"
+#include "../src/debug.hh"
+#include "../src/fsm.hh"
+#include "../src/generator.hh"
+#include "../src/pass.hh"
+#include "../src/sim.hh"
+#include "../src/stmt.hh"
+#include "../src/util.hh"
+
+using fmt::format;
+using namespace kratos;
+
+// a small self-contained benchmark driver. each benchmark builds its own
+// synthetic design and only the region between timer.start() and
+// timer.stop() is measured, so design construction can be excluded when it's
+// not what we are interested in
+
+namespace {
+
+class Timer {
+public:
+    void start() { start_ = std::chrono::steady_clock::now(); }
+    void stop() {
+        auto end = std::chrono::steady_clock::now();
+        elapsed_ += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+    }
+    [[nodiscard]] uint64_t elapsed_ns() const { return elapsed_; }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    uint64_t elapsed_ = 0;
+};
+
+struct Benchmark {
+    std::string name;
+    std::vector<uint32_t> sizes;
+    std::function<void(uint32_t, Timer &)> fn;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    uint32_t size;
+    uint32_t repetitions;
+    uint64_t min_ns;
+    uint64_t mean_ns;
+    uint64_t max_ns;
+};
+
+/*
+ * synthetic design builders
+ */
+
+// record a fake front-end location so the debug database has something to
+// store
+void set_debug_info(Generator &gen, const std::shared_ptr<Stmt> &stmt, bool debug) {
+    if (!debug) return;
+    gen.debug = true;
+    stmt->fn_name_ln.emplace_back("design.py", gen.stmts_count() + 1);
+}
+
+// processing element: acc <= acc + a * b, a and b are forwarded to the
+// neighbours
+Generator &pe(Context &c, uint32_t width, bool debug) {
+    auto &mod = c.generator("pe");
+    auto &clk = mod.port(PortDirection::In, "clk", 1, 1, PortType::Clock, false);
+    auto &rst = mod.port(PortDirection::In, "rst", 1, 1, PortType::AsyncReset, false);
+    auto &a_in = mod.port(PortDirection::In, "a_in", width);
+    auto &b_in = mod.port(PortDirection::In, "b_in", width);
+    auto &a_out = mod.port(PortDirection::Out, "a_out", width);
+    auto &b_out = mod.port(PortDirection::Out, "b_out", width);
+    auto &out = mod.port(PortDirection::Out, "out", width);
+    auto &acc = mod.var("acc", width);
+
+    auto seq = mod.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq->add_condition({BlockEdgeType::Posedge, rst.shared_from_this()});
+    auto if_ = std::make_shared<IfStmt>(rst);
+    if_->add_then_stmt(acc.assign(constant(0, width)));
+    if_->add_else_stmt(acc.assign(acc + a_in * b_in));
+    seq->add_stmt(if_);
+    set_debug_info(mod, seq, debug);
+
+    auto stmts = {a_out.assign(a_in), b_out.assign(b_in), out.assign(acc)};
+    for (auto const &stmt : stmts) {
+        mod.add_stmt(stmt);
+        set_debug_info(mod, stmt, debug);
+    }
+    return mod;
+}
+
+// rows x cols systolic array of identical PE instances
+Generator &pe_array(Context &c, uint32_t rows, uint32_t cols, bool debug = false) {
+    constexpr uint32_t width = 16;
+    auto &top = c.generator("pe_array");
+    auto &clk = top.port(PortDirection::In, "clk", 1, 1, PortType::Clock, false);
+    auto &rst = top.port(PortDirection::In, "rst", 1, 1, PortType::AsyncReset, false);
+    std::vector<std::vector<Generator *>> pes(rows, std::vector<Generator *>(cols));
+    for (uint32_t r = 0; r < rows; r++) {
+        for (uint32_t col = 0; col < cols; col++) {
+            auto &child = pe(c, width, debug);
+            top.add_child_generator(::format("pe_{0}_{1}", r, col), child);
+            top.add_stmt(child.get_port("clk")->assign(clk));
+            top.add_stmt(child.get_port("rst")->assign(rst));
+            pes[r][col] = &child;
+        }
+    }
+    for (uint32_t r = 0; r < rows; r++) {
+        auto &a = top.port(PortDirection::In, ::format("a_{0}", r), width);
+        auto &out = top.port(PortDirection::Out, ::format("out_{0}", r), width);
+        top.add_stmt(pes[r][0]->get_port("a_in")->assign(a));
+        top.add_stmt(out.assign(*pes[r][cols - 1]->get_port("out")));
+        for (uint32_t col = 1; col < cols; col++) {
+            auto &a_out = *pes[r][col - 1]->get_port("a_out");
+            top.add_stmt(pes[r][col]->get_port("a_in")->assign(a_out));
+        }
+    }
+    for (uint32_t col = 0; col < cols; col++) {
+        auto &b = top.port(PortDirection::In, ::format("b_{0}", col), width);
+        top.add_stmt(pes[0][col]->get_port("b_in")->assign(b));
+        for (uint32_t r = 1; r < rows; r++) {
+            auto &b_out = *pes[r - 1][col]->get_port("b_out");
+            top.add_stmt(pes[r][col]->get_port("b_in")->assign(b_out));
+        }
+    }
+    return top;
+}
+
+// adder of a given width
+Generator &adder(Context &c, const std::string &name, uint32_t width) {
+    auto &mod = c.generator(name);
+    auto &a = mod.port(PortDirection::In, "a", width);
+    auto &b = mod.port(PortDirection::In, "b", width);
+    auto &out = mod.port(PortDirection::Out, "out", width);
+    mod.add_stmt(out.assign(a + b));
+    return mod;
+}
+
+// n instances directly under the top. all children share the same name but
+// have different widths, which exercises the hashing and uniquification
+Generator &wide_hierarchy(Context &c, uint32_t n) {
+    auto &top = c.generator("top");
+    auto &in = top.port(PortDirection::In, "in", 16);
+    for (uint32_t i = 0; i < n; i++) {
+        auto width = i % 16 + 1;
+        auto &child = adder(c, "child", width);
+        top.add_child_generator(::format("child_{0}", i), child);
+        top.add_stmt(child.get_port("a")->assign(in[std::make_pair(width - 1, 0u)]));
+        top.add_stmt(child.get_port("b")->assign(in[std::make_pair(15u, 16 - width)]));
+        auto &out = top.port(PortDirection::Out, ::format("out_{0}", i), width);
+        top.add_stmt(out.assign(*child.get_port("out")));
+    }
+    return top;
+}
+
+// a chain of depth levels, each level wraps the next one
+Generator &deep_hierarchy(Context &c, uint32_t depth) {
+    constexpr uint32_t width = 8;
+    Generator *child = &adder(c, "leaf", width);
+    for (uint32_t i = 0; i < depth; i++) {
+        auto &mod = c.generator(::format("level_{0}", i));
+        auto &a = mod.port(PortDirection::In, "a", width);
+        auto &b = mod.port(PortDirection::In, "b", width);
+        auto &out = mod.port(PortDirection::Out, "out", width);
+        mod.add_child_generator("inst", *child);
+        mod.add_stmt(child->get_port("a")->assign(a));
+        mod.add_stmt(child->get_port("b")->assign(b ^ a));
+        mod.add_stmt(out.assign(*child->get_port("out") + b));
+        child = &mod;
+    }
+    return *child;
+}
+
+// fsm with num_states states
+Generator &large_fsm(Context &c, uint32_t num_states) {
+    auto width = std::max<uint32_t>(clog2(num_states), 1);
+    auto &mod = c.generator("fsm_top");
+    auto &in = mod.port(PortDirection::In, "in", width);
+    auto &out = mod.port(PortDirection::Out, "out", width);
+    mod.port(PortDirection::In, "clk", 1, 1, PortType::Clock, false);
+    mod.port(PortDirection::In, "rst", 1, 1, PortType::AsyncReset, false);
+
+    auto &fsm = mod.fsm("Machine");
+    fsm.output(out.shared_from_this());
+    std::vector<std::shared_ptr<FSMState>> states;
+    states.reserve(num_states);
+    for (uint32_t i = 0; i < num_states; i++) {
+        states.emplace_back(fsm.add_state(::format("S{0}", i)));
+    }
+    for (uint32_t i = 0; i < num_states; i++) {
+        auto &state = states[i];
+        state->next(states[(i + 1) % num_states], in.eq(constant(i, width)).shared_from_this());
+        state->next(states[(i * 7 + 3) % num_states],
+                    in.eq(constant((i + 1) % num_states, width)).shared_from_this());
+        state->output(out.shared_from_this(), constant(i, width).shared_from_this());
+    }
+    fsm.set_start_state(states[0]);
+    return mod;
+}
+
+// lanes x stages combinational datapath in a single module
+Generator &datapath(Context &c, uint32_t lanes, uint32_t stages) {
+    constexpr uint32_t width = 64;
+    auto &mod = c.generator("datapath");
+    auto &in = mod.port(PortDirection::In, "in", width);
+    auto &key = mod.port(PortDirection::In, "key", width);
+    auto comb = mod.combinational();
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        Var *prev = &in;
+        for (uint32_t stage = 0; stage < stages; stage++) {
+            auto &v = mod.var(::format("v_{0}_{1}", lane, stage), width);
+            auto &shift = constant((lane + stage) % 7 + 1, width);
+            comb->add_stmt(v.assign((*prev + key) ^ (*prev >> shift)));
+            prev = &v;
+        }
+        auto &out = mod.port(PortDirection::Out, ::format("out_{0}", lane), width);
+        mod.add_stmt(out.assign(*prev));
+    }
+    return mod;
+}
+
+/*
+ * pipelines
+ */
+
+void run_pass(const std::string &name, Generator *top) {
+    PassManager manager;
+    manager.register_builtin_passes();
+    manager.add_pass(name);
+    manager.run_passes(top);
+}
+
+// mirrors the default pipeline used by verilog() in the Python front-end
+const std::vector<std::string> &default_pipeline() {
+    static const std::vector<std::string> passes = {"realize_fsm",
+                                                    "remove_pass_through_modules",
+                                                    "merge_if_block",
+                                                    "transform_if_to_case",
+                                                    "zero_out_stubs",
+                                                    "remove_fanout_one_wires",
+                                                    "zero_generator_inputs",
+                                                    "change_port_bundle_struct",
+                                                    "verify_generator_connectivity",
+                                                    "merge_const_port_assignment",
+                                                    "decouple_generator_ports",
+                                                    "fix_assignment_type",
+                                                    "remove_unused_vars",
+                                                    "remove_unused_stmts",
+                                                    "verify_assignments",
+                                                    "check_combinational_loop",
+                                                    "check_mixed_assignment",
+                                                    "check_always_sensitivity",
+                                                    "check_inferred_latch",
+                                                    "check_active_high",
+                                                    "check_function_return",
+                                                    "merge_wire_assignments",
+                                                    "check_multiple_driver",
+                                                    "check_flip_flop_always_ff",
+                                                    "hash_generators_parallel",
+                                                    "change_property_into_stmt",
+                                                    "uniquify_generators",
+                                                    "create_module_instantiation",
+                                                    "create_interface_instantiation",
+                                                    "sort_stmts"};
+    return passes;
+}
+
+void run_pipeline(Generator *top) {
+    PassManager manager;
+    manager.register_builtin_passes();
+    for (auto const &name : default_pipeline()) manager.add_pass(name);
+    manager.run_passes(top);
+}
+
+// the design used for the per-pass benchmarks. it mixes every builder so
+// each pass has something to work on
+Generator &mixed_design(Context &c, uint32_t n) {
+    auto &top = pe_array(c, n, n);
+    auto &clk = *top.get_port("clk");
+    auto &rst = *top.get_port("rst");
+    auto &fsm = large_fsm(c, n * 4);
+    top.add_child_generator("fsm", fsm);
+    top.add_stmt(fsm.get_port("clk")->assign(clk));
+    top.add_stmt(fsm.get_port("rst")->assign(rst));
+    auto &fsm_in = top.port(PortDirection::In, "fsm_in", fsm.get_port("in")->width());
+    auto &fsm_out = top.port(PortDirection::Out, "fsm_out", fsm.get_port("out")->width());
+    top.add_stmt(fsm.get_port("in")->assign(fsm_in));
+    top.add_stmt(fsm_out.assign(*fsm.get_port("out")));
+    auto &wide = wide_hierarchy(c, n * 4);
+    top.add_child_generator("wide", wide);
+    auto &wide_in = top.port(PortDirection::In, "wide_in", 16);
+    top.add_stmt(wide.get_port("in")->assign(wide_in));
+    return top;
+}
+
+std::vector<Benchmark> create_benchmarks() {
+    std::vector<Benchmark> benchmarks;
+
+    // elaboration
+    benchmarks.push_back({"elaborate/pe_array", {8, 32, 64}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              timer.start();
+                              pe_array(c, n, n);
+                              timer.stop();
+                          }});
+    benchmarks.push_back({"elaborate/wide_hierarchy", {256, 4096}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              timer.start();
+                              wide_hierarchy(c, n);
+                              timer.stop();
+                          }});
+    benchmarks.push_back({"elaborate/deep_hierarchy", {64, 512}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              timer.start();
+                              deep_hierarchy(c, n);
+                              timer.stop();
+                          }});
+    benchmarks.push_back({"elaborate/fsm", {16, 256}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              timer.start();
+                              auto &mod = large_fsm(c, n);
+                              realize_fsm(&mod);
+                              timer.stop();
+                          }});
+    benchmarks.push_back({"elaborate/datapath", {16, 128}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              timer.start();
+                              datapath(c, n, 16);
+                              timer.stop();
+                          }});
+
+    // hashing and uniquification
+    for (auto const strategy : {HashStrategy::SequentialHash, HashStrategy::ParallelHash}) {
+        auto name = strategy == HashStrategy::SequentialHash ? "hash/sequential" : "hash/parallel";
+        benchmarks.push_back({name, {16, 64}, [strategy](uint32_t n, Timer &timer) {
+                                  Context c;
+                                  auto &top = pe_array(c, n, n);
+                                  timer.start();
+                                  hash_generators(&top, strategy);
+                                  timer.stop();
+                              }});
+    }
+    benchmarks.push_back({"uniquify/wide_hierarchy", {256, 4096}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              auto &top = wide_hierarchy(c, n);
+                              hash_generators_parallel(&top);
+                              timer.start();
+                              uniquify_generators(&top);
+                              timer.stop();
+                          }});
+
+    // each builtin pass in the default pipeline, timed individually on a
+    // design that has gone through every pass before it
+    auto const &pipeline = default_pipeline();
+    for (uint64_t i = 0; i < pipeline.size(); i++) {
+        benchmarks.push_back({"pass/" + pipeline[i], {8, 32}, [i](uint32_t n, Timer &timer) {
+                                  Context c;
+                                  auto &top = mixed_design(c, n);
+                                  auto const &passes = default_pipeline();
+                                  for (uint64_t j = 0; j < i; j++) run_pass(passes[j], &top);
+                                  timer.start();
+                                  run_pass(passes[i], &top);
+                                  timer.stop();
+                              }});
+    }
+    benchmarks.push_back({"pass/pipeline", {8, 32}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              auto &top = mixed_design(c, n);
+                              timer.start();
+                              run_pipeline(&top);
+                              timer.stop();
+                          }});
+
+    // codegen
+    benchmarks.push_back({"codegen/generate_verilog", {8, 32}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              auto &top = mixed_design(c, n);
+                              run_pipeline(&top);
+                              timer.start();
+                              generate_verilog(&top);
+                              timer.stop();
+                          }});
+
+    // debug database
+    benchmarks.push_back({"debug/save_database", {8, 32}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              auto &top = pe_array(c, n, n, true);
+                              run_pipeline(&top);
+                              auto filename =
+                                  fs::join(fs::temp_directory_path(), "kratos_bench.db");
+                              timer.start();
+                              inject_instance_ids(&top);
+                              inject_debug_break_points(&top);
+                              DebugDatabase db;
+                              db.set_break_points(&top);
+                              db.save_database(filename);
+                              timer.stop();
+                              fs::remove(filename);
+                          }});
+
+    // simulation
+    benchmarks.push_back({"sim/construct", {16, 128}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              auto &mod = datapath(c, n, 16);
+                              timer.start();
+                              Simulator sim(&mod);
+                              timer.stop();
+                          }});
+    benchmarks.push_back({"sim/eval", {16, 128}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              auto &mod = datapath(c, n, 16);
+                              auto *in = mod.get_port("in").get();
+                              auto *key = mod.get_port("key").get();
+                              Simulator sim(&mod);
+                              std::mt19937_64 rand(0);
+                              timer.start();
+                              for (uint32_t i = 0; i < 100; i++) {
+                                  sim.set(key, rand(), false);
+                                  sim.set(in, rand());
+                              }
+                              timer.stop();
+                          }});
+
+    // context teardown. n x n PEs are roughly 24 * n * n IR nodes, i.e. size 208 is about
+    // 1M nodes
+    benchmarks.push_back({"context/clear", {32, 128, 208}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              pe_array(c, n, n);
+                              timer.start();
+                              c.clear();
+                              timer.stop();
+                          }});
+    // the whole teardown, including the part done by the background thread
+    benchmarks.push_back({"context/reset", {32, 128, 208}, [](uint32_t n, Timer &timer) {
+                              Context c;
+                              pe_array(c, n, n);
+                              timer.start();
+                              c.reset();
+                              c.wait_reset();
+                              timer.stop();
+                          }});
+    // how long the caller is blocked before it can build the next design
+    benchmarks.push_back({"context/reset_latency", {32, 128, 208},
+                          [](uint32_t n, Timer &timer) {
+                              Context c;
+                              pe_array(c, n, n);
+                              timer.start();
+                              c.reset();
+                              timer.stop();
+                              c.wait_reset();
+                          }});
+
+    return benchmarks;
+}
+
+/*
+ * reporting
+ */
+
+void print_console(std::ostream &stream, const std::vector<BenchmarkResult> &results) {
+    stream << ::format("{0:<48} {1:>8} {2:>6} {3:>14} {4:>14} {5:>14}\n", "benchmark", "size",
+                       "reps", "min (ns)", "mean (ns)", "max (ns)");
+    for (auto const &r : results) {
+        stream << ::format("{0:<48} {1:>8} {2:>6} {3:>14} {4:>14} {5:>14}\n", r.name, r.size,
+                           r.repetitions, r.min_ns, r.mean_ns, r.max_ns);
+    }
+}
+
+void print_csv(std::ostream &stream, const std::vector<BenchmarkResult> &results) {
+    stream << "name,size,repetitions,min_ns,mean_ns,max_ns\n";
+    for (auto const &r : results) {
+        stream << ::format("{0},{1},{2},{3},{4},{5}\n", r.name, r.size, r.repetitions, r.min_ns,
+                           r.mean_ns, r.max_ns);
+    }
+}
+
+void print_json(std::ostream &stream, const std::vector<BenchmarkResult> &results) {
+    stream << "{\n  \"context\": {\"num_cpus\": " << get_num_cpus() << "},\n";
+    stream << "  \"benchmarks\": [";
+    for (uint64_t i = 0; i < results.size(); i++) {
+        auto const &r = results[i];
+        stream << (i ? ",\n" : "\n");
+        stream << ::format(
+            "    {{\"name\": \"{0}\", \"size\": {1}, \"repetitions\": {2}, \"min_ns\": {3}, "
+            "\"mean_ns\": {4}, \"max_ns\": {5}}}",
+            r.name, r.size, r.repetitions, r.min_ns, r.mean_ns, r.max_ns);
+    }
+    stream << "\n  ]\n}\n";
+}
+
+void print_usage(const char *exe) {
+    std::cerr << "Usage: " << exe
+              << " [--filter=<substring>] [--repetitions=<n>] [--max-size=<n>]"
+                 " [--format=console|csv|json] [--out=<filename>] [--list]"
+              << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    std::string filter;
+    std::string output_format = "console";
+    std::string out_filename;
+    uint32_t repetitions = 3;
+    uint32_t max_size = std::numeric_limits<uint32_t>::max();
+    bool list_only = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto pos = arg.find('=');
+        auto key = arg.substr(0, pos);
+        auto value = pos == std::string::npos ? "" : arg.substr(pos + 1);
+        if (key == "--filter") {
+            filter = value;
+        } else if (key == "--repetitions") {
+            repetitions = std::max(std::stoul(value), 1ul);
+        } else if (key == "--max-size") {
+            max_size = std::stoul(value);
+        } else if (key == "--format") {
+            output_format = value;
+        } else if (key == "--out") {
+            out_filename = value;
+        } else if (key == "--list") {
+            list_only = true;
+        } else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (output_format != "console" && output_format != "csv" && output_format != "json") {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<BenchmarkResult> results;
+    for (auto const &bench : create_benchmarks()) {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos) continue;
+        for (auto const size : bench.sizes) {
+            if (size > max_size) continue;
+            if (list_only) {
+                std::cout << bench.name << "/" << size << std::endl;
+                continue;
+            }
+            BenchmarkResult result{bench.name, size, repetitions,
+                                   std::numeric_limits<uint64_t>::max(), 0, 0};
+            uint64_t total = 0;
+            for (uint32_t rep = 0; rep < repetitions; rep++) {
+                Timer timer;
+                bench.fn(size, timer);
+                auto ns = timer.elapsed_ns();
+                total += ns;
+                result.min_ns = std::min(result.min_ns, ns);
+                result.max_ns = std::max(result.max_ns, ns);
+            }
+            result.mean_ns = total / repetitions;
+            results.emplace_back(result);
+            if (output_format != "console" || !out_filename.empty()) {
+                // progress goes to stderr so the report stays machine-readable
+                std::cerr << bench.name << "/" << size << ": " << result.mean_ns << " ns"
+                          << std::endl;
+            }
+        }
+    }
+    if (list_only) return EXIT_SUCCESS;
+
+    std::ofstream file;
+    if (!out_filename.empty()) file.open(out_filename);
+    std::ostream &stream = out_filename.empty() ? std::cout : file;
+    if (output_format == "csv")
+        print_csv(stream, results);
+    else if (output_format == "json")
+        print_json(stream, results);
+    else
+        print_console(stream, results);
+
+    return EXIT_SUCCESS;
+}
@@ -62,6 +62,7 @@ def dump_debug_database(generator: Generator, filename: str):
     # insert other metadata information
     db.set_stmt_context(generator.internal_generator)
     db.save_database(filename)
+    return db
 
 
 def dump_external_database(generators: List[Generator], top_name: str, filename: str):
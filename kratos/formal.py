@@ -1,4 +1,6 @@
 from _kratos.formal import remove_async_reset as _remove_async_reset
+from _kratos.formal import output_aiger as _output_aiger
+from _kratos.formal import output_blif as _output_blif
 from .passes import verilog
 import tempfile
 import os
@@ -37,3 +39,12 @@ def output_btor(generator, filename, remove_async_reset=True, yosys_path="",
         if quite:
             extra_args = ["-q"] + extra_args
         subprocess.check_call([yosys_path] + extra_args + [yosys_file])
+
+
+def output_aiger(generator, filename):
+    # bit-blasted by kratos directly, no yosys needed
+    _output_aiger(generator.internal_generator, os.path.abspath(filename))
+
+
+def output_blif(generator, filename):
+    _output_blif(generator.internal_generator, os.path.abspath(filename))
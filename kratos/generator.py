@@ -952,6 +952,29 @@ class Generator(metaclass=GeneratorMeta):
             g.__def_instance = gen
             return g
 
+    @classmethod
+    def specialize(cls, params: Dict[str, int] = None, **kargs):
+        """
+        Elaborate the generator once per distinct constructor arguments, which
+        determine the structure, and reuse it as a template. Parameter values
+        in params are only passed at instantiation, hence instances that differ
+        only in them share the same module definition
+        :param params: parameter values of the instance
+        :return: the template itself for the first instance, a shallow clone
+        otherwise
+        """
+        if params is None:
+            params = {}
+        gen, cached = cls.__cached_py_generator(**kargs)
+        if not cached:
+            for name, value in params.items():
+                gen.params[name].value = value
+            return gen
+        g = Generator("", internal_generator=gen.internal_generator.specialize(
+            params))
+        g.__def_instance = gen
+        return g
+
     @classmethod
     def create(cls, **kargs):
         # if the debug is set to True globally, we don't create any
@@ -2,7 +2,7 @@ from _kratos.passes import *
 from .generator import Generator
 import _kratos
 from .debug import dump_debug_database
-from typing import Dict
+from typing import Dict, List
 import os
 
 
@@ -41,7 +41,18 @@ def verilog(generator: Generator, optimize_if: bool = True,
             track_generated_definition: bool = False,
             contains_event: bool = False,
             lift_genvar_instances: bool = False,
-            compile_to_verilog: bool = False):
+            compile_to_verilog: bool = False,
+            incremental: bool = False,
+            verilator_public_debug_only: bool = False,
+            verilator_public_names: List[str] = None,
+            verilator_public_regex: str = "",
+            debug_breakpoint_bitmap: bool = False):
+    if verilator_public_debug_only and not debug_db_filename:
+        raise ValueError("verilator_public_debug_only requires debug_db_filename")
+    # incremental mode only re-processes the generators changed since the last
+    # call. IR changes made outside the generator APIs need
+    # generator.internal_generator.mark_dirty()
+    generator.internal_generator.context().incremental = incremental
     code_gen = _kratos.VerilogModule(generator.internal_generator)
     pass_manager = code_gen.pass_manager()
     if additional_passes is not None:
@@ -97,6 +108,8 @@ def verilog(generator: Generator, optimize_if: bool = True,
         pass_manager.add_pass("inject_instance_ids")
         pass_manager.add_pass("inject_debug_break_points")
         pass_manager.add_pass("inject_assert_fail_exception")
+        if debug_breakpoint_bitmap:
+            pass_manager.add_pass("inject_breakpoint_bitmap")
     if use_parallel:
         pass_manager.add_pass("hash_generators_parallel")
     else:
@@ -116,8 +129,9 @@ def verilog(generator: Generator, optimize_if: bool = True,
     code_gen.run_passes()
 
     # debug database
+    db = None
     if debug_db_filename:
-        dump_debug_database(generator, debug_db_filename)
+        db = dump_debug_database(generator, debug_db_filename)
 
     # notice the ordering. we need to keep events passes but we don't
     # won't them in the codegen
@@ -136,7 +150,19 @@ def verilog(generator: Generator, optimize_if: bool = True,
             "Compiling to verilog requires sv2v"
 
     if insert_verilator_info:
-        _kratos.passes.insert_verilator_public(generator.internal_generator)
+        if verilator_public_debug_only or verilator_public_names or \
+                verilator_public_regex:
+            # only the selected signals so that verilator can optimize
+            # the rest away
+            if not verilator_public_debug_only:
+                db = None
+            names = verilator_public_names if verilator_public_names else []
+            _kratos.passes.insert_verilator_public(generator.internal_generator,
+                                                   db, names,
+                                                   verilator_public_regex)
+        else:
+            _kratos.passes.insert_verilator_public(
+                generator.internal_generator)
 
     if output_dir is not None:
         if not os.path.isdir(output_dir):
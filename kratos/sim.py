@@ -1,4 +1,5 @@
 from _kratos import Simulator as _Simulator
+from _kratos import check_equivalence as _check_equivalence
 from .generator import Generator, PortType
 
 
@@ -43,3 +44,18 @@ class Simulator:
         else:
             self.set(self._reset, 0)
             self.set(self._reset, 1)
+
+    def count_toggles(self, enable=True):
+        self._sim.set_toggle_count(enable)
+
+    def toggle_count(self, var):
+        return self._sim.toggle_count(var)
+
+    def activity_profile(self):
+        return self._sim.activity_profile()
+
+
+def check_equivalence(reference: Generator, design: Generator, num_cycles=1000,
+                      seed=0):
+    return _check_equivalence(reference.internal_generator,
+                              design.internal_generator, num_cycles, seed)
@@ -4,6 +4,7 @@
 
 #include "../src/context.hh"
 #include "../src/generator.hh"
+#include "../src/stats.hh"
 
 namespace py = pybind11;
 
@@ -29,5 +30,20 @@ void init_context(py::module &m) {
         .def("enum", &Context::enum_, py::arg("enum_name"), py::arg("definition"),
              py::arg("width"), py::return_value_policy::reference)
         .def("has_enum", &Context::has_enum)
-        .def_property("track_generated", &Context::track_generated, &Context::set_track_generated);
+        .def_property("track_generated", &Context::track_generated, &Context::set_track_generated)
+        .def_property("incremental", &Context::incremental, &Context::set_incremental)
+        .def("memory_usage", [](Context &context) { return compute_memory_usage(&context); });
+
+    py::class_<MemoryUsage>(m, "MemoryUsage")
+        .def_readonly("count", &MemoryUsage::count)
+        .def_readonly("bytes", &MemoryUsage::bytes);
+
+    py::class_<MemoryReport>(m, "MemoryReport")
+        .def_readonly("node_kinds", &MemoryReport::node_kinds)
+        .def_readonly("generators", &MemoryReport::generators)
+        .def_readonly("modules", &MemoryReport::modules)
+        .def_readonly("total", &MemoryReport::total);
+
+    m.def("compute_memory_usage", py::overload_cast<Generator *>(&compute_memory_usage),
+          py::arg("top"));
 }
\ No newline at end of file
@@ -18,6 +18,13 @@ void init_debug(py::module &m) {
         .def("inject_clock_break_points",
              py::overload_cast<Generator *, const std::shared_ptr<Port> &>(
                  &inject_clock_break_points))
+        .def("inject_breakpoint_bitmap", py::overload_cast<Generator *>(&inject_breakpoint_bitmap))
+        .def("inject_breakpoint_bitmap",
+             py::overload_cast<Generator *, const std::string &>(&inject_breakpoint_bitmap))
+        .def("inject_breakpoint_bitmap",
+             py::overload_cast<Generator *, const std::shared_ptr<Port> &>(
+                 &inject_breakpoint_bitmap))
+        .def("extract_breakpoint_bitmap", &extract_breakpoint_bitmap)
         .def("inject_assert_fail_exception", &inject_assert_fail_exception)
         .def("inject_instance_ids", &inject_instance_ids)
         .def("mock_hierarchy", &mock_hierarchy);
@@ -11,4 +11,6 @@ void init_formal(py::module &main_m) {
     using namespace kratos;
     auto formal = main_m.def_submodule("formal");
     formal.def("remove_async_reset", &remove_async_reset);
+    formal.def("output_aiger", &output_aiger);
+    formal.def("output_blif", &output_blif);
 }
\ No newline at end of file
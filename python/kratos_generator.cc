@@ -177,12 +177,21 @@ void init_generator(py::module &m) {
              py::return_value_policy::reference)
         .def("enum", &Generator::enum_, py::return_value_policy::reference)
         .def("enum_var", &Generator::enum_var, py::return_value_policy::reference)
-        .def("get_params", &Generator::get_params)
+        .def("get_params",
+             [](const Generator &generator) {
+                 auto const &params = generator.get_params();
+                 return std::map<std::string, std::shared_ptr<Param>>(params.begin(),
+                                                                      params.end());
+             })
         .def("get_param", &Generator::get_param)
         .def("get_port", &Generator::get_port, py::return_value_policy::reference)
         .def("get_var", &Generator::get_var, py::return_value_policy::reference)
         .def("get_port_names", &Generator::get_port_names)
-        .def("vars", &Generator::vars)
+        .def("vars",
+             [](const Generator &generator) {
+                 auto const &vars = generator.vars();
+                 return std::map<std::string, std::shared_ptr<Var>>(vars.begin(), vars.end());
+             })
         .def("has_var", &Generator::has_var)
         .def("has_port", &Generator::has_port)
         .def("add_stmt", &Generator::add_stmt)
@@ -232,6 +241,8 @@ void init_generator(py::module &m) {
              })
         .def("get_unique_variable_name", &Generator::get_unique_variable_name)
         .def("context", &Generator::context, py::return_value_policy::reference)
+        .def("mark_dirty", &Generator::mark_dirty)
+        .def("is_dirty", [](const Generator &gen) { return gen.is_dirty(); })
         .def_property(
             "instance_name", [](Generator &m) { return m.instance_name; },
             [](Generator &m, const std::string &name) {
@@ -250,6 +261,7 @@ void init_generator(py::module &m) {
             })
         .def_readwrite("debug", &Generator::debug)
         .def("clone", &Generator::clone)
+        .def("specialize", &Generator::specialize, py::arg("values"))
         .def_property("is_cloned", &Generator::is_cloned, &Generator::set_is_cloned)
         .def("__contains__",
              py::overload_cast<const std::shared_ptr<Generator> &>(&Generator::has_child_generator))
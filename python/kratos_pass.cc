@@ -7,7 +7,9 @@
 #include "../src/expr.hh"
 #include "../src/generator.hh"
 #include "../src/pass.hh"
+#include "../src/sim.hh"
 #include "../src/stmt.hh"
+#include "../src/timing.hh"
 #include "kratos_expr.hh"
 
 namespace py = pybind11;
@@ -53,7 +55,11 @@ void init_pass(py::module &m) {
         .def("extract_dpi_function", &extract_dpi_function)
         .def("extract_interface_info", &extract_interface_info)
         .def("extract_debug_break_points", &extract_debug_break_points)
-        .def("insert_verilator_public", &insert_verilator_public)
+        .def("insert_verilator_public", py::overload_cast<Generator *>(&insert_verilator_public))
+        .def("insert_verilator_public",
+             py::overload_cast<Generator *, const DebugDatabase *, const std::vector<std::string> &,
+                               const std::string &>(&insert_verilator_public),
+             py::arg("top"), py::arg("db"), py::arg("names"), py::arg("pattern") = "")
         .def("remove_assertion", &remove_assertion)
         .def("check_inferred_latch", &check_inferred_latch)
         .def("check_multiple_driver", &check_multiple_driver)
@@ -64,7 +70,12 @@ void init_pass(py::module &m) {
         .def("find_driver_signal", &find_driver_signal)
         .def("extract_register_names", &extract_register_names)
         .def("extract_var_names", &extract_var_names)
-        .def("auto_insert_clock_enable", &auto_insert_clock_enable)
+        .def("auto_insert_clock_enable",
+             py::overload_cast<Generator *>(&auto_insert_clock_enable))
+        .def("auto_insert_clock_enable",
+             py::overload_cast<Generator *, const ActivityProfile &, double>(
+                 &auto_insert_clock_enable),
+             py::arg("top"), py::arg("profile"), py::arg("threshold"))
         .def("auto_insert_sync_reset", &auto_insert_sync_reset)
         .def("change_property_into_stmt", &change_property_into_stmt)
         .def("remove_event_stmts", &remove_event_stmts);
@@ -160,6 +171,47 @@ by yourself to obtain the verilog code.)pbdoc");
     py::implicitly_convertible<Attribute, PyAttribute>();
 
     m.def("create_stub", &create_stub);
+
+    // timing analysis
+    py::class_<DelayModel>(pass_m, "DelayModel")
+        .def(py::init<>())
+        .def_readwrite("gate", &DelayModel::gate)
+        .def_readwrite("mux", &DelayModel::mux)
+        .def_readwrite("arithmetic", &DelayModel::arithmetic)
+        .def_readwrite("clock_to_q", &DelayModel::clock_to_q)
+        .def_readwrite("setup", &DelayModel::setup);
+
+    py::class_<PathDelay>(pass_m, "PathDelay")
+        .def_readonly("levels", &PathDelay::levels)
+        .def_readonly("delay", &PathDelay::delay);
+
+    py::enum_<TimingPathType>(pass_m, "TimingPathType")
+        .value("RegToReg", TimingPathType::RegToReg)
+        .value("InToReg", TimingPathType::InToReg)
+        .value("RegToOut", TimingPathType::RegToOut)
+        .value("InToOut", TimingPathType::InToOut);
+
+    py::class_<TimingPoint>(pass_m, "TimingPoint")
+        .def_readonly("name", &TimingPoint::name)
+        .def_readonly("fn_name_ln", &TimingPoint::fn_name_ln);
+
+    py::class_<TimingPath>(pass_m, "TimingPath")
+        .def_readonly("type", &TimingPath::type)
+        .def_readonly("delay", &TimingPath::delay)
+        .def_readonly("points", &TimingPath::points);
+
+    py::class_<TimingSummary>(pass_m, "TimingSummary")
+        .def_readonly("in_to_out", &TimingSummary::in_to_out)
+        .def_readonly("in_to_reg", &TimingSummary::in_to_reg)
+        .def_readonly("reg_to_out", &TimingSummary::reg_to_out);
+
+    py::class_<TimingReport>(pass_m, "TimingReport")
+        .def_readonly("paths", &TimingReport::paths)
+        .def_readonly("summaries", &TimingReport::summaries)
+        .def("__str__", &TimingReport::to_string);
+
+    pass_m.def("analyze_timing", &analyze_timing, py::arg("top"), py::arg("num_paths") = 10,
+               py::arg("model") = DelayModel{});
 }
 
 template <typename T>
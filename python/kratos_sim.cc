@@ -9,6 +9,38 @@ namespace py = pybind11;
 // simulator module
 void init_simulator(py::module &m) {
     using namespace kratos;
+    py::class_<ToggleActivity>(m, "ToggleActivity")
+        .def_readonly("toggles", &ToggleActivity::toggles)
+        .def_readonly("bits", &ToggleActivity::bits)
+        .def_readonly("activity", &ToggleActivity::activity);
+
+    py::class_<RegisterGroupActivity>(m, "RegisterGroupActivity")
+        .def_readonly("generator", &RegisterGroupActivity::generator)
+        .def_readonly("registers", &RegisterGroupActivity::registers)
+        .def_readonly("activity", &RegisterGroupActivity::activity);
+
+    py::class_<ActivityProfile>(m, "ActivityProfile")
+        .def_readonly("cycles", &ActivityProfile::cycles)
+        .def_readonly("signals", &ActivityProfile::signals)
+        .def_readonly("generators", &ActivityProfile::generators)
+        .def_readonly("register_groups", &ActivityProfile::register_groups);
+
+    py::class_<EquivalenceMismatch>(m, "EquivalenceMismatch")
+        .def_readonly("cycle", &EquivalenceMismatch::cycle)
+        .def_readonly("port", &EquivalenceMismatch::port)
+        .def_readonly("expected", &EquivalenceMismatch::expected)
+        .def_readonly("actual", &EquivalenceMismatch::actual)
+        .def_readonly("inputs", &EquivalenceMismatch::inputs);
+
+    py::class_<EquivalenceResult>(m, "EquivalenceResult")
+        .def_readonly("cycles", &EquivalenceResult::cycles)
+        .def_readonly("mismatch", &EquivalenceResult::mismatch)
+        .def("equivalent", &EquivalenceResult::equivalent)
+        .def("__repr__", &EquivalenceResult::to_string);
+
+    m.def("check_equivalence", &check_equivalence, py::arg("reference"), py::arg("design"),
+          py::arg("num_cycles") = 1000, py::arg("seed") = 0);
+
     py::class_<Simulator>(m, "Simulator")
         .def(py::init<Generator *>())
         .def("set", py::overload_cast<Var *, std::optional<uint64_t>, bool>(&Simulator::set))
@@ -25,5 +57,10 @@ void init_simulator(py::module &m) {
         .def("set", [](Simulator &sim, Var *var,
                        const std::optional<std::vector<int64_t>> &v) { sim.set_i(var, v); })
         .def("get", &Simulator::get)
-        .def("get_array", &Simulator::get_array);
+        .def("get_array", &Simulator::get_array)
+        .def("set_toggle_count", &Simulator::set_toggle_count)
+        .def("reset_toggle_count", &Simulator::reset_toggle_count)
+        .def("toggle_count", &Simulator::toggle_count)
+        .def("num_cycles", &Simulator::num_cycles)
+        .def("activity_profile", &Simulator::activity_profile);
 }
\ No newline at end of file
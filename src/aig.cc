@@ -0,0 +1,1055 @@
+#include "aig.hh"
+
+#include "except.hh"
+#include "fmt/format.h"
+#include "stmt.hh"
+#include "visitor.hh"
+
+using fmt::format;
+
+namespace kratos {
+
+AIG::Lit AIG::add_node(NodeType type) {
+    nodes_.emplace_back(Node{type});
+    return static_cast<Lit>(nodes_.size()) * 2;
+}
+
+AIG::Lit AIG::add_input(const std::string &name) {
+    auto lit = add_node(NodeType::Input);
+    inputs_.emplace_back(lit / 2, name);
+    return lit;
+}
+
+AIG::Lit AIG::add_latch(const std::string &name) {
+    auto lit = add_node(NodeType::Latch);
+    nodes_.back().left = lit;
+    latches_.emplace_back(lit / 2, name);
+    return lit;
+}
+
+void AIG::set_latch_next(Lit latch, Lit next) {
+    auto &node = nodes_.at(latch / 2 - 1);
+    if (node.type != NodeType::Latch) throw InternalException("Literal is not a latch");
+    node.left = next;
+}
+
+void AIG::add_output(const std::string &name, Lit lit) { outputs_.emplace_back(name, lit); }
+
+AIG::Lit AIG::and_(Lit a, Lit b) {
+    if (a > b) std::swap(a, b);
+    if (a == false_lit || a == negate(b)) return false_lit;
+    if (a == true_lit || a == b) return b;
+    auto key = (static_cast<uint64_t>(a) << 32u) | b;
+    auto iter = and_table_.find(key);
+    if (iter != and_table_.end()) return iter->second;
+    auto lit = add_node(NodeType::And);
+    nodes_.back().left = a;
+    nodes_.back().right = b;
+    and_table_.emplace(key, lit);
+    return lit;
+}
+
+AIG::Lit AIG::xor_(Lit a, Lit b) {
+    return or_(and_(a, negate(b)), and_(negate(a), b));
+}
+
+AIG::Lit AIG::mux(Lit sel, Lit a, Lit b) {
+    if (a == b) return a;
+    return or_(and_(sel, a), and_(negate(sel), b));
+}
+
+std::unordered_map<std::string, bool> AIG::evaluate(
+    const std::unordered_map<std::string, bool> &inputs, std::vector<bool> &latches) const {
+    // indexed by node, 0 stays the constant
+    std::vector<bool> values(nodes_.size() + 1, false);
+    for (auto const &[node, name] : inputs_) {
+        auto iter = inputs.find(name);
+        values[node] = iter != inputs.end() && iter->second;
+    }
+    latches.resize(latches_.size(), false);
+    for (uint64_t i = 0; i < latches_.size(); i++) values[latches_[i].first] = latches[i];
+    auto value = [&values](Lit lit) { return values[lit / 2] != static_cast<bool>(lit & 1u); };
+    // and gates are created after their operands
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+        auto const &node = nodes_[i];
+        if (node.type == NodeType::And) values[i + 1] = value(node.left) && value(node.right);
+    }
+    std::unordered_map<std::string, bool> result;
+    for (auto const &[name, lit] : outputs_) result.emplace(name, value(lit));
+    for (uint64_t i = 0; i < latches_.size(); i++) {
+        latches[i] = value(nodes_[latches_[i].first - 1].left);
+    }
+    return result;
+}
+
+std::vector<uint32_t> AIG::aiger_order() const {
+    // indexed by node, 0 stays the constant
+    std::vector<uint32_t> result(nodes_.size() + 1, 0);
+    uint32_t index = 1;
+    for (auto const &iter : inputs_) result[iter.first] = index++;
+    for (auto const &iter : latches_) result[iter.first] = index++;
+    // and gates are created after their operands
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+        if (nodes_[i].type == NodeType::And) result[i + 1] = index++;
+    }
+    return result;
+}
+
+namespace {
+void write_number(std::ostream &stream, uint32_t value) {
+    while (value & ~0x7Fu) {
+        stream.put(static_cast<char>((value & 0x7Fu) | 0x80u));
+        value >>= 7u;
+    }
+    stream.put(static_cast<char>(value));
+}
+}  // namespace
+
+void AIG::write_aiger(std::ostream &stream) const {
+    auto order = aiger_order();
+    auto map = [&order](Lit lit) { return order[lit / 2] * 2 + (lit & 1u); };
+    stream << ::format("aig {0} {1} {2} {3} {4}\n", nodes_.size(), inputs_.size(),
+                       latches_.size(), outputs_.size(), and_table_.size());
+    for (auto const &[node, name] : latches_) stream << map(nodes_[node - 1].left) << '\n';
+    for (auto const &[name, lit] : outputs_) stream << map(lit) << '\n';
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+        auto const &node = nodes_[i];
+        if (node.type != NodeType::And) continue;
+        auto lhs = order[i + 1] * 2;
+        auto rhs0 = map(node.left);
+        auto rhs1 = map(node.right);
+        if (rhs0 < rhs1) std::swap(rhs0, rhs1);
+        write_number(stream, lhs - rhs0);
+        write_number(stream, rhs0 - rhs1);
+    }
+    for (uint64_t i = 0; i < inputs_.size(); i++) {
+        stream << ::format("i{0} {1}\n", i, inputs_[i].second);
+    }
+    for (uint64_t i = 0; i < latches_.size(); i++) {
+        stream << ::format("l{0} {1}\n", i, latches_[i].second);
+    }
+    for (uint64_t i = 0; i < outputs_.size(); i++) {
+        stream << ::format("o{0} {1}\n", i, outputs_[i].first);
+    }
+    stream << "c\ngenerated by kratos\n";
+}
+
+void AIG::write_blif(std::ostream &stream, const std::string &model_name) const {
+    std::vector<std::string> names(nodes_.size() + 1);
+    names[0] = "$false";
+    for (auto const &[node, name] : inputs_) names[node] = name;
+    for (auto const &[node, name] : latches_) names[node] = name;
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+        if (nodes_[i].type == NodeType::And) names[i + 1] = ::format("$n{0}", i + 1);
+    }
+    auto polarity = [](Lit lit) { return lit & 1u ? '0' : '1'; };
+    // buffer or inverter
+    auto assign = [&](const std::string &name, Lit lit) {
+        stream << ::format(".names {0} {1}\n{2} 1\n", names[lit / 2], name, polarity(lit));
+    };
+
+    stream << ".model " << model_name << '\n';
+    stream << ".inputs";
+    for (auto const &iter : inputs_) stream << ' ' << iter.second;
+    stream << "\n.outputs";
+    for (auto const &iter : outputs_) stream << ' ' << iter.first;
+    stream << "\n.names $false\n";
+    for (auto const &[node, name] : latches_) {
+        stream << ::format(".latch {0}$next {0} 0\n", name);
+    }
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+        auto const &node = nodes_[i];
+        if (node.type != NodeType::And) continue;
+        stream << ::format(".names {0} {1} {2}\n{3}{4} 1\n", names[node.left / 2],
+                           names[node.right / 2], names[i + 1], polarity(node.left),
+                           polarity(node.right));
+    }
+    for (auto const &[node, name] : latches_) assign(name + "$next", nodes_[node - 1].left);
+    for (auto const &[name, lit] : outputs_) {
+        // registered outputs share the name with the latch
+        if (names[lit / 2] == name && !(lit & 1u)) continue;
+        assign(name, lit);
+    }
+    stream << ".end\n";
+}
+
+namespace {
+using Bits = std::vector<AIG::Lit>;
+// values of the root vars assigned so far inside a procedural block
+using Env = std::unordered_map<const Var *, Bits>;
+
+// root vars the value depends on
+void collect_reads(const Var *var, std::unordered_set<const Var *> &result) {
+    switch (var->type()) {
+        case VarType::Base:
+        case VarType::PortIO: {
+            result.emplace(var);
+            return;
+        }
+        case VarType::Slice: {
+            auto const *slice = static_cast<const VarSlice *>(var);
+            if (slice->sliced_by_var()) {
+                collect_reads(static_cast<const VarVarSlice *>(slice)->sliced_var(), result);
+            }
+            collect_reads(slice->parent_var, result);
+            return;
+        }
+        case VarType::BaseCasted: {
+            auto *casted = const_cast<VarCasted *>(static_cast<const VarCasted *>(var));
+            collect_reads(casted->parent_var(), result);
+            return;
+        }
+        case VarType::Expression: {
+            auto const *expr = static_cast<const Expr *>(var);
+            if (expr->op == ExprOp::Concat) {
+                for (auto const *v : static_cast<const VarConcat *>(expr)->vars()) {
+                    collect_reads(v, result);
+                }
+                return;
+            }
+            if (expr->op == ExprOp::Extend) {
+                collect_reads(static_cast<const VarExtend *>(expr)->parent_var(), result);
+                return;
+            }
+            if (expr->op == ExprOp::Conditional) {
+                collect_reads(static_cast<const ConditionalExpr *>(expr)->condition, result);
+            }
+            collect_reads(expr->left, result);
+            if (expr->right) collect_reads(expr->right, result);
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+// an assignment inside an always_comb block, with everything it reads including the
+// indices of the lhs and the conditions of the enclosing branches
+struct CombAssign {
+    Stmt *stmt;
+    const Var *root;
+    std::unordered_set<const Var *> reads;
+};
+
+void collect_assigns(Stmt *stmt, const std::unordered_set<const Var *> &conditions,
+                     std::vector<CombAssign> &result) {
+    switch (stmt->type()) {
+        case StatementType::Assign: {
+            auto *assign = static_cast<AssignStmt *>(stmt);
+            CombAssign entry{stmt, assign->left()->get_var_root_parent(), conditions};
+            collect_reads(assign->right(), entry.reads);
+            const Var *lhs = assign->left();
+            while (lhs->type() == VarType::Slice) {
+                auto const *slice = static_cast<const VarSlice *>(lhs);
+                if (slice->sliced_by_var()) {
+                    collect_reads(static_cast<const VarVarSlice *>(slice)->sliced_var(),
+                                  entry.reads);
+                }
+                lhs = slice->parent_var;
+            }
+            result.emplace_back(std::move(entry));
+            break;
+        }
+        case StatementType::Block: {
+            auto *block = static_cast<StmtBlock *>(stmt);
+            for (auto const &child : *block) collect_assigns(child.get(), conditions, result);
+            break;
+        }
+        case StatementType::If: {
+            auto *if_ = static_cast<IfStmt *>(stmt);
+            auto reads = conditions;
+            collect_reads(if_->predicate().get(), reads);
+            collect_assigns(if_->then_body().get(), reads, result);
+            collect_assigns(if_->else_body().get(), reads, result);
+            break;
+        }
+        case StatementType::Switch: {
+            auto *switch_ = static_cast<SwitchStmt *>(stmt);
+            auto reads = conditions;
+            collect_reads(switch_->target().get(), reads);
+            for (auto const &iter : switch_->body()) {
+                collect_assigns(iter.second.get(), reads, result);
+            }
+            break;
+        }
+        case StatementType::For: {
+            collect_assigns(static_cast<ForStmt *>(stmt)->get_loop_body().get(), conditions,
+                            result);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+class RegisterVisitor : public StmtVisitor<RegisterVisitor> {
+public:
+    void visit(AssignStmt *stmt) { registers.emplace_back(stmt->left()->get_var_root_parent()); }
+
+    std::vector<Var *> registers;
+};
+
+struct Scope {
+    Generator *instance;
+    Generator *definition;
+    Scope *parent;
+    // prefix of the names
+    std::string path;
+    std::unordered_map<const Generator *, std::unique_ptr<Scope>> children;
+    // indexed by the root vars of the definition
+    std::unordered_map<const Var *, Bits> values;
+    std::unordered_set<const Var *> evaluating;
+    // values of the vars assigned in the always_comb blocks
+    std::unordered_map<const Stmt *, Env> comb_values;
+    std::unordered_map<const Stmt *, std::unordered_set<const Var *>> comb_evaluating;
+    std::vector<SequentialStmtBlock *> seq_blocks;
+};
+
+class BitBlaster {
+public:
+    explicit BitBlaster(Generator *top) {
+        top_ = build_scope(top, nullptr, "");
+        for (auto const &port_name : top->get_port_names()) {
+            auto port = top->get_port(port_name);
+            if (port->port_direction() != PortDirection::In) continue;
+            Bits bits;
+            for (uint32_t i = 0; i < port->width(); i++) {
+                bits.emplace_back(aig_.add_input(bit_name(top_.get(), port.get(), i)));
+            }
+            top_->values.emplace(port.get(), bits);
+        }
+        add_latches(top_.get());
+        set_next_states(top_.get());
+        for (auto const &port_name : top->get_port_names()) {
+            auto port = top->get_port(port_name);
+            if (port->port_direction() != PortDirection::Out) continue;
+            auto const &bits = net(top_.get(), port.get());
+            for (uint32_t i = 0; i < bits.size(); i++) {
+                aig_.add_output(bit_name(top_.get(), port.get(), i), bits[i]);
+            }
+        }
+    }
+
+    AIG &aig() { return aig_; }
+
+private:
+    AIG aig_;
+    std::unique_ptr<Scope> top_;
+    std::unordered_map<const Var *, Bits> iters_;
+    std::unordered_map<const StmtBlock *, std::vector<CombAssign>> comb_assigns_;
+
+    std::unique_ptr<Scope> build_scope(Generator *instance, Scope *parent,
+                                       const std::string &path) {
+        auto scope = std::make_unique<Scope>();
+        scope->instance = instance;
+        scope->definition =
+            instance->is_cloned() && instance->def_instance() ? instance->def_instance() : instance;
+        scope->parent = parent;
+        scope->path = path;
+        auto *definition = scope->definition;
+        if (definition->external() || definition->is_stub())
+            throw GeneratorException(
+                ::format("Unable to bit-blast external module {0}", definition->name),
+                {definition});
+        for (auto const &child : definition->get_child_generators()) {
+            scope->children.emplace(
+                child.get(),
+                build_scope(child.get(), scope.get(), path + child->instance_name + "."));
+        }
+        for (uint64_t i = 0; i < definition->stmts_count(); i++) {
+            auto stmt = definition->get_stmt(i);
+            if (stmt->type() != StatementType::Block) continue;
+            auto block_type = stmt->as<StmtBlock>()->block_type();
+            if (block_type == StatementBlockType::Sequential) {
+                scope->seq_blocks.emplace_back(stmt->as<SequentialStmtBlock>().get());
+            } else if (block_type == StatementBlockType::Latch) {
+                throw StmtException("Latches are not supported in bit-blasting", {stmt.get()});
+            }
+        }
+        return scope;
+    }
+
+    static std::string bit_name(const Scope *scope, const Var *var, uint32_t bit) {
+        if (var->width() == 1) return scope->path + var->name;
+        return ::format("{0}{1}[{2}]", scope->path, var->name, bit);
+    }
+
+    void add_latches(Scope *scope) {
+        for (auto *block : scope->seq_blocks) {
+            RegisterVisitor visitor;
+            visitor.visit_stmt(block);
+            for (auto *var : visitor.registers) {
+                if (scope->values.find(var) != scope->values.end()) continue;
+                Bits bits;
+                for (uint32_t i = 0; i < var->width(); i++) {
+                    bits.emplace_back(aig_.add_latch(bit_name(scope, var, i)));
+                }
+                scope->values.emplace(var, bits);
+            }
+        }
+        for (auto const &iter : scope->children) add_latches(iter.second.get());
+    }
+
+    void set_next_states(Scope *scope) {
+        for (auto *block : scope->seq_blocks) {
+            Env env;
+            execute(scope, block, env, true);
+            for (auto const &[var, bits] : env) {
+                auto const &latches = scope->values.at(var);
+                for (uint32_t i = 0; i < bits.size(); i++) aig_.set_latch_next(latches[i], bits[i]);
+            }
+        }
+        for (auto const &iter : scope->children) set_next_states(iter.second.get());
+    }
+
+    // the scope that owns the root var, and the var in its definition
+    std::pair<Scope *, const Var *> resolve(Scope *scope, const Var *var) {
+        auto const *generator = var->generator();
+        if (generator == scope->definition || generator == scope->instance) return {scope, var};
+        auto iter = scope->children.find(generator);
+        if (iter != scope->children.end()) {
+            auto *child = iter->second.get();
+            if (child->definition != generator) {
+                var = child->definition->get_port(var->name).get();
+            }
+            return {child, var};
+        }
+        auto *parent = scope->parent;
+        if (parent && (generator == parent->definition || generator == parent->instance)) {
+            return {parent, var};
+        }
+        throw VarException(::format("Unable to find the scope of {0}", var->to_string()),
+                           {const_cast<Var *>(var)});
+    }
+
+    // value of a root var outside any procedural block
+    const Bits &net(Scope *scope, const Var *var) {
+        auto iter = scope->values.find(var);
+        if (iter != scope->values.end()) return iter->second;
+        if (scope->evaluating.find(var) != scope->evaluating.end()) {
+            throw VarException(::format("Combinational loop through {0}", var->to_string()),
+                               {const_cast<Var *>(var)});
+        }
+        scope->evaluating.emplace(var);
+
+        Bits bits(var->width(), AIG::false_lit);
+        std::vector<bool> driven(var->width(), false);
+        // input ports are driven by the parent
+        auto *source_scope = scope;
+        auto const *source_var = var;
+        if (var->type() == VarType::PortIO && scope->parent &&
+            static_cast<const Port *>(var)->port_direction() == PortDirection::In) {
+            source_scope = scope->parent;
+            source_var = scope->instance->get_port(var->name).get();
+        }
+        for (auto const &stmt : source_var->sources()) {
+            auto *parent = stmt->parent();
+            if (!parent) continue;
+            if (parent->ir_node_kind() == IRNodeKind::GeneratorKind) {
+                auto value = eval(source_scope, stmt->right(), nullptr);
+                write(source_scope, stmt->left(), value, nullptr, bits, &driven);
+                continue;
+            }
+            // find the procedural block
+            while (parent->parent() &&
+                   parent->parent()->ir_node_kind() != IRNodeKind::GeneratorKind) {
+                parent = parent->parent();
+            }
+            auto *block = dynamic_cast<StmtBlock *>(parent);
+            if (!block || block->block_type() == StatementBlockType::Sequential) continue;
+            if (block->block_type() != StatementBlockType::Combinational)
+                throw StmtException("Only always_comb and always_ff blocks can be bit-blasted",
+                                    {block});
+            auto const *value = comb(source_scope, block, source_var);
+            if (!value) continue;
+            bits = *value;
+            std::fill(driven.begin(), driven.end(), true);
+        }
+        for (uint32_t i = 0; i < bits.size(); i++) {
+            if (!driven[i]) bits[i] = aig_.add_input(bit_name(scope, var, i));
+        }
+
+        scope->evaluating.erase(var);
+        return scope->values.emplace(var, bits).first->second;
+    }
+
+    // value of a root var assigned in the always_comb block, or null if it's never assigned.
+    // only the statements the var depends on are executed, so the other vars of the block
+    // can feed back into it through the logic outside of the block
+    const Bits *comb(Scope *scope, StmtBlock *block, const Var *var) {
+        auto &values = scope->comb_values[block];
+        auto iter = values.find(var);
+        if (iter != values.end()) return &iter->second;
+        auto &evaluating = scope->comb_evaluating[block];
+        if (evaluating.find(var) != evaluating.end()) {
+            throw StmtException("Combinational loop through always_comb block", {block});
+        }
+        auto live = live_stmts(block, var);
+        evaluating.emplace(var);
+        Env env;
+        execute(scope, block, env, false, &live);
+        evaluating.erase(var);
+        // the vars it depends on are complete as well
+        for (auto &[v, bits] : env) values.emplace(v, std::move(bits));
+        iter = values.find(var);
+        return iter != values.end() ? &iter->second : nullptr;
+    }
+
+    // the statements that lead to the assignments of the var or the vars of the block it reads
+    std::unordered_set<const Stmt *> live_stmts(StmtBlock *block, const Var *var) {
+        auto iter = comb_assigns_.find(block);
+        if (iter == comb_assigns_.end()) {
+            iter = comb_assigns_.emplace(block, std::vector<CombAssign>{}).first;
+            collect_assigns(block, {}, iter->second);
+        }
+        auto const &assigns = iter->second;
+        std::unordered_set<const Var *> assigned, needed = {var};
+        for (auto const &assign : assigns) assigned.emplace(assign.root);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto const &assign : assigns) {
+                if (needed.find(assign.root) == needed.end()) continue;
+                for (auto const *read : assign.reads) {
+                    if (assigned.find(read) != assigned.end() && needed.emplace(read).second) {
+                        changed = true;
+                    }
+                }
+            }
+        }
+        std::unordered_set<const Stmt *> result = {block};
+        for (auto const &assign : assigns) {
+            if (needed.find(assign.root) == needed.end()) continue;
+            IRNode *node = assign.stmt;
+            while (node && node != block && result.emplace(static_cast<Stmt *>(node)).second) {
+                node = node->parent();
+            }
+        }
+        return result;
+    }
+
+    // value of the var before any assignment in the block. registers hold their value,
+    // while the values of the combinational vars are undefined, i.e. inferred latches
+    Bits initial_value(Scope *scope, const Var *var, bool sequential) {
+        if (sequential) return net(scope, var);
+        return Bits(var->width(), AIG::false_lit);
+    }
+
+    void execute(Scope *scope, Stmt *stmt, Env &env, bool sequential,
+                 const std::unordered_set<const Stmt *> *live = nullptr) {
+        if (live && live->find(stmt) == live->end()) return;
+        // non-blocking assignments are only visible in the next cycle
+        auto const *reads = sequential ? nullptr : &env;
+        switch (stmt->type()) {
+            case StatementType::Assign: {
+                auto *assign = static_cast<AssignStmt *>(stmt);
+                auto value = eval(scope, assign->right(), reads);
+                auto const *root = assign->left()->get_var_root_parent();
+                auto iter = env.find(root);
+                if (iter == env.end()) {
+                    iter = env.emplace(root, initial_value(scope, root, sequential)).first;
+                }
+                write(scope, assign->left(), value, reads, iter->second, nullptr);
+                break;
+            }
+            case StatementType::Block: {
+                auto *block = static_cast<StmtBlock *>(stmt);
+                for (uint64_t i = 0; i < block->size(); i++) {
+                    execute(scope, block->get_stmt(i).get(), env, sequential, live);
+                }
+                break;
+            }
+            case StatementType::If: {
+                auto *if_ = static_cast<IfStmt *>(stmt);
+                auto cond = reduce_or(eval(scope, if_->predicate().get(), reads));
+                auto then_env = env;
+                execute(scope, if_->then_body().get(), then_env, sequential, live);
+                execute(scope, if_->else_body().get(), env, sequential, live);
+                merge(scope, cond, then_env, env, sequential);
+                break;
+            }
+            case StatementType::Switch: {
+                auto *switch_ = static_cast<SwitchStmt *>(stmt);
+                auto target = eval(scope, switch_->target().get(), reads);
+                std::vector<std::pair<Const *, ScopedStmtBlock *>> cases;
+                for (auto const &[cond, body] : switch_->body()) {
+                    cases.emplace_back(cond.get(), body.get());
+                }
+                execute_cases(scope, target, cases, 0, env, sequential, live);
+                break;
+            }
+            case StatementType::For: {
+                auto *for_ = static_cast<ForStmt *>(stmt);
+                auto const *iter = for_->get_iter_var().get();
+                auto step = for_->step();
+                if (step == 0) throw StmtException("Loop step cannot be zero", {stmt});
+                for (auto i = for_->start(); step > 0 ? i < for_->end() : i > for_->end();
+                     i += step) {
+                    iters_[iter] = constant_bits(i, iter->width());
+                    execute(scope, for_->get_loop_body().get(), env, sequential, live);
+                }
+                iters_.erase(iter);
+                break;
+            }
+            case StatementType::Comment:
+            case StatementType::Assert:
+            case StatementType::Auxiliary:
+                break;
+            default:
+                throw StmtException("Statement not supported in bit-blasting", {stmt});
+        }
+    }
+
+    void execute_cases(Scope *scope, const Bits &target,
+                       const std::vector<std::pair<Const *, ScopedStmtBlock *>> &cases,
+                       uint64_t index, Env &env, bool sequential,
+                       const std::unordered_set<const Stmt *> *live) {
+        // default is stored as null, which comes first
+        if (index == cases.size()) {
+            if (!cases.empty() && !cases[0].first) {
+                execute(scope, cases[0].second, env, sequential, live);
+            }
+            return;
+        }
+        auto const &[cond, body] = cases[index];
+        if (!cond) {
+            execute_cases(scope, target, cases, index + 1, env, sequential, live);
+            return;
+        }
+        auto match = equal(target, constant_bits(cond->value(), target.size()));
+        auto then_env = env;
+        execute(scope, body, then_env, sequential, live);
+        execute_cases(scope, target, cases, index + 1, env, sequential, live);
+        merge(scope, match, then_env, env, sequential);
+    }
+
+    // env = cond ? then_env : env
+    void merge(Scope *scope, AIG::Lit cond, const Env &then_env, Env &env, bool sequential) {
+        for (auto const &[var, then_bits] : then_env) {
+            auto iter = env.find(var);
+            if (iter == env.end()) {
+                iter = env.emplace(var, initial_value(scope, var, sequential)).first;
+            }
+            auto &bits = iter->second;
+            for (uint32_t i = 0; i < bits.size(); i++) {
+                bits[i] = aig_.mux(cond, then_bits[i], bits[i]);
+            }
+        }
+        for (auto &[var, bits] : env) {
+            if (then_env.find(var) != then_env.end()) continue;
+            auto initial = initial_value(scope, var, sequential);
+            for (uint32_t i = 0; i < bits.size(); i++) {
+                bits[i] = aig_.mux(cond, initial[i], bits[i]);
+            }
+        }
+    }
+
+    // bit offset of the slice inside its parent
+    static uint32_t slice_offset(const VarSlice *slice) {
+        auto const *parent = slice->parent_var;
+        if (parent->size().size() == 1 && parent->size().front() == 1) {
+            return parent->explicit_array() ? 0 : slice->low;
+        }
+        uint32_t base_width = parent->var_width();
+        for (uint64_t i = 1; i < parent->size().size(); i++) base_width *= parent->size()[i];
+        return slice->low * base_width;
+    }
+
+    // number of elements a var slice selects from
+    static uint32_t num_elements(const VarSlice *slice) {
+        auto const *parent = slice->parent_var;
+        if (parent->size().size() == 1 && parent->size().front() == 1) {
+            return parent->explicit_array() ? 1 : parent->width();
+        }
+        return parent->size().front();
+    }
+
+    // where the lhs is inside its root var, guarded by the conditions of the var slices
+    void targets(Scope *scope, const Var *var, const Env *env,
+                 std::vector<std::pair<AIG::Lit, uint32_t>> &result) {
+        if (var->type() == VarType::BaseCasted) {
+            auto *casted = const_cast<VarCasted *>(static_cast<const VarCasted *>(var));
+            targets(scope, casted->parent_var(), env, result);
+            return;
+        }
+        if (var->type() != VarType::Slice) {
+            result.emplace_back(AIG::true_lit, 0);
+            return;
+        }
+        auto const *slice = static_cast<const VarSlice *>(var);
+        std::vector<std::pair<AIG::Lit, uint32_t>> parents;
+        targets(scope, slice->parent_var, env, parents);
+        if (!slice->sliced_by_var()) {
+            auto offset = slice_offset(slice);
+            for (auto const &[guard, base] : parents) result.emplace_back(guard, base + offset);
+            return;
+        }
+        auto index = eval(scope, static_cast<const VarVarSlice *>(slice)->sliced_var(), env);
+        auto count = num_elements(slice);
+        for (auto const &[guard, base] : parents) {
+            for (uint32_t i = 0; i < count; i++) {
+                auto sel = aig_.and_(guard, equal(index, constant_bits(i, index.size())));
+                if (sel != AIG::false_lit) result.emplace_back(sel, base + i * slice->width());
+            }
+        }
+    }
+
+    void write(Scope *scope, const Var *lhs, const Bits &value, const Env *env, Bits &bits,
+               std::vector<bool> *driven) {
+        std::vector<std::pair<AIG::Lit, uint32_t>> options;
+        targets(scope, lhs, env, options);
+        auto resized = resize(value, lhs->width(), false);
+        for (auto const &[guard, base] : options) {
+            for (uint32_t i = 0; i < resized.size() && base + i < bits.size(); i++) {
+                bits[base + i] = aig_.mux(guard, resized[i], bits[base + i]);
+                if (driven) (*driven)[base + i] = true;
+            }
+        }
+    }
+
+    Bits eval(Scope *scope, const Var *var, const Env *env) {
+        switch (var->type()) {
+            case VarType::ConstValue:
+            case VarType::Parameter: {
+                auto const *const_ = static_cast<const Const *>(var);
+                if (const_->is_bignum())
+                    throw VarException("Big number not supported in bit-blasting",
+                                       {const_cast<Var *>(var)});
+                return constant_bits(const_->value(), var->width());
+            }
+            case VarType::Iter: {
+                return iters_.at(var);
+            }
+            case VarType::Base:
+            case VarType::PortIO: {
+                if (var->is_function() || var->is_interface())
+                    throw VarException(
+                        ::format("{0} not supported in bit-blasting", var->to_string()),
+                        {const_cast<Var *>(var)});
+                if (env) {
+                    auto iter = env->find(var);
+                    if (iter != env->end()) return iter->second;
+                }
+                auto [owner, root] = resolve(scope, var);
+                return net(owner, root);
+            }
+            case VarType::Slice: {
+                auto const *slice = static_cast<const VarSlice *>(var);
+                auto parent = eval(scope, slice->parent_var, env);
+                auto width = var->width();
+                if (!slice->sliced_by_var()) {
+                    auto offset = slice_offset(slice);
+                    return {parent.begin() + offset, parent.begin() + offset + width};
+                }
+                auto const *index_var = static_cast<const VarVarSlice *>(slice)->sliced_var();
+                auto index = eval(scope, index_var, env);
+                Bits result(width, AIG::false_lit);
+                for (uint32_t i = 0; i < num_elements(slice); i++) {
+                    auto sel = equal(index, constant_bits(i, index.size()));
+                    for (uint32_t j = 0; j < width && i * width + j < parent.size(); j++) {
+                        result[j] = aig_.mux(sel, parent[i * width + j], result[j]);
+                    }
+                }
+                return result;
+            }
+            case VarType::BaseCasted: {
+                auto *parent =
+                    const_cast<VarCasted *>(static_cast<const VarCasted *>(var))->parent_var();
+                return resize(eval(scope, parent, env), var->width(), parent->is_signed());
+            }
+            case VarType::Expression: {
+                return eval_expr(scope, static_cast<const Expr *>(var), env);
+            }
+        }
+        return {};
+    }
+
+    Bits eval_expr(Scope *scope, const Expr *expr, const Env *env) {
+        auto width = expr->width();
+        if (expr->op == ExprOp::Concat) {
+            auto const &vars = static_cast<const VarConcat *>(expr)->vars();
+            Bits result;
+            // the first var is the most significant
+            for (auto iter = vars.rbegin(); iter != vars.rend(); iter++) {
+                auto bits = eval(scope, *iter, env);
+                result.insert(result.end(), bits.begin(), bits.end());
+            }
+            return result;
+        }
+        if (expr->op == ExprOp::Extend) {
+            auto const *parent = static_cast<const VarExtend *>(expr)->parent_var();
+            return resize(eval(scope, parent, env), width, parent->is_signed());
+        }
+        if (expr->op == ExprOp::Conditional) {
+            auto cond = reduce_or(
+                eval(scope, static_cast<const ConditionalExpr *>(expr)->condition, env));
+            auto left = operand(scope, expr->left, width, env);
+            auto right = operand(scope, expr->right, width, env);
+            for (uint32_t i = 0; i < width; i++) left[i] = aig_.mux(cond, left[i], right[i]);
+            return left;
+        }
+
+        auto left_bits = eval(scope, expr->left, env);
+        switch (expr->op) {
+            case ExprOp::UInvert: {
+                auto result = resize(left_bits, width, expr->left->is_signed());
+                for (auto &bit : result) bit = AIG::negate(bit);
+                return result;
+            }
+            case ExprOp::UMinus:
+                return negative(resize(left_bits, width, expr->left->is_signed()));
+            case ExprOp::UPlus:
+                return resize(left_bits, width, expr->left->is_signed());
+            case ExprOp::UNot:
+                return resize({AIG::negate(reduce_or(left_bits))}, width, false);
+            case ExprOp::UOr:
+                return resize({reduce_or(left_bits)}, width, false);
+            case ExprOp::UAnd: {
+                auto result = AIG::true_lit;
+                for (auto bit : left_bits) result = aig_.and_(result, bit);
+                return resize({result}, width, false);
+            }
+            case ExprOp::UXor: {
+                auto result = AIG::false_lit;
+                for (auto bit : left_bits) result = aig_.xor_(result, bit);
+                return resize({result}, width, false);
+            }
+            default:
+                break;
+        }
+
+        auto right_bits = eval(scope, expr->right, env);
+        auto is_signed = expr->left->is_signed() && expr->right->is_signed();
+        switch (expr->op) {
+            case ExprOp::LAnd:
+                return resize({aig_.and_(reduce_or(left_bits), reduce_or(right_bits))}, width,
+                              false);
+            case ExprOp::LOr:
+                return resize({aig_.or_(reduce_or(left_bits), reduce_or(right_bits))}, width,
+                              false);
+            case ExprOp::Eq:
+            case ExprOp::Neq:
+            case ExprOp::LessThan:
+            case ExprOp::GreaterThan:
+            case ExprOp::LessEqThan:
+            case ExprOp::GreaterEqThan: {
+                auto operand_width = static_cast<uint32_t>(
+                    std::max(left_bits.size(), right_bits.size()));
+                auto a = resize(left_bits, operand_width, is_signed);
+                auto b = resize(right_bits, operand_width, is_signed);
+                AIG::Lit result;
+                if (expr->op == ExprOp::Eq) {
+                    result = equal(a, b);
+                } else if (expr->op == ExprOp::Neq) {
+                    result = AIG::negate(equal(a, b));
+                } else if (expr->op == ExprOp::LessThan) {
+                    result = less_than(a, b, is_signed);
+                } else if (expr->op == ExprOp::GreaterThan) {
+                    result = less_than(b, a, is_signed);
+                } else if (expr->op == ExprOp::LessEqThan) {
+                    result = AIG::negate(less_than(b, a, is_signed));
+                } else {
+                    result = AIG::negate(less_than(a, b, is_signed));
+                }
+                return resize({result}, width, false);
+            }
+            case ExprOp::LogicalShiftRight:
+            case ExprOp::SignedShiftRight:
+            case ExprOp::ShiftLeft: {
+                auto value = resize(left_bits, width, expr->left->is_signed());
+                auto fill = expr->op == ExprOp::SignedShiftRight && expr->left->is_signed()
+                                ? value.back()
+                                : AIG::false_lit;
+                return shift(value, right_bits, expr->op == ExprOp::ShiftLeft, fill);
+            }
+            default:
+                break;
+        }
+
+        auto a = resize(left_bits, width, expr->left->is_signed());
+        auto b = resize(right_bits, width, expr->right->is_signed());
+        Bits result(width);
+        switch (expr->op) {
+            case ExprOp::And:
+            case ExprOp::Or:
+            case ExprOp::Xor: {
+                for (uint32_t i = 0; i < width; i++) {
+                    result[i] = expr->op == ExprOp::And  ? aig_.and_(a[i], b[i])
+                                : expr->op == ExprOp::Or ? aig_.or_(a[i], b[i])
+                                                         : aig_.xor_(a[i], b[i]);
+                }
+                return result;
+            }
+            case ExprOp::Add:
+                return add(a, b, AIG::false_lit);
+            case ExprOp::Minus:
+                return subtract(a, b);
+            case ExprOp::Multiply:
+                return multiply(a, b);
+            case ExprOp::Divide:
+            case ExprOp::Mod:
+                return divide(a, b, is_signed, expr->op == ExprOp::Mod);
+            case ExprOp::Power: {
+                if (expr->right->type() != VarType::ConstValue &&
+                    expr->right->type() != VarType::Parameter)
+                    throw VarException("Only constant exponents can be bit-blasted",
+                                       {const_cast<Expr *>(expr)});
+                auto exponent = static_cast<const Const *>(expr->right)->value();
+                result = constant_bits(1, width);
+                for (int64_t i = 0; i < exponent; i++) result = multiply(result, a);
+                return result;
+            }
+            default:
+                throw VarException(::format("{0} not supported in bit-blasting", expr->to_string()),
+                                   {const_cast<Expr *>(expr)});
+        }
+    }
+
+    Bits operand(Scope *scope, const Var *var, uint32_t width, const Env *env) {
+        return resize(eval(scope, var, env), width, var->is_signed());
+    }
+
+    static Bits constant_bits(int64_t value, uint64_t width) {
+        Bits result(width);
+        for (uint64_t i = 0; i < width; i++) {
+            bool bit = i < 64 ? (static_cast<uint64_t>(value) >> i) & 1u : value < 0;
+            result[i] = bit ? AIG::true_lit : AIG::false_lit;
+        }
+        return result;
+    }
+
+    static Bits resize(const Bits &bits, uint32_t width, bool is_signed) {
+        Bits result(bits.begin(), bits.begin() + std::min<uint64_t>(bits.size(), width));
+        auto fill = is_signed && !bits.empty() ? bits.back() : AIG::false_lit;
+        result.resize(width, fill);
+        return result;
+    }
+
+    AIG::Lit reduce_or(const Bits &bits) {
+        auto result = AIG::false_lit;
+        for (auto bit : bits) result = aig_.or_(result, bit);
+        return result;
+    }
+
+    AIG::Lit equal(const Bits &a, const Bits &b) {
+        auto result = AIG::true_lit;
+        for (uint32_t i = 0; i < a.size(); i++) {
+            result = aig_.and_(result, AIG::negate(aig_.xor_(a[i], b[i])));
+        }
+        return result;
+    }
+
+    // ripple carry
+    Bits add(const Bits &a, const Bits &b, AIG::Lit carry, AIG::Lit *carry_out = nullptr) {
+        Bits result(a.size());
+        for (uint32_t i = 0; i < a.size(); i++) {
+            auto half = aig_.xor_(a[i], b[i]);
+            result[i] = aig_.xor_(half, carry);
+            carry = aig_.or_(aig_.and_(a[i], b[i]), aig_.and_(half, carry));
+        }
+        if (carry_out) *carry_out = carry;
+        return result;
+    }
+
+    Bits invert(const Bits &bits) {
+        Bits result(bits.size());
+        for (uint32_t i = 0; i < bits.size(); i++) result[i] = AIG::negate(bits[i]);
+        return result;
+    }
+
+    Bits subtract(const Bits &a, const Bits &b, AIG::Lit *carry_out = nullptr) {
+        return add(a, invert(b), AIG::true_lit, carry_out);
+    }
+
+    Bits negative(const Bits &bits) {
+        return subtract(Bits(bits.size(), AIG::false_lit), bits);
+    }
+
+    AIG::Lit less_than(Bits a, Bits b, bool is_signed) {
+        if (a.empty()) return AIG::false_lit;
+        if (is_signed) {
+            // flipping the sign bits turns it into an unsigned comparison
+            a.back() = AIG::negate(a.back());
+            b.back() = AIG::negate(b.back());
+        }
+        // a < b iff a - b borrows
+        AIG::Lit carry;
+        subtract(a, b, &carry);
+        return AIG::negate(carry);
+    }
+
+    // truncated to the width of the operands
+    Bits multiply(const Bits &a, const Bits &b) {
+        Bits result(a.size(), AIG::false_lit);
+        for (uint32_t i = 0; i < b.size(); i++) {
+            Bits partial(a.size(), AIG::false_lit);
+            for (uint32_t j = 0; i + j < a.size(); j++) partial[i + j] = aig_.and_(a[j], b[i]);
+            result = add(result, partial, AIG::false_lit);
+        }
+        return result;
+    }
+
+    // restoring division
+    Bits divide(const Bits &a, const Bits &b, bool is_signed, bool remainder) {
+        auto width = static_cast<uint32_t>(a.size());
+        if (width == 0) return {};
+        auto dividend = a;
+        auto divisor = b;
+        if (is_signed) {
+            dividend = select(a.back(), negative(a), a);
+            divisor = select(b.back(), negative(b), b);
+        }
+        Bits quotient(width, AIG::false_lit);
+        Bits rest(width, AIG::false_lit);
+        for (uint32_t i = width; i > 0; i--) {
+            // rest = (rest << 1) | dividend[i - 1]
+            rest.insert(rest.begin(), dividend[i - 1]);
+            auto overflow = rest.back();
+            rest.pop_back();
+            AIG::Lit carry;
+            auto diff = subtract(rest, divisor, &carry);
+            // no borrow, or the shifted out bit makes it larger anyway
+            auto fits = aig_.or_(carry, overflow);
+            quotient[i - 1] = fits;
+            rest = select(fits, diff, rest);
+        }
+        if (is_signed) {
+            quotient = select(aig_.xor_(a.back(), b.back()), negative(quotient), quotient);
+            rest = select(a.back(), negative(rest), rest);
+        }
+        return remainder ? rest : quotient;
+    }
+
+    Bits select(AIG::Lit sel, const Bits &a, const Bits &b) {
+        Bits result(a.size());
+        for (uint32_t i = 0; i < a.size(); i++) result[i] = aig_.mux(sel, a[i], b[i]);
+        return result;
+    }
+
+    // barrel shifter
+    Bits shift(Bits value, const Bits &amount, bool left, AIG::Lit fill) {
+        auto width = value.size();
+        for (uint64_t k = 0; k < amount.size(); k++) {
+            auto distance = k < 32 ? (uint64_t(1) << k) : width;
+            Bits shifted(width, fill);
+            if (left) {
+                for (uint64_t i = distance; i < width; i++) shifted[i] = value[i - distance];
+                for (uint64_t i = 0; i < std::min(distance, width); i++) {
+                    shifted[i] = AIG::false_lit;
+                }
+            } else {
+                for (uint64_t i = 0; i + distance < width; i++) shifted[i] = value[i + distance];
+            }
+            value = select(amount[k], shifted, value);
+        }
+        return value;
+    }
+};
+}  // namespace
+
+AIG bit_blast(Generator *top) {
+    BitBlaster blaster(top);
+    return std::move(blaster.aig());
+}
+
+}  // namespace kratos
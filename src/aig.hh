@@ -0,0 +1,73 @@
+#ifndef KRATOS_AIG_HH
+#define KRATOS_AIG_HH
+
+#include <ostream>
+
+#include "generator.hh"
+
+namespace kratos {
+
+// and-inverter graph with structural hashing. literals follow the AIGER convention, i.e.
+// 2 * node + negated, where node 0 is the constant false
+class AIG {
+public:
+    using Lit = uint32_t;
+    static constexpr Lit false_lit = 0;
+    static constexpr Lit true_lit = 1;
+    static Lit negate(Lit lit) { return lit ^ 1u; }
+
+    Lit add_input(const std::string &name);
+    // latches start at zero and hold their value until the next state is set
+    Lit add_latch(const std::string &name);
+    void set_latch_next(Lit latch, Lit next);
+    void add_output(const std::string &name, Lit lit);
+
+    Lit and_(Lit a, Lit b);
+    Lit or_(Lit a, Lit b) { return negate(and_(negate(a), negate(b))); }
+    Lit xor_(Lit a, Lit b);
+    // sel ? a : b
+    Lit mux(Lit sel, Lit a, Lit b);
+
+    [[nodiscard]] uint64_t num_inputs() const { return inputs_.size(); }
+    [[nodiscard]] uint64_t num_latches() const { return latches_.size(); }
+    [[nodiscard]] uint64_t num_outputs() const { return outputs_.size(); }
+    [[nodiscard]] uint64_t num_ands() const { return and_table_.size(); }
+
+    // one clock cycle. the inputs missing from the map are false. the latches hold the current
+    // states in the order they were added and are updated to the next states
+    [[nodiscard]] std::unordered_map<std::string, bool> evaluate(
+        const std::unordered_map<std::string, bool> &inputs, std::vector<bool> &latches) const;
+
+    // binary AIGER, with the symbol table
+    void write_aiger(std::ostream &stream) const;
+    void write_blif(std::ostream &stream, const std::string &model_name) const;
+
+private:
+    enum class NodeType { Input, Latch, And };
+    struct Node {
+        NodeType type;
+        // operands of and gates, or the next state of latches
+        Lit left = false_lit;
+        Lit right = false_lit;
+    };
+    // node i + 1
+    std::vector<Node> nodes_;
+    std::vector<std::pair<uint32_t, std::string>> inputs_;
+    std::vector<std::pair<uint32_t, std::string>> latches_;
+    std::vector<std::pair<std::string, Lit>> outputs_;
+    std::unordered_map<uint64_t, Lit> and_table_;
+
+    Lit add_node(NodeType type);
+    // AIGER requires the inputs first, then the latches and the and gates
+    std::vector<uint32_t> aiger_order() const;
+};
+
+// lowers the design into a single AIG. the hierarchy is flattened, every always_ff block
+// is clocked by the same implicit clock, async resets are treated as synchronous and
+// undriven signals become free inputs. the top level ports keep their names, suffixed
+// by the bit index if they are wider than one bit
+AIG bit_blast(Generator *top);
+
+}  // namespace kratos
+
+#endif  // KRATOS_AIG_HH
@@ -1166,77 +1166,99 @@ std::string create_stub(Generator* top) {
 
 class InterfaceVisitor : public IRVisitor {
 public:
+    struct InterfaceEntry {
+        Generator* gen;
+        const InterfaceRef* ref;
+        uint64_t hash;
+    };
+    using InterfaceMap = std::unordered_map<std::string, InterfaceEntry>;
+
     void visit(Generator* generator) override {
+        // everything is collected locally without any lock; definitions are only compared
+        // through their precomputed hashes. the local result is merged in the end
+        InterfaceMap interfaces;
         // local variables
         uint64_t stmt_count = generator->stmts_count();
         for (uint64_t i = 0; i < stmt_count; i++) {
             auto stmt = generator->get_stmt(i);
             if (stmt->type() == StatementType::InterfaceInstantiation) {
-                visit(stmt->as<InterfaceInstantiationStmt>().get());
+                auto const* inst = reinterpret_cast<InterfaceInstantiationStmt*>(stmt.get());
+                update_interface_definition(interfaces, {generator, inst->interface(), 0});
             }
         }
         // ports as well
-        std::set<const InterfaceRef*> refs;
         for (auto const& port_name : generator->get_port_names()) {
             auto p = generator->get_port(port_name);
             if (p->is_interface()) {
                 auto interface_p = p->as<InterfacePort>();
-                const auto* ref = interface_p->interface();
-                auto def = ref->definition();
-                update_interface_definition(def, ref, generator);
+                update_interface_definition(interfaces, {generator, interface_p->interface(), 0});
             }
         }
-    }
+        if (interfaces.empty()) return;
 
-    void visit(InterfaceInstantiationStmt* stmt) override {
-        auto def = stmt->interface()->definition();
-        update_interface_definition(def, stmt->interface(), stmt->generator_parent());
+        lock_.lock();
+        local_interfaces_.emplace_back(std::move(interfaces));
+        lock_.unlock();
     }
 
-    const std::unordered_map<std::string, std::pair<Generator*, const InterfaceRef*>>& interfaces()
-        const {
+    // not thread-safe. should only be called after the visitor is done
+    const std::unordered_map<std::string, std::pair<Generator*, const InterfaceRef*>>&
+    interfaces() {
+        InterfaceMap merged;
+        for (auto const& interfaces : local_interfaces_) {
+            for (auto const& iter : interfaces) {
+                update_interface_definition(merged, iter.second);
+            }
+        }
+        local_interfaces_.clear();
+        for (auto const& [def_name, entry] : merged) {
+            interfaces_.emplace(def_name, std::make_pair(entry.gen, entry.ref));
+        }
         return interfaces_;
     }
 
 private:
     std::unordered_map<std::string, std::pair<Generator*, const InterfaceRef*>> interfaces_;
+    std::vector<InterfaceMap> local_interfaces_;
     std::mutex lock_;
 
-    void update_interface_definition(const std::shared_ptr<IDefinition>& def,
-                                     const InterfaceRef* ref, Generator* gen) {
-        lock_.lock();
-        if (interfaces_.find(def->def_name()) == interfaces_.end()) {
-            interfaces_.emplace(def->def_name(), std::make_pair(gen, ref));
-            lock_.unlock();
-        } else {
-            // making sure they are the same
-            auto const& [reg_gen, ref_interface] = interfaces_.at(def->def_name());
-            auto ref_def = ref_interface->definition();
-            lock_.unlock();
-            auto const& ports = def->ports();
-            if (ref_def->ports() != ports)
-                throw UserException(::format("{0}.{1}'s interface differs from {2}.{3}'s",
-                                             gen->handle_name(), def->def_name(),
-                                             reg_gen->handle_name(), ref_def->def_name()));
-            for (auto const& port_name : ports) {
-                if (def->port(port_name) != ref_def->port(port_name))
-                    throw UserException(::format("{0}.{1}'s interface differs from {2}.{3}'s",
-                                                 gen->handle_name(), def->def_name(),
-                                                 reg_gen->handle_name(), ref_def->def_name()));
-            }
-            // same var as well
-            auto const& vars = def->vars();
-            if (ref_def->vars() != vars)
-                throw UserException(::format("{0}.{1}'s interface differs from {2}.{3}'s",
-                                             gen->handle_name(), def->def_name(),
-                                             reg_gen->handle_name(), ref_def->def_name()));
-            for (auto const& port_name : vars) {
-                if (def->var(port_name) != ref_def->var(port_name))
-                    throw UserException(::format("{0}.{1}'s interface differs from {2}.{3}'s",
-                                                 gen->handle_name(), def->def_name(),
-                                                 reg_gen->handle_name(), ref_def->def_name()));
-            }
+    static void update_interface_definition(InterfaceMap& interfaces, InterfaceEntry entry) {
+        auto const& def = entry.ref->definition();
+        if (!entry.hash) entry.hash = def->hash();
+        auto def_name = def->def_name();
+        auto iter = interfaces.find(def_name);
+        if (iter == interfaces.end()) {
+            interfaces.emplace(def_name, entry);
+        } else if (iter->second.ref->definition() != def) {
+            check_interface_definition(iter->second, entry);
+        }
+    }
+
+    static void check_interface_definition(const InterfaceEntry& ref_entry,
+                                           const InterfaceEntry& entry) {
+        auto const& def = entry.ref->definition();
+        auto const& ref_def = ref_entry.ref->definition();
+        // different signatures are rejected right away. matching ones still need the
+        // structural comparison in case of a hash collision
+        if (ref_entry.hash != entry.hash || !same_definition(*ref_def, *def))
+            throw UserException(::format("{0}.{1}'s interface differs from {2}.{3}'s",
+                                         entry.gen->handle_name(), def->def_name(),
+                                         ref_entry.gen->handle_name(), ref_def->def_name()));
+    }
+
+    static bool same_definition(const IDefinition& ref_def, const IDefinition& def) {
+        auto const& ports = def.ports();
+        if (ref_def.ports() != ports) return false;
+        for (auto const& port_name : ports) {
+            if (def.port(port_name) != ref_def.port(port_name)) return false;
+        }
+        // same var as well
+        auto const& vars = def.vars();
+        if (ref_def.vars() != vars) return false;
+        for (auto const& var_name : vars) {
+            if (def.var(var_name) != ref_def.var(var_name)) return false;
         }
+        return true;
     }
 };
 
@@ -1409,10 +1431,8 @@ void fix_verilog_ln(Generator* generator, uint32_t offset) {
     if (!generator->debug) return;
     // fix the variable declaration
     generator->verilog_ln += offset;
-    auto const& var_names = generator->get_all_var_names();
-    for (auto const& var_name : var_names) {
-        auto var = generator->get_var(var_name);
-        var->verilog_ln += offset;
+    for (auto const& iter : generator->vars()) {
+        iter.second->verilog_ln += offset;
     }
     // get all the statement graph
     StatementGraph graph(generator);
@@ -1,8 +1,12 @@
 #include "context.hh"
 
+#include <atomic>
+
 #include "except.hh"
+#include "expr.hh"
 #include "fmt/format.h"
 #include "generator.hh"
+#include "graph.hh"
 
 using fmt::format;
 using std::runtime_error;
@@ -10,6 +14,13 @@ using std::string;
 
 namespace kratos {
 
+namespace {
+// constants are shared by all contexts, so they can only be released by the last one
+std::atomic<uint64_t> num_contexts = 0;
+}  // namespace
+
+Context::Context() { num_contexts++; }
+
 Generator &Context::generator(const std::string &name) {
     auto const &p = std::make_shared<Generator>(this, name);
     modules_[name].emplace(p);
@@ -35,6 +46,7 @@ void Context::remove(Generator *generator) {
     //  2. remove itself from the parent
     auto const &shared_ptr = generator->shared_from_this();
     if (module_set.find(shared_ptr) != module_set.end()) module_set.erase(shared_ptr);
+    invalidate_hierarchy(generator);
 }
 
 void Context::add_hash(const Generator *generator, uint64_t hash) {
@@ -73,12 +85,16 @@ void Context::change_generator_name(Generator *generator, const std::string &new
         throw UserException(::format("unable to find generator {0} in context", old_name));
     // we need to erase it
     list.erase(pos);
+    // the parents instantiate it by name
+    bool renamed = old_name != new_name;
     // change it's name and put it to a new list
     generator->name = new_name;
     modules_[new_name].emplace(shared_ptr);
+    if (renamed) generator->mark_dirty();
     // change the cloned names as well
     for (const auto &g : generator->get_clones()) {
         g->name = new_name;
+        if (renamed) g->mark_dirty();
     }
 }
 
@@ -129,7 +145,88 @@ bool Context::is_generated_tracked(Generator *gen) const {
     return tracked_generators_.find(gen) != tracked_generators_.end();
 }
 
+std::shared_ptr<const GeneratorGraph> Context::hierarchy(Generator *root) {
+    std::lock_guard guard(hierarchy_lock_);
+    auto iter = hierarchy_.find(root);
+    if (iter == hierarchy_.end()) {
+        iter = hierarchy_.emplace(root, std::make_shared<GeneratorGraph>(root)).first;
+        // the root drops its entry once it's destroyed
+        root->hierarchy_cached_ = true;
+    }
+    auto &graph = iter->second;
+    // in-place updates leave the orderings stale. since a graph in use is copied before it
+    // is updated, the stale one is not shared and can be sorted in place
+    if (!graph->sorted()) graph->sort();
+    return graph;
+}
+
+namespace {
+template <typename T, typename F>
+void update_hierarchy(T &hierarchy, const Generator *generator, F update) {
+    // only the graphs rooted at one of its ancestors can contain the generator
+    for (auto const *gen = generator; gen; gen = gen->parent_generator()) {
+        auto iter = hierarchy.find(gen);
+        if (iter == hierarchy.end()) continue;
+        auto &graph = iter->second;
+        if (!graph->has_node(generator)) continue;
+        // copy on write since passes may still be using it
+        if (graph.use_count() > 1) graph = std::make_shared<GeneratorGraph>(*graph);
+        if (!update(graph.get())) hierarchy.erase(iter);
+    }
+}
+}  // namespace
+
+void Context::hierarchy_add_child(Generator *parent, Generator *child) {
+    std::lock_guard guard(hierarchy_lock_);
+    update_hierarchy(hierarchy_, parent,
+                     [=](GeneratorGraph *graph) { return graph->add_child(parent, child); });
+}
+
+void Context::hierarchy_remove_child(Generator *parent, Generator *child) {
+    std::lock_guard guard(hierarchy_lock_);
+    update_hierarchy(hierarchy_, parent, [=](GeneratorGraph *graph) {
+        graph->remove_child(parent, child);
+        return true;
+    });
+}
+
+void Context::hierarchy_rename_child(Generator *child) {
+    std::lock_guard guard(hierarchy_lock_);
+    update_hierarchy(hierarchy_, child, [=](GeneratorGraph *graph) {
+        graph->rename_child(child);
+        return true;
+    });
+}
+
+void Context::invalidate_hierarchy(const Generator *generator) {
+    std::lock_guard guard(hierarchy_lock_);
+    for (auto const *gen = generator; gen; gen = gen->parent_generator()) {
+        auto iter = hierarchy_.find(gen);
+        if (iter != hierarchy_.end() && iter->second->has_node(generator)) hierarchy_.erase(iter);
+    }
+}
+
+void Context::drop_hierarchy(const Generator *root) {
+    std::lock_guard guard(hierarchy_lock_);
+    hierarchy_.erase(root);
+}
+
+void Context::clear_hierarchy() {
+    std::lock_guard guard(hierarchy_lock_);
+    // the roots no longer need to drop their entries when they are destroyed
+    for (auto const &iter : hierarchy_) {
+        const_cast<Generator *>(iter.first)->hierarchy_cached_ = false;
+    }
+    hierarchy_.clear();
+}
+
+uint64_t Context::num_hierarchies() const {
+    std::lock_guard guard(hierarchy_lock_);
+    return hierarchy_.size();
+}
+
 void Context::clear() {
+    clear_hierarchy();
     modules_.clear();
     clear_hash();
     reset_id();
@@ -137,4 +234,54 @@ void Context::clear() {
     clear_tracked_generator();
 }
 
+void Context::reset(bool release_constants) {
+    if (release_constants && num_contexts > 1)
+        throw UserException("Unable to release the constants while other contexts are alive");
+    // only one batch is in flight at any time
+    wait_reset();
+
+    // everything owned by the context is moved into a single batch. destroying
+    // a large design means walking millions of shared_ptr, so we do that on a
+    // separate thread and let the caller start the next design right away.
+    // the cached hierarchies are cleared first, so the generators being destroyed
+    // don't call back into the context from the background thread
+    struct Batch {
+        std::unordered_map<std::string, std::set<std::shared_ptr<Generator>>> modules;
+        std::unordered_map<const Generator *, uint64_t> generator_hash;
+        std::map<std::string, std::shared_ptr<Enum>> enum_defs;
+        std::unordered_set<std::shared_ptr<Generator>> empty_generators;
+        std::unordered_set<Generator *> tracked_generators;
+        std::unordered_set<std::shared_ptr<Const>> consts;
+        std::shared_ptr<Generator> const_generator;
+    };
+    clear_hierarchy();
+    auto batch = std::make_unique<Batch>();
+    batch->modules.swap(modules_);
+    batch->generator_hash.swap(generator_hash_);
+    batch->enum_defs.swap(enum_defs_);
+    batch->empty_generators.swap(empty_generators_);
+    batch->tracked_generators.swap(tracked_generators_);
+    if (release_constants) Const::release_constants(batch->consts, batch->const_generator);
+
+    track_generated_ = false;
+    reset_id();
+
+    pending_reset_ = std::async(std::launch::async, [b = std::move(batch)]() mutable {
+        // constants may be referenced by the generators, so release them last
+        b->modules.clear();
+        b->empty_generators.clear();
+        b->enum_defs.clear();
+        b.reset();
+    });
+}
+
+void Context::wait_reset() {
+    if (pending_reset_.valid()) pending_reset_.get();
+}
+
+Context::~Context() {
+    wait_reset();
+    num_contexts--;
+}
+
 }  // namespace kratos
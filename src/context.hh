@@ -1,8 +1,10 @@
 #ifndef KRATOS_CONTEXT_HH
 #define KRATOS_CONTEXT_HH
 
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -62,9 +64,17 @@ struct InterfaceDefinition;
 struct InterfaceRef;
 class Property;
 class Sequence;
+class GeneratorGraph;
 
 class Context {
 private:
+    // generator hierarchy per visited root, kept up to date as children are added,
+    // removed or renamed. passes hold on to a snapshot, so a graph is copied before
+    // it is updated while in use. declared first so that it outlives the generators,
+    // which drop their entry when they are destroyed
+    std::unordered_map<const Generator*, std::shared_ptr<GeneratorGraph>> hierarchy_;
+    mutable std::mutex hierarchy_lock_;
+
     std::unordered_map<std::string, std::set<std::shared_ptr<Generator>>> modules_;
     std::unordered_map<const Generator*, uint64_t> generator_hash_;
     int max_instance_id_ = 0;
@@ -82,8 +92,16 @@ private:
     bool track_generated_ = false;
     std::unordered_set<Generator*> tracked_generators_;
 
+    // incremental compilation
+    bool incremental_ = false;
+    bool incremental_run_ = false;
+
+    // outstanding background destruction started by reset()
+    std::future<void> pending_reset_;
+
 public:
-    Context() = default;
+    Context();
+    ~Context();
 
     Generator& generator(const std::string& name);
     Generator& empty_generator();
@@ -95,6 +113,7 @@ public:
     bool has_hash(const Generator* generator) const;
     uint64_t get_hash(const Generator* generator) const;
     void inline clear_hash() { generator_hash_.clear(); }
+    void inline remove_hash(const Generator* generator) { generator_hash_.erase(generator); }
 
     // managing the id for multiple invocation of dump database
     int& max_instance_id() { return max_instance_id_; }
@@ -122,7 +141,34 @@ public:
     inline void add_tracked_generator(Generator* gen) { tracked_generators_.emplace(gen); }
     bool is_generated_tracked(Generator *gen) const;
 
+    // when enabled, re-running the pass pipeline only processes the generators affected by
+    // IR changes since the last codegen, and codegen reuses the source of clean modules
+    void set_incremental(bool value) { incremental_ = value; }
+    bool incremental() const { return incremental_; }
+    // set by the pass manager while an incremental pipeline runs
+    void set_incremental_run(bool value) { incremental_run_ = value; }
+    bool incremental_run() const { return incremental_run_; }
+
+    // cached hierarchy index of the root. use generator_hierarchy() in graph.hh instead
+    std::shared_ptr<const GeneratorGraph> hierarchy(Generator* root);
+    // called by the generators whenever the hierarchy changes
+    void hierarchy_add_child(Generator* parent, Generator* child);
+    void hierarchy_remove_child(Generator* parent, Generator* child);
+    void hierarchy_rename_child(Generator* child);
+    void invalidate_hierarchy(const Generator* generator);
+    void drop_hierarchy(const Generator* root);
+    void clear_hierarchy();
+    uint64_t num_hierarchies() const;
+
     void clear();
+    // same as clear(), but the IR is handed off to a background thread to be
+    // destroyed so the context can be reused immediately. if release_constants
+    // is set, constants created through Const::constant() are released as well,
+    // which invalidates any constant the caller still holds. constants are shared
+    // by all contexts, so this throws if any other context is alive
+    void reset(bool release_constants = false);
+    // blocks until the previous reset() finishes releasing the IR
+    void wait_reset();
 };
 
 }  // namespace kratos
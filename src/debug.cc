@@ -1,7 +1,9 @@
 #include "debug.hh"
 
 #include <mutex>
+#include <regex>
 
+#include "cxxpool.h"
 #include "except.hh"
 #include "fmt/format.h"
 #include "generator.hh"
@@ -15,10 +17,27 @@ using fmt::format;
 
 namespace kratos {
 
+namespace {
+// generators in the order visit_root() reaches them, i.e. parents before children. ids are
+// handed out in this order so that they are the same across runs
+std::vector<Generator *> ordered_generators(Generator *top) {
+    std::vector<Generator *> result;
+    std::vector<Generator *> stack = {top};
+    while (!stack.empty()) {
+        auto *gen = stack.back();
+        stack.pop_back();
+        result.emplace_back(gen);
+        auto children = gen->get_child_generators();
+        for (auto iter = children.rbegin(); iter != children.rend(); iter++) {
+            stack.emplace_back(iter->get());
+        }
+    }
+    return result;
+}
+}  // namespace
+
 class DebugBreakInjectVisitor : public IRVisitor {
 public:
-    explicit DebugBreakInjectVisitor(Context *context) : context_(context) {}
-
     void visit(CombinationalStmtBlock *stmt) override { insert_statements(stmt); }
 
     void visit(SequentialStmtBlock *stmt) override { insert_statements(stmt); }
@@ -37,6 +56,20 @@ public:
         }
     }
 
+    // same order as visit_root(), which the ids used to be handed out in: the statements,
+    // then the functions in the order they were created
+    void visit_content(Generator *generator) override {
+        generator->accept_generator(this);
+        auto const num_children = generator->stmts_count() + generator->functions().size();
+        for (uint64_t i = 0; i < num_children; i++) {
+            auto *child = generator->get_child(i);
+            if (child) visit_root(child);
+        }
+    }
+
+    // statements that need a break point, in visiting order
+    const std::vector<Stmt *> &stmts() const { return stmts_; }
+
 private:
     void insert_statements(StmtBlock *block) {
         auto *parent = block->generator_parent();
@@ -49,45 +82,75 @@ private:
         }
     }
 
-    void process_stmt(Stmt *stmt) {
-        uint32_t stmt_id = context_->max_stmt_id()++;
-        // set stmt id
-        stmt->set_stmt_id(stmt_id);
-    }
+    void process_stmt(Stmt *stmt) { stmts_.emplace_back(stmt); }
 
-    Context *context_;
+    std::vector<Stmt *> stmts_;
 };
 
 void inject_debug_break_points(Generator *top) {
-    DebugBreakInjectVisitor visitor(top->context());
-    visitor.visit_root(top);
-}
-
-class InstanceIdVisitor : public IRVisitor {
-public:
-    explicit InstanceIdVisitor(Context *context) : context_(context) {}
-
-    void visit(Generator *gen) override {
-        if (gen->generator_id < 0) {
-            mutex_.lock();
-            auto id = context_->max_instance_id()++;
-            mutex_.unlock();
-            gen->generator_id = id;
-            // create a parameter
-            auto &p = gen->parameter(break_point_param_name, 32);
-            p.set_value(id);
-        }
+    // the ids only depend on the order of the generators, so each generator is
+    // collected and numbered independently
+    auto generators = ordered_generators(top);
+    std::vector<DebugBreakInjectVisitor> visitors(generators.size());
+    cxxpool::thread_pool pool{get_num_cpus()};
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(generators.size());
+    for (uint64_t i = 0; i < generators.size(); i++) {
+        // external generators are not instrumented
+        if (generators[i]->external()) continue;
+        tasks.emplace_back(pool.push(
+            [&visitors, &generators](uint64_t index) {
+                visitors[index].visit_content(generators[index]);
+            },
+            i));
+    }
+    for (auto &t : tasks) t.get();
+
+    // each generator starts where the previous one ends
+    auto &max_stmt_id = top->context()->max_stmt_id();
+    std::vector<uint32_t> offsets(generators.size());
+    for (uint64_t i = 0; i < generators.size(); i++) {
+        offsets[i] = static_cast<uint32_t>(max_stmt_id);
+        max_stmt_id += static_cast<int>(visitors[i].stmts().size());
     }
 
-private:
-    Context *context_;
-    std::mutex mutex_;
-};
+    tasks.clear();
+    for (uint64_t i = 0; i < generators.size(); i++) {
+        if (visitors[i].stmts().empty()) continue;
+        tasks.emplace_back(pool.push(
+            [&visitors, &offsets](uint64_t index) {
+                auto id = offsets[index];
+                for (auto *stmt : visitors[index].stmts()) stmt->set_stmt_id(id++);
+            },
+            i));
+    }
+    for (auto &t : tasks) t.get();
+}
 
 void inject_instance_ids(Generator *top) {
-    // this can be done in parallel
-    InstanceIdVisitor visitor(top->context());
-    visitor.visit_generator_root_p(top);
+    // ids are assigned in hierarchy order, then the parameters are created in parallel
+    auto generators = ordered_generators(top);
+    auto &max_instance_id = top->context()->max_instance_id();
+    std::vector<Generator *> new_generators;
+    for (auto *gen : generators) {
+        if (gen->generator_id >= 0) continue;
+        gen->generator_id = max_instance_id++;
+        new_generators.emplace_back(gen);
+    }
+
+    cxxpool::thread_pool pool{get_num_cpus()};
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(new_generators.size());
+    for (auto *gen : new_generators) {
+        tasks.emplace_back(pool.push(
+            [](Generator *g) {
+                // create a parameter
+                auto &p = g->parameter(break_point_param_name, 32);
+                p.set_value(g->generator_id);
+            },
+            gen));
+    }
+    for (auto &t : tasks) t.get();
 }
 
 class ExtractDebugVisitor : public IRVisitor {
@@ -123,11 +186,7 @@ std::map<Stmt *, uint32_t> extract_debug_break_points(Generator *top) {
 class InsertVerilatorPublic : public IRVisitor {
 public:
     void visit(Generator *generator) override {
-        auto vars = generator->get_all_var_names();
-        for (auto const &var_name : vars) {
-            auto var = generator->get_var(var_name);
-            insert_str(var.get());
-        }
+        for (auto const &iter : generator->vars()) insert_str(iter.second.get());
     }
 
 private:
@@ -139,6 +198,45 @@ void insert_verilator_public(Generator *top) {
     visitor.visit_generator_root_p(top);
 }
 
+class InsertSelectedVerilatorPublic : public IRVisitor {
+public:
+    InsertSelectedVerilatorPublic(const std::unordered_set<const Var *> &vars,
+                                  const std::vector<std::string> &names,
+                                  const std::string &pattern)
+        : vars_(vars), names_(names.begin(), names.end()) {
+        if (!pattern.empty()) pattern_ = std::regex(pattern);
+    }
+
+    void visit(Generator *generator) override {
+        for (auto const &[name, var] : generator->vars()) {
+            if (selected(var.get())) insert_str(var.get());
+        }
+    }
+
+private:
+    const std::unordered_set<const Var *> &vars_;
+    std::unordered_set<std::string> names_;
+    std::optional<std::regex> pattern_;
+
+    bool selected(const Var *var) const {
+        if (vars_.find(var) != vars_.end() || names_.find(var->name) != names_.end()) return true;
+        if (names_.empty() && !pattern_) return false;
+        auto handle_name = var->handle_name();
+        return names_.find(handle_name) != names_.end() ||
+               (pattern_ && std::regex_match(handle_name, *pattern_));
+    }
+
+    void static insert_str(Var *var) { var->set_after_var_str_(" /*verilator public*/"); }
+};
+
+void insert_verilator_public(Generator *top, const DebugDatabase *db,
+                             const std::vector<std::string> &names, const std::string &pattern) {
+    std::unordered_set<const Var *> vars;
+    if (db) vars = db->referenced_vars();
+    InsertSelectedVerilatorPublic visitor(vars, names, pattern);
+    visitor.visit_generator_root_p(top);
+}
+
 class VarSourceVisitor : public IRVisitor {
 public:
     void visit(Var *var) override {
@@ -184,29 +282,63 @@ std::unordered_map<Var *, std::unordered_set<Var *>> find_driver_signal(Generato
 
 class PropagateScopeVisitor : public IRVisitor {
 public:
-    void visit(IfStmt *stmt) override {
-        auto variables = stmt->scope_context();
-        for (auto const &[name, var] : variables) {
-            stmt->then_body()->add_scope_variable(name, var.second, var.first, false);
-            stmt->else_body()->add_scope_variable(name, var.second, var.first, false);
-        }
+    void visit(Generator *generator) override {
+        if (generator->external()) return;
+        std::vector<const ScopeContext *> scopes;
+        for (auto const &stmt : generator->get_all_stmts()) propagate(stmt.get(), scopes);
+        for (auto const &iter : generator->functions()) propagate(iter.second.get(), scopes);
     }
 
-    void visit(SwitchStmt *stmt) override {
-        auto variables = stmt->scope_context();
-        for (auto const &[name, var] : variables) {
-            auto cases = stmt->body();
-            for (auto &iter : cases) {
-                auto case_ = iter.second;
-                case_->add_scope_variable(name, var.second, var.first, false);
+private:
+    using ScopeContext = std::map<std::string, std::pair<bool, std::string>>;
+
+    // scope variables of if and switch statements are pushed down to every statement in
+    // their bodies in a single walk. scopes are ordered from the outermost one, which takes
+    // precedence, same as propagating them one statement at a time
+    static void propagate(Stmt *stmt, std::vector<const ScopeContext *> &scopes) {
+        for (auto const *scope : scopes) {
+            for (auto const &[name, var] : *scope) {
+                // the children are handled below
+                stmt->Stmt::add_scope_variable(name, var.second, var.first, false);
+            }
+        }
+        switch (stmt->type()) {
+            case StatementType::If: {
+                auto *if_ = reinterpret_cast<IfStmt *>(stmt);
+                scopes.emplace_back(&if_->scope_context());
+                propagate(if_->then_body().get(), scopes);
+                propagate(if_->else_body().get(), scopes);
+                scopes.pop_back();
+                break;
+            }
+            case StatementType::Switch: {
+                auto *switch_ = reinterpret_cast<SwitchStmt *>(stmt);
+                scopes.emplace_back(&switch_->scope_context());
+                for (auto const &iter : switch_->body()) propagate(iter.second.get(), scopes);
+                scopes.pop_back();
+                break;
+            }
+            case StatementType::Block: {
+                auto *block = reinterpret_cast<StmtBlock *>(stmt);
+                for (auto const &child : *block) propagate(child.get(), scopes);
+                break;
+            }
+            case StatementType::For: {
+                // loop bodies don't inherit the scope
+                std::vector<const ScopeContext *> loop_scopes;
+                auto *for_ = reinterpret_cast<ForStmt *>(stmt);
+                propagate(for_->get_loop_body().get(), loop_scopes);
+                break;
             }
+            default:
+                break;
         }
     }
 };
 
 void propagate_scope_variable(Generator *top) {
     PropagateScopeVisitor visitor;
-    visitor.visit_root(top);
+    visitor.visit_generator_root_p(top);
 }
 
 void mock_hierarchy(Generator *top, const std::string &top_name) {
@@ -239,9 +371,8 @@ void mock_hierarchy(Generator *top, const std::string &top_name) {
 
 void DebugDatabase::compute_generators(Generator *top) {
     top_ = top;
-    GeneratorGraph g(top);
-    auto generators = g.get_sorted_generators();
-    for (auto *gen : generators) {
+    auto g = generator_hierarchy(top);
+    for (auto *gen : g->get_sorted_generators()) {
         generators_.emplace(gen);
     }
 }
@@ -326,12 +457,8 @@ void DebugDatabase::set_stmt_context(kratos::Generator *top) {
 }
 
 std::string get_trigger_condition(const Stmt *stmt) {
-    for (auto const &attr : stmt->get_attributes()) {
-        if (attr->type_str == "ssa-trigger") {
-            return attr->value_str;
-        }
-    }
-    return "";
+    auto const *trigger = stmt->get_attribute(ssa_trigger_attribute);
+    return trigger ? *trigger : "";
 }
 
 void save_events(hgdb::DebugDatabase &db, Generator *top);
@@ -499,10 +626,8 @@ void DebugDatabase::save_database(const std::string &filename, bool override) {
         self_context_mapping.emplace(gen, vars);
         auto id = gen_id_map.at(gen);
         // this will be generator instance values (RTL correspondence)
-        auto all_vars = gen->get_all_var_names();
-        for (auto const &var_name : all_vars) {
-            auto var = gen->get_var(var_name);
-            if (var && (var->type() == VarType::Base || var->type() == VarType::PortIO)) {
+        for (auto const &[var_name, var] : gen->vars()) {
+            if (var->type() == VarType::Base || var->type() == VarType::PortIO) {
                 create_variable(var.get(), id, var_name, var_name, false, 0, true);
             }
         }
@@ -545,6 +670,58 @@ void DebugDatabase::save_database(const std::string &filename, bool override) {
     save_events(storage, top_);
 }
 
+namespace {
+// mapped names can refer to part of a var, e.g. a[0] or a.b, in which case the entire var
+// has to be kept
+std::shared_ptr<Var> root_var(Generator *gen, const std::string &name) {
+    auto var = gen->get_var(name);
+    if (var) return var;
+    auto pos = name.find_first_of("[.");
+    if (pos == std::string::npos) return nullptr;
+    return gen->get_var(name.substr(0, pos));
+}
+}  // namespace
+
+std::unordered_set<const Var *> DebugDatabase::referenced_vars() const {
+    std::unordered_set<const Var *> result;
+    // generator variables. only the ones mapped to a front-end name
+    for (auto const &[handle_name, gen_map] : variable_mapping_) {
+        auto const &[gen, vars] = gen_map;
+        for (auto const &[front_name, var_name] : vars) {
+            auto var = root_var(gen, var_name);
+            if (var) result.emplace(var.get());
+        }
+    }
+
+    // context variables
+    for (auto const &[stmt, context] : stmt_context_) {
+        if (break_points_.find(stmt) == break_points_.end()) continue;
+        auto *gen = stmt->generator_parent();
+        for (auto const &[key, entry] : context) {
+            auto const &[is_var, value] = entry;
+            if (!is_var) continue;
+            auto var = gen->get_var(value);
+            if (var) result.emplace(var.get());
+        }
+    }
+
+    // breakpoint conditions are stored as expressions over the var names
+    if (top_) {
+        static const std::regex identifier(R"([A-Za-z_][A-Za-z0-9_$]*)");
+        auto conditions = compute_enable_condition(top_);
+        for (auto const &[stmt, condition] : conditions) {
+            if (break_points_.find(stmt) == break_points_.end()) continue;
+            auto *gen = stmt->generator_parent();
+            auto begin = std::sregex_iterator(condition.begin(), condition.end(), identifier);
+            for (auto iter = begin; iter != std::sregex_iterator(); iter++) {
+                auto var = gen->get_var(iter->str());
+                if (var) result.emplace(var.get());
+            }
+        }
+    }
+    return result;
+}
+
 void inject_clock_break_points(Generator *top) {
     // trying to find the clock automatically
     auto const &port_names = top->get_port_names();
@@ -583,6 +760,221 @@ void inject_clock_break_points(Generator *top, const std::shared_ptr<Port> &port
     }
 }
 
+namespace {
+// the top-level statement that contains the stmt
+Stmt *top_level_stmt(Stmt *stmt) {
+    while (stmt->parent()->ir_node_kind() == IRNodeKind::StmtKind) {
+        stmt = reinterpret_cast<Stmt *>(stmt->parent());
+    }
+    return stmt;
+}
+
+// break points inside combinational and sequential blocks, sorted by id. continuous
+// assignments are always active and the rest don't run once per clock cycle
+std::vector<Stmt *> bitmap_stmts(Generator *generator) {
+    ExtractDebugVisitor visitor;
+    visitor.visit_content(generator);
+    std::vector<Stmt *> result;
+    for (auto const &[stmt, id] : visitor.map()) {
+        auto *top = top_level_stmt(stmt);
+        if (top->type() != StatementType::Block) continue;
+        auto block_type = reinterpret_cast<StmtBlock *>(top)->block_type();
+        if (block_type == StatementBlockType::Combinational ||
+            block_type == StatementBlockType::Sequential)
+            result.emplace_back(stmt);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const Stmt *a, const Stmt *b) { return a->stmt_id() < b->stmt_id(); });
+    return result;
+}
+
+std::shared_ptr<Var> bit_of(Var &var, uint32_t index) {
+    // single bit vars are declared as scalars
+    if (var.width() == 1) return var.shared_from_this();
+    return var[index].shared_from_this();
+}
+
+class BreakPointBitmap {
+public:
+    explicit BreakPointBitmap(Generator *top) : top_(top) {}
+
+    // returns the hit vector of the generator, which is the top-level var for top and an
+    // output port otherwise
+    std::shared_ptr<Var> inject(Generator *generator) {
+        std::vector<std::shared_ptr<Var>> bits;
+        // children first, since the clones rely on their definitions
+        for (auto const &child : generator->get_child_generators()) {
+            auto width = child_width(child.get());
+            if (!width) continue;
+            auto port = child->get_port(break_point_hits_name);
+            auto &var =
+                generator->var(::format("{0}_{1}", child->instance_name, break_point_hits_name),
+                               width);
+            generator->wire(var, *port);
+            bits.emplace_back(var.shared_from_this());
+        }
+        if (!generator->external()) {
+            auto own = inject_own(generator);
+            // own bits are in the lower part
+            bits.insert(bits.begin(), own.begin(), own.end());
+        }
+
+        uint32_t width = 0;
+        for (auto const &bit : bits) width += bit->width();
+        widths_.emplace(generator, width);
+        if (!width) return nullptr;
+
+        Var *vector;
+        if (generator == top_) {
+            vector = &generator->var(break_point_hits_name, width);
+        } else {
+            vector = &generator->port(PortDirection::Out, break_point_hits_name, width);
+        }
+        // {msb, ..., lsb}
+        auto *value = bits.back().get();
+        for (auto i = static_cast<int64_t>(bits.size()) - 2; i >= 0; i--) {
+            value = &value->concat(*bits[i]);
+        }
+        generator->add_stmt(vector->assign(*value, AssignmentType::Blocking));
+        return vector->shared_from_this();
+    }
+
+private:
+    Generator *top_;
+    std::unordered_map<const Generator *, uint32_t> widths_;
+
+    uint32_t child_width(Generator *child) {
+        if (child->is_cloned() && child->def_instance()) {
+            // clones share the module definition, hence the same port
+            auto *def = child->def_instance();
+            if (widths_.find(def) == widths_.end()) inject(def);
+            auto width = widths_.at(def);
+            if (width && !child->has_port(break_point_hits_name)) {
+                child->port(PortDirection::Out, break_point_hits_name, width);
+            }
+            widths_.emplace(child, width);
+            return width;
+        }
+        if (widths_.find(child) == widths_.end()) inject(child);
+        return widths_.at(child);
+    }
+
+    static std::vector<std::shared_ptr<Var>> inject_own(Generator *generator) {
+        auto stmts = bitmap_stmts(generator);
+        // one hit vector per procedural block to avoid multiple drivers
+        std::map<const Stmt *, std::vector<Stmt *>> block_stmts;
+        for (auto *stmt : stmts) block_stmts[top_level_stmt(stmt)].emplace_back(stmt);
+
+        std::unordered_map<const Stmt *, std::shared_ptr<Var>> stmt_bits;
+        std::unordered_map<StmtBlock *, std::unordered_map<const Stmt *, std::shared_ptr<Stmt>>>
+            inserts;
+        uint32_t block_index = 0;
+        for (uint64_t i = 0; i < generator->stmts_count(); i++) {
+            auto block_stmt = generator->get_stmt(i);
+            auto iter = block_stmts.find(block_stmt.get());
+            if (iter == block_stmts.end()) continue;
+            auto const &hit_stmts = iter->second;
+            auto block = block_stmt->as<StmtBlock>();
+            auto type = block->block_type() == StatementBlockType::Sequential
+                            ? AssignmentType::NonBlocking
+                            : AssignmentType::Blocking;
+            auto &hits =
+                generator->var(::format("{0}_{1}", break_point_hits_name, block_index++),
+                               static_cast<uint32_t>(hit_stmts.size()));
+            for (uint32_t j = 0; j < hit_stmts.size(); j++) {
+                auto *stmt = hit_stmts[j];
+                auto bit = bit_of(hits, j);
+                stmt_bits.emplace(stmt, bit);
+                // the bit is set right before the statement gets executed
+                auto *parent = reinterpret_cast<StmtBlock *>(stmt->parent());
+                inserts[parent].emplace(stmt, bit->assign(constant(1, 1), type));
+            }
+            // cleared every time the block is triggered
+            auto clear = hits.assign(constant(0, hits.width()), type);
+            std::vector<std::shared_ptr<Stmt>> block_body = {clear};
+            block_body.insert(block_body.end(), block->begin(), block->end());
+            block->set_stmts(block_body);
+            clear->set_parent(block.get());
+        }
+
+        for (auto const &[block, stmt_inserts] : inserts) {
+            std::vector<std::shared_ptr<Stmt>> block_body;
+            block_body.reserve(block->size() + stmt_inserts.size());
+            for (auto const &stmt : *block) {
+                auto iter = stmt_inserts.find(stmt.get());
+                if (iter != stmt_inserts.end()) {
+                    block_body.emplace_back(iter->second);
+                    iter->second->set_parent(block);
+                }
+                block_body.emplace_back(stmt);
+            }
+            block->set_stmts(block_body);
+        }
+
+        std::vector<std::shared_ptr<Var>> result;
+        result.reserve(stmts.size());
+        for (auto *stmt : stmts) result.emplace_back(stmt_bits.at(stmt));
+        return result;
+    }
+};
+
+// clones don't have any content, so the layout always comes from the definition
+void extract_breakpoint_bitmap(Generator *generator, const std::string &handle_name,
+                               std::vector<std::pair<std::string, uint32_t>> &result) {
+    if (!generator->external()) {
+        for (auto *stmt : bitmap_stmts(generator)) {
+            result.emplace_back(handle_name, static_cast<uint32_t>(stmt->stmt_id()));
+        }
+    }
+    for (auto const &child : generator->get_child_generators()) {
+        auto *def = child.get();
+        if (def->is_cloned() && def->def_instance()) def = def->def_instance();
+        extract_breakpoint_bitmap(def, handle_name + "." + child->instance_name, result);
+    }
+}
+}  // namespace
+
+void inject_breakpoint_bitmap(Generator *top) {
+    auto const &port_names = top->get_port_names();
+    for (auto const &port_name : port_names) {
+        auto const &port = top->get_port(port_name);
+        if (port && port->port_type() == PortType::Clock) {
+            inject_breakpoint_bitmap(top, port);
+            return;
+        }
+    }
+    throw UserException(
+        ::format("Unable to find a clock in {0} to sample the breakpoint bitmap", top->name));
+}
+
+void inject_breakpoint_bitmap(Generator *top, const std::string &clk_name) {
+    auto port = top->get_port(clk_name);
+    if (port) {
+        inject_breakpoint_bitmap(top, port);
+    } else {
+        throw UserException(::format("{0} is not a clock port", clk_name));
+    }
+}
+
+void inject_breakpoint_bitmap(Generator *top, const std::shared_ptr<Port> &port) {
+    BreakPointBitmap bitmap(top);
+    auto hits = bitmap.inject(top);
+    if (!hits) return;
+    // sampled at negedge, same as breakpoint_clock
+    auto seq = top->sequential();
+    seq->add_condition({BlockEdgeType::Negedge, port});
+    auto func = top->dpi_function(break_point_hits_func_name);
+    func->input(break_point_hits_arg, hits->width(), false);
+    auto &var = top->call(break_point_hits_func_name, {{break_point_hits_arg, hits}}, false);
+    seq->add_stmt(std::make_shared<FunctionCallStmt>(var.as<FunctionCallVar>()));
+}
+
+std::vector<std::pair<std::string, uint32_t>> extract_breakpoint_bitmap(Generator *top) {
+    std::vector<std::pair<std::string, uint32_t>> result;
+    extract_breakpoint_bitmap(top, top->handle_name(), result);
+    return result;
+}
+
 class AssertVisitor : public IRVisitor {
 public:
     void visit(AssertBase *base) override {
@@ -11,6 +11,9 @@ constexpr char exception_func_name[] = "exception";
 constexpr char break_point_func_arg[] = "stmt_id";
 constexpr char break_point_param_name[] = "KRATOS_INSTANCE_ID";
 constexpr char break_point_instance_id_arg[] = "instance_id";
+constexpr char break_point_hits_func_name[] = "breakpoint_hits";
+constexpr char break_point_hits_name[] = "KRATOS_BP_HITS";
+constexpr char break_point_hits_arg[] = "hits";
 
 void inject_debug_break_points(Generator *top);
 void inject_instance_ids(Generator *top);
@@ -18,6 +21,15 @@ std::map<Stmt *, uint32_t> extract_debug_break_points(Generator *top);
 void inject_clock_break_points(Generator *top);
 void inject_clock_break_points(Generator *top, const std::string &clk_name);
 void inject_clock_break_points(Generator *top, const std::shared_ptr<Port> &port);
+// low overhead alternative to per statement breakpoint hooks. every instance keeps a
+// bit vector of the breakpoints hit in its combinational and sequential blocks, which
+// is routed up to the top and handed to the debugger with one breakpoint_hits call per
+// clock cycle, sampled at negedge. has to run after inject_debug_break_points
+void inject_breakpoint_bitmap(Generator *top);
+void inject_breakpoint_bitmap(Generator *top, const std::string &clk_name);
+void inject_breakpoint_bitmap(Generator *top, const std::shared_ptr<Port> &port);
+// (instance handle name, stmt id) of each bit in the bitmap, starting from the lsb
+std::vector<std::pair<std::string, uint32_t>> extract_breakpoint_bitmap(Generator *top);
 void inject_assert_fail_exception(Generator *top);
 void remove_assertion(Generator *top);
 void convert_continuous_stmt(Generator *top);
@@ -49,6 +61,10 @@ public:
     void save_database(const std::string &filename, bool override);
     void save_database(const std::string &filename) { save_database(filename, true); }
 
+    // RTL variables the database refers to, i.e. the mapped generator variables, context
+    // variables and the ones used in breakpoint conditions
+    std::unordered_set<const Var *> referenced_vars() const;
+
 private:
     std::map<Stmt *, uint32_t> break_points_;
     std::unordered_map<Generator *, std::set<uint32_t>> generator_break_points_;
@@ -63,5 +79,11 @@ private:
     void compute_generators(Generator *top);
 };
 
+// only marks the vars referenced by the debug database, if provided, and the ones listed in
+// names or matching pattern. names can either be var names or full handle names, e.g.
+// top.inst.a, and pattern is matched against the full handle name
+void insert_verilator_public(Generator *top, const DebugDatabase *db,
+                             const std::vector<std::string> &names, const std::string &pattern);
+
 }  // namespace kratos
 #endif  // KRATOS_DEBUG_HH
@@ -0,0 +1,39 @@
+#include "elaborate.hh"
+
+#include "except.hh"
+#include "expr.hh"
+#include "fmt/format.h"
+
+using fmt::format;
+
+namespace kratos {
+
+std::shared_ptr<Generator> ElaborationCache::instantiate(
+    const std::string &name, const ParamValues &values,
+    const std::set<std::string> &structural_params, const ElaborateFunction &elaborate) {
+    ParamValues structural_values;
+    for (auto const &param_name : structural_params) {
+        auto iter = values.find(param_name);
+        if (iter == values.end())
+            throw UserException(
+                ::format("Missing value for structural parameter {0} of {1}", param_name, name));
+        structural_values.emplace(*iter);
+    }
+
+    auto key = std::make_pair(name, structural_values);
+    auto iter = templates_.find(key);
+    if (iter != templates_.end()) return iter->second->specialize(values);
+
+    auto *generator = &context_->generator(name);
+    elaborate(generator, structural_values);
+    templates_.emplace(key, generator);
+    for (auto const &[param_name, value] : values) {
+        auto param = generator->get_param(param_name);
+        if (!param)
+            throw UserException(::format("{0} does not have parameter {1}", name, param_name));
+        param->set_value(value);
+    }
+    return generator->shared_from_this();
+}
+
+}  // namespace kratos
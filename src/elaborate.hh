@@ -0,0 +1,37 @@
+#ifndef KRATOS_ELABORATE_HH
+#define KRATOS_ELABORATE_HH
+
+#include <functional>
+
+#include "generator.hh"
+
+namespace kratos {
+
+// elaborates a parameterized generator once per distinct structure. only the structural
+// parameters, e.g. the ones that change the control flow, are baked into the template.
+// instances that share the structural values are shallow clones of the template and only
+// differ in the parameter values passed at instantiation, so elaboration, hashing and
+// codegen scale with the number of structures instead of parameter combinations
+class ElaborationCache {
+public:
+    using ParamValues = std::map<std::string, int64_t>;
+    // declares the parameters and builds the generator for the structural values
+    using ElaborateFunction = std::function<void(Generator *, const ParamValues &)>;
+
+    explicit ElaborationCache(Context *context) : context_(context) {}
+
+    // the first instance of every structure is the template itself
+    std::shared_ptr<Generator> instantiate(const std::string &name, const ParamValues &values,
+                                           const std::set<std::string> &structural_params,
+                                           const ElaborateFunction &elaborate);
+
+    uint64_t num_templates() const { return templates_.size(); }
+
+private:
+    Context *context_;
+    std::map<std::pair<std::string, ParamValues>, Generator *> templates_;
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_ELABORATE_HH
@@ -920,6 +920,14 @@ Const &Const::constant(const std::string &hex_value, uint32_t num_bits, bool neg
     return *p;
 }
 
+void Const::release_constants(std::unordered_set<std::shared_ptr<Const>> &consts,
+                              std::shared_ptr<Generator> &const_gen) {
+    consts.swap(consts_);
+    consts_.clear();
+    const_gen.swap(const_generator_);
+    const_generator_ = nullptr;
+}
+
 void Const::set_is_packed(bool value) {
     if (!value) throw UserException("Unable to set const unpacked");
 }
@@ -1073,14 +1081,17 @@ void Param::set_value(int64_t new_value) {
     }
     Const::set_value(new_value);
     has_value_ = true;
+    if (generator_) generator_->mark_dirty();
 
     // change the width of parametrized variables
     for (const auto &var : param_vars_width_) {
         var->var_width() = new_value;
+        if (var->generator()) var->generator()->mark_dirty();
     }
     // change the size as well
     for (const auto &[var, index, expr] : param_vars_size_) {
         var->set_size_param(index, expr);
+        if (var->generator()) var->generator()->mark_dirty();
     }
 
     // change the entire chain
@@ -1118,7 +1129,10 @@ void Param::set_value(const std::shared_ptr<Param> &param) {
     set_value(param->value());
 }
 
-void Param::set_value(const std::string &str_value) { raw_str_value_ = str_value; }
+void Param::set_value(const std::string &str_value) {
+    raw_str_value_ = str_value;
+    if (generator_) generator_->mark_dirty();
+}
 
 void VarConcat::add_source(const std::shared_ptr<kratos::AssignStmt> &stmt) {
     for (auto &var : vars_) {
@@ -433,6 +433,10 @@ public:
     Const(int64_t value, uint32_t width, bool is_signed);
 
     static Generator *const_gen() { return const_generator_.get(); }
+    // hand over ownership of every constant created so far, as well as the
+    // generator holding them. used by Context::reset()
+    static void release_constants(std::unordered_set<std::shared_ptr<Const>> &consts,
+                                  std::shared_ptr<Generator> &const_gen);
 
     // struct is always packed
     bool is_packed() const override { return true; }
@@ -145,12 +145,11 @@ std::unordered_set<Stmt *> FaultAnalyzer::compute_coverage(uint32_t index) {
         for (auto const &stmt : cov) result.emplace(stmt);
     } else {
         auto num_states = run->num_states();
+        auto g = generator_hierarchy(generator_);
         for (uint64_t i = 0; i < num_states; i++) {
             auto *state = run->get_state(i);
             // given the state, we need to go through each generators
-            GeneratorGraph g(generator_);
-            auto generators = g.get_sorted_generators();
-            for (auto const &gen : generators) {
+            for (auto const &gen : g->get_sorted_generators()) {
                 // need to calculate the sequential or combination block
                 auto stmts = gen->get_all_stmts();
                 for (auto const &stmt : stmts) {
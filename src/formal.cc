@@ -1,4 +1,8 @@
 #include "formal.hh"
+
+#include <fstream>
+
+#include "aig.hh"
 #include "stmt.hh"
 
 namespace kratos {
@@ -52,4 +56,16 @@ void remove_async_reset(Generator* top) {
     AsyncVisitor visitor;
     visitor.visit_generator_root_p(top);
 }
+
+void output_aiger(Generator* top, const std::string& filename) {
+    auto aig = bit_blast(top);
+    std::ofstream stream(filename, std::ios::trunc | std::ios::binary);
+    aig.write_aiger(stream);
+}
+
+void output_blif(Generator* top, const std::string& filename) {
+    auto aig = bit_blast(top);
+    std::ofstream stream(filename, std::ios::trunc);
+    aig.write_blif(stream, top->name);
+}
 }
\ No newline at end of file
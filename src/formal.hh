@@ -7,6 +7,10 @@ namespace kratos {
 // this is so that yosys won't freak out
 void remove_async_reset(Generator* top);
 
+// bit-level netlists of the flattened design, see bit_blast() in aig.hh
+void output_aiger(Generator* top, const std::string& filename);
+void output_blif(Generator* top, const std::string& filename);
+
 }
 
 #endif  // KRATOS_FORMAL_HH
@@ -56,7 +56,7 @@ Generator Generator::from_verilog(Context *context, const std::string &src_file,
     for (auto const &[port_name, port_type] : port_types) {
         if (mod.ports_.find(port_name) == mod.ports_.end())
             throw UserException(::format("unable to find port {0}", port_name));
-        std::shared_ptr<Var> &var_p = mod.vars_.at(port_name);
+        auto const &var_p = mod.vars_.at(port_name);
         std::shared_ptr<Port> port_p = std::static_pointer_cast<Port>(var_p);
         port_p->set_port_type(port_type);
     }
@@ -91,7 +91,7 @@ Var &Generator::var(const std::string &var_name, uint32_t width, uint32_t size,
 
 Var &Generator::var(const std::string &var_name, uint32_t width, const std::vector<uint32_t> &size,
                     bool is_signed) {
-    if (vars_.find(var_name) != vars_.end()) {
+    if (vars_.count(var_name)) {
         auto v_p = get_var(var_name);
         if (v_p->width() != width || v_p->is_signed() != is_signed)
             throw VarException(::format("redefinition of {0} with different width/sign", var_name),
@@ -99,6 +99,7 @@ Var &Generator::var(const std::string &var_name, uint32_t width, const std::vect
         return *v_p;
     }
     auto p = std::make_shared<Var>(this, var_name, width, size, is_signed);
+    mark_dirty();
     vars_.emplace(var_name, p);
     return *p;
 }
@@ -113,8 +114,7 @@ Var &Generator::var(const Var &v, const std::string &var_name) {
 }
 
 std::shared_ptr<Var> Generator::get_var(const std::string &var_name) {
-    if (vars_.find(var_name) == vars_.end()) return nullptr;
-    return vars_.at(var_name);
+    return vars_.get(var_name);
 }
 
 Port &Generator::port(PortDirection direction, const std::string &port_name, uint32_t width,
@@ -139,6 +139,7 @@ Port &Generator::port(PortDirection direction, const std::string &port_name, uin
         throw VarException(::format("{0} already exists in {1}", port_name, name),
                            {vars_.at(port_name).get()});
     auto p = std::make_shared<Port>(this, direction, port_name, width, size, type, is_signed);
+    mark_dirty();
     vars_.emplace(port_name, p);
     ports_.emplace(port_name);
     return *p;
@@ -167,6 +168,7 @@ Port &Generator::port(const PortPackedStruct &port, const std::string &port_name
                            {vars_.at(port_name).get()});
     auto p = std::make_shared<PortPackedStruct>(this, port.port_direction(), port_name,
                                                 port.packed_struct(), port.size());
+    mark_dirty();
     vars_.emplace(port_name, p);
     ports_.emplace(port_name);
 
@@ -186,6 +188,7 @@ Port &Generator::port(const EnumPort &port, const std::string &port_name, bool c
     auto *enum_type = const_cast<Enum *>(port.enum_type());
     auto p = std::make_shared<EnumPort>(this, port.port_direction(), port_name,
                                         enum_type->shared_from_this());
+    mark_dirty();
     vars_.emplace(port_name, p);
     ports_.emplace(port_name);
 
@@ -203,6 +206,7 @@ EnumPort &Generator::port(kratos::PortDirection direction, const std::string &po
     if (def->local())
         throw UserException(::format("Cannot use {0} as port type since it's local", def->name));
     auto p = std::make_shared<EnumPort>(this, direction, port_name, def);
+    mark_dirty();
     vars_.emplace(port_name, p);
     ports_.emplace(port_name);
     return *p;
@@ -222,6 +226,7 @@ Expr &Generator::expr(ExprOp op, Var *left, Var *right) {
 
 Param &Generator::parameter(const std::string &parameter_name) {
     auto ptr = std::make_shared<Param>(this, parameter_name);
+    mark_dirty();
     params_.emplace(parameter_name, ptr);
     return *ptr;
 }
@@ -233,12 +238,13 @@ Param &Generator::parameter(const std::string &parameter_name, uint32_t width) {
 Param &Generator::parameter(const std::string &parameter_name, uint32_t width, bool is_signed) {
     check_param_name_conflict(parameter_name);
     auto ptr = std::make_shared<Param>(this, parameter_name, width, is_signed);
+    mark_dirty();
     params_.emplace(parameter_name, ptr);
     return *ptr;
 }
 
 void Generator::check_param_name_conflict(const std::string &parameter_name) {
-    if (params_.find(parameter_name) != params_.end())
+    if (params_.count(parameter_name))
         throw VarException(::format("parameter {0} already exists", parameter_name),
                            {params_.at(parameter_name).get()});
 }
@@ -248,6 +254,7 @@ Param &Generator::parameter(const std::string &parameter_name,
     check_param_name_conflict(parameter_name);
 
     auto ptr = std::make_shared<Param>(this, parameter_name, enum_def.get());
+    mark_dirty();
     params_.emplace(parameter_name, ptr);
     return *ptr;
 }
@@ -256,6 +263,7 @@ Param &Generator::parameter(const std::shared_ptr<Param> &param,
                             const std::string &parameter_name) {
     check_param_name_conflict(parameter_name);
     auto ptr = std::make_shared<Param>(this, param, parameter_name);
+    mark_dirty();
     params_.emplace(parameter_name, ptr);
     return *ptr;
 }
@@ -272,6 +280,7 @@ EnumVar &Generator::enum_var(const std::string &var_name, const std::shared_ptr<
     if (has_var(var_name))
         throw VarException(::format("{0} already exists", var_name), {get_var(var_name).get()});
     auto p = std::make_shared<EnumVar>(this, var_name, enum_def);
+    mark_dirty();
     vars_.emplace(var_name, p);
     return *p;
 }
@@ -296,7 +305,7 @@ FSM &Generator::fsm(const std::string &fsm_name, const std::shared_ptr<Var> &clk
 FunctionCallVar &Generator::call(const std::string &func_name,
                                  const std::map<std::string, std::shared_ptr<Var>> &args,
                                  bool has_return) {
-    if (funcs_.find(func_name) == funcs_.end())
+    if (!funcs_.count(func_name))
         throw UserException(::format("{0} not found", func_name));
     auto func_def = funcs_.at(func_name);
     auto p = std::make_shared<FunctionCallVar>(this, func_def, args, has_return);
@@ -306,7 +315,7 @@ FunctionCallVar &Generator::call(const std::string &func_name,
 
 FunctionCallVar &Generator::call(const std::string &func_name,
                                  const std::vector<std::shared_ptr<Var>> &args) {
-    if (funcs_.find(func_name) == funcs_.end())
+    if (!funcs_.count(func_name))
         throw UserException(::format("{0} not found", func_name));
     auto func_def = funcs_.at(func_name);
     if (!func_def->is_builtin())
@@ -327,19 +336,21 @@ FunctionCallVar &Generator::call(const std::string &func_name,
 }
 
 std::shared_ptr<FunctionStmtBlock> Generator::function(const std::string &func_name) {
-    if (funcs_.find(func_name) != funcs_.end())
+    if (funcs_.count(func_name))
         throw UserException(::format("function {0} already exists", func_name));
     auto p = std::make_shared<FunctionStmtBlock>(this, func_name);
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
+    mark_dirty();
     funcs_.emplace(func_name, p);
     return p;
 }
 
 std::shared_ptr<DPIFunctionStmtBlock> Generator::dpi_function(const std::string &func_name) {
-    if (funcs_.find(func_name) != funcs_.end())
+    if (funcs_.count(func_name))
         throw UserException(::format("function {0} already exists", func_name));
     auto p = std::make_shared<DPIFunctionStmtBlock>(this, func_name);
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
+    mark_dirty();
     funcs_.emplace(func_name, p);
     return p;
 }
@@ -348,19 +359,26 @@ std::shared_ptr<BuiltInFunctionStmtBlock> Generator::builtin_function(
     const std::string &func_name) {
     auto p = std::make_shared<BuiltInFunctionStmtBlock>(this, func_name);
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
+    mark_dirty();
     funcs_.emplace(func_name, p);
     return p;
 }
 
 std::shared_ptr<Property> Generator::property(const std::string &property_name,
                                               const std::shared_ptr<Sequence> &sequence) {
-    if (properties_.find(property_name) != properties_.end())
+    if (properties_.count(property_name))
         throw UserException(::format("Property {0} already exists in {1}", property_name, name));
     auto prop = std::make_shared<Property>(property_name, sequence);
     properties_.emplace(property_name, prop);
     return prop;
 }
 
+void Generator::set_properties(
+    const std::map<std::string, std::shared_ptr<Property>> &properties) {
+    properties_.clear();
+    for (auto const &[property_name, prop] : properties) properties_.emplace(property_name, prop);
+}
+
 std::shared_ptr<FunctionStmtBlock> Generator::get_function(const std::string &func_name) const {
     if (!has_function(func_name)) throw ::runtime_error(::format("{0} does not exist", func_name));
     return funcs_.at(func_name);
@@ -368,11 +386,12 @@ std::shared_ptr<FunctionStmtBlock> Generator::get_function(const std::string &fu
 
 void Generator::add_function(const std::shared_ptr<FunctionStmtBlock> &func) {
     auto func_name = func->function_name();
-    if (funcs_.find(func_name) != funcs_.end())
+    if (funcs_.count(func_name))
         throw StmtException(
             ::format("Function {0} already exists in {1}", func_name, instance_name),
             {func.get(), funcs_.at(func_name).get()});
     func_index_.emplace(static_cast<uint32_t>(funcs_.size()), func_name);
+    mark_dirty();
     funcs_.emplace(func_name, func);
     // change the parent
     func->set_parent(this);
@@ -400,7 +419,10 @@ void Generator::add_child_generator(const std::string &instance_name_,
     if (children_.find(child->instance_name) == children_.end()) {
         children_.emplace(child->instance_name, child);
         child->parent_generator_ = this;
+        // the child may have been clean under its previous parent
+        child->mark_dirty();
         children_names_.emplace_back(child->instance_name);
+        if (context_) context_->hierarchy_add_child(this, child.get());
     } else {
         throw GeneratorException(
             ::format("{0} already exists  in {1}", child->instance_name, instance_name),
@@ -458,6 +480,8 @@ void Generator::remove_child_generator(const std::shared_ptr<Generator> &child)
         }
         // set parent to null
         child->parent_generator_ = nullptr;
+        mark_dirty();
+        if (context_) context_->hierarchy_remove_child(this, child.get());
     }
 }
 
@@ -513,17 +537,29 @@ void Generator::rename_child_generator(const std::shared_ptr<Generator> &child,
 
     // finally change the instance name of a child
     child->instance_name = new_name;
+    mark_dirty();
+    if (context_) context_->hierarchy_rename_child(child.get());
+}
+
+Generator::~Generator() {
+    if (hierarchy_cached_ && context_) context_->drop_hierarchy(this);
+}
+
+void Generator::set_external(bool value) {
+    // external generators hide their children from the hierarchy
+    if (value != is_external_ && context_) context_->invalidate_hierarchy(this);
+    is_external_ = value;
 }
 
 std::vector<std::string> Generator::get_vars() {
     std::vector<std::string> result;
     result.reserve(vars_.size());
+    // already sorted by name
     for (auto const &[name, ptr] : vars_) {
         if (ptr->type() == VarType::Base) {
             result.emplace_back(name);
         }
     }
-    std::sort(result.begin(), result.end());
     return result;
 }
 
@@ -531,12 +567,12 @@ std::vector<std::string> Generator::get_all_var_names() {
     std::vector<std::string> result;
     result.reserve(vars_.size());
     for (auto const &[name, ptr] : vars_) result.emplace_back(name);
-    std::sort(result.begin(), result.end());
     return result;
 }
 
 void Generator::add_stmt(std::shared_ptr<Stmt> stmt) {
     stmt->set_parent(this);
+    mark_dirty();
     stmts_.emplace_back(std::move(stmt));
 }
 
@@ -578,24 +614,23 @@ void Generator::remove_port(const std::string &port_name) {
 void Generator::rename_var(const std::string &old_name, const std::string &new_name) {
     auto var = get_var(old_name);
     if (!var) return;
-    // Using C++17 to replace the key
-    auto handle = vars_.extract(old_name);
-    handle.key() = new_name;
+    vars_.rename(old_name, new_name);
     // rename the var
     var->name = new_name;
-    vars_.insert(std::move(handle));
+    mark_dirty();
 }
 
 void Generator::reindex_vars() {
     // this is a little bit expensive in terms of computation
-    std::map<std::string, std::shared_ptr<Var>> vars;
+    SymbolTable<Var> vars;
     std::set<std::string> ports;
 
-    for (auto const &[n_, var] : vars_) {
+    for (auto const &[n_, var] : vars_.entries()) {
+        if (!var) continue;
         auto const &name_ = var->name;
         vars.emplace(name_, var);
         if (var->type() == VarType::PortIO) {
-            ports_.emplace(name_);
+            ports.emplace(name_);
         }
     }
 
@@ -609,13 +644,13 @@ void Generator::add_call_var(const std::shared_ptr<FunctionCallVar> &var) {
 }
 
 std::shared_ptr<Param> Generator::get_param(const std::string &param_name) const {
-    if (params_.find(param_name) == params_.end()) return nullptr;
-    return params_.at(param_name);
+    return params_.get(param_name);
 }
 
 void Generator::remove_stmt(const std::shared_ptr<Stmt> &stmt) {
     auto pos = std::find(stmts_.begin(), stmts_.end(), stmt);
     if (pos != stmts_.end()) {
+        mark_dirty();
         stmts_.erase(pos);
     }
 }
@@ -624,11 +659,11 @@ std::shared_ptr<InterfaceRef> Generator::interface(const std::shared_ptr<IDefini
                                                    const std::string &interface_name,
                                                    bool is_port) {
     // making sure that it doesn't have ports or vars
-    if (vars_.find(interface_name) != vars_.end()) {
+    if (vars_.count(interface_name)) {
         throw VarException(::format("{0} already exists in {1}", interface_name, instance_name),
                            {vars_.at(interface_name).get()});
     }
-    if (interfaces_.find(interface_name) != interfaces_.end()) {
+    if (interfaces_.count(interface_name)) {
         throw UserException(::format("{0} already exists in {1}", interface_name, instance_name));
     }
     // check to see if it's a valid name
@@ -645,6 +680,7 @@ std::shared_ptr<InterfaceRef> Generator::interface(const std::shared_ptr<IDefini
         auto var_name = ::format("{0}.{1}", interface_name, n);
         auto v = std::make_shared<InterfaceVar>(ref.get(), this, n, width, size, false);
         ref->var(n, v.get());
+        mark_dirty();
         vars_.emplace(var_name, v);
     }
     auto const &ports = def->ports();
@@ -654,16 +690,18 @@ std::shared_ptr<InterfaceRef> Generator::interface(const std::shared_ptr<IDefini
         auto var_name = ::format("{0}.{1}", interface_name, n);
         auto p = std::make_shared<InterfacePort>(ref.get(), this, dir, n, width, size, type, false);
         ref->port(n, p.get());
+        mark_dirty();
         vars_.emplace(var_name, p);
         if (is_port) ports_.emplace(var_name);
     }
     // put it in the interface
+    mark_dirty();
     interfaces_.emplace(interface_name, ref);
     return ref;
 }
 
 std::shared_ptr<InterfaceRef> Generator::get_interface(const std::string &interface_name) const {
-    return interfaces_.find(interface_name) != interfaces_.end() ? interfaces_.at(interface_name)
+    return interfaces_.count(interface_name) ? interfaces_.at(interface_name)
                                                                  : nullptr;
 }
 
@@ -921,6 +959,39 @@ std::shared_ptr<Generator> Generator::clone() {
     return generator;
 }
 
+std::shared_ptr<Generator> Generator::specialize(const std::map<std::string, int64_t> &values) {
+    for (auto const &iter : values) {
+        if (!params_.count(iter.first))
+            throw UserException(::format("{0} does not have parameter {1}", name, iter.first));
+    }
+    auto generator = clone();
+    for (auto const &[param_name, param] : params_) {
+        auto &clone_param = *generator->params_.at(param_name);
+        // the instantiation only lists the values that differ from the definition
+        auto initial_value = param->get_initial_value();
+        if (initial_value) clone_param.set_initial_value(*initial_value);
+        auto iter = values.find(param_name);
+        if (iter != values.end()) {
+            clone_param.set_value(iter->second);
+        } else if (initial_value) {
+            clone_param.set_value(*initial_value);
+        }
+    }
+    for (auto const &port_name : ports_) {
+        auto *width_param = vars_.at(port_name)->width_param();
+        if (!width_param || width_param->type() != VarType::Parameter ||
+            width_param->generator() != this)
+            continue;
+        auto const &param_name = reinterpret_cast<Param *>(width_param)->parameter_name();
+        auto param = generator->params_.at(param_name);
+        if (!param->has_value()) continue;
+        generator->vars_.at(port_name)->set_width_param(param);
+    }
+    // so that renaming the definition renames the instances as well
+    clones_.emplace(generator);
+    return generator;
+}
+
 void Generator::accept(IRVisitor *visitor) {
     if (!external()) visitor->visit(this);
 }
@@ -942,6 +1013,7 @@ PortPackedStruct &Generator::port_packed(PortDirection direction, const std::str
         throw VarException(::format("{0} already exists in {1}", port_name, name),
                            {vars_.at(port_name).get()});
     auto p = std::make_shared<PortPackedStruct>(this, direction, port_name, packed_struct_, size);
+    mark_dirty();
     vars_.emplace(port_name, p);
     ports_.emplace(port_name);
     return *p;
@@ -960,10 +1032,11 @@ VarPackedStruct &Generator::var_packed(const std::string &var_name,
 VarPackedStruct &Generator::var_packed(const std::string &var_name,
                                        const PackedStruct &packed_struct_,
                                        const std::vector<uint32_t> &size) {
-    if (vars_.find(var_name) != vars_.end())
+    if (vars_.count(var_name))
         throw VarException(::format("{0} already exists in {1}", var_name, name),
                            {vars_.at(var_name).get()});
     auto v = std::make_shared<VarPackedStruct>(this, var_name, packed_struct_, size);
+    mark_dirty();
     vars_.emplace(var_name, v);
     return *v;
 }
@@ -1063,7 +1136,7 @@ std::vector<std::string> Generator::get_ports(kratos::PortType type) const {
 
 std::shared_ptr<PortBundleRef> Generator::add_bundle_port_def(const std::string &port_name,
                                                               const PortBundleDefinition &def) {
-    if (port_bundle_mapping_.find(port_name) != port_bundle_mapping_.end())
+    if (port_bundle_mapping_.count(port_name))
         throw UserException(::format("{0} already exists in {1}", port_name, name));
     auto definition = def.definition();
     auto ref = std::make_shared<PortBundleRef>(this, def);
@@ -1115,7 +1188,7 @@ void Generator::set_child_comment(const std::string &child_name, const std::stri
 }
 
 void Generator::remove_var(const std::string &var_name) {
-    if (vars_.find(var_name) == vars_.end()) {
+    if (!vars_.count(var_name)) {
         throw UserException(::format("Cannot find {0} from {1}", var_name, name));
     }
     auto var = vars_.at(var_name);
@@ -1126,6 +1199,7 @@ void Generator::remove_var(const std::string &var_name) {
         throw UserException(::format("{0} still has sink connection(s)", var->name));
     }
 
+    mark_dirty();
     vars_.erase(var_name);
 }
 
@@ -1202,4 +1276,25 @@ std::shared_ptr<Var> Generator::get_auxiliary_var(uint32_t width, bool signed_)
     return v;
 }
 
+void Generator::mark_dirty() {
+    // the flags are cleared independently, so we always walk up to the top
+    for (auto *gen = this; gen; gen = gen->parent_generator_) gen->dirty_.set();
+}
+
+bool Generator::skip_incremental() const {
+    if (!context_ || !context_->incremental_run() || is_dirty()) return false;
+    return !parent_generator_ || !parent_generator_->is_dirty();
+}
+
+const std::string *Generator::cached_verilog(const std::string &options) const {
+    if (is_dirty(DirtyState::Codegen) || options != verilog_cache_options_) return nullptr;
+    return &verilog_cache_;
+}
+
+void Generator::set_cached_verilog(const std::string &options, std::string src) {
+    verilog_cache_options_ = options;
+    verilog_cache_ = std::move(src);
+    clear_dirty(DirtyState::Codegen);
+}
+
 }  // namespace kratos
@@ -2,6 +2,7 @@
 
 #ifndef KRATOS_MODULE_HH
 #define KRATOS_MODULE_HH
+#include <atomic>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -9,9 +10,40 @@
 
 #include "context.hh"
 #include "port.hh"
+#include "symbol.hh"
 
 namespace kratos {
 
+// what has to be redone for a generator after its IR changed. each flag is cleared
+// independently by the step that consumes it
+class DirtyState {
+public:
+    // the pass pipeline. cleared for the whole hierarchy once verilog is generated
+    static constexpr uint8_t Passes = 1u << 0u;
+    // the hash stored in the context
+    static constexpr uint8_t Hash = 1u << 1u;
+    // the cached verilog source
+    static constexpr uint8_t Codegen = 1u << 2u;
+    static constexpr uint8_t All = Passes | Hash | Codegen;
+
+    DirtyState() = default;
+    // generators are copyable, so is the state
+    DirtyState(const DirtyState &state) : flags_(state.flags_.load()) {}
+    DirtyState &operator=(const DirtyState &state) {
+        flags_ = state.flags_.load();
+        return *this;
+    }
+
+    void set() {
+        if (flags_.load(std::memory_order_relaxed) != All) flags_.fetch_or(All);
+    }
+    void clear(uint8_t flags) { flags_.fetch_and(static_cast<uint8_t>(~flags)); }
+    bool test(uint8_t flags) const { return flags_.load() & flags; }
+
+private:
+    std::atomic<uint8_t> flags_{All};
+};
+
 class Generator : public std::enable_shared_from_this<Generator>, public IRNode {
 public:
     std::string name;
@@ -90,39 +122,32 @@ public:
     // create properties
     std::shared_ptr<Property> property(const std::string &property_name,
                                        const std::shared_ptr<Sequence> &sequence);
-    [[nodiscard]] const std::map<std::string, std::shared_ptr<Property>> &properties() const {
-        return properties_;
-    }
-    void set_properties(const std::map<std::string, std::shared_ptr<Property>> &properties) {
-        properties_ = properties;
-    }
+    [[nodiscard]] const SymbolTable<Property> &properties() const { return properties_; }
+    void set_properties(const std::map<std::string, std::shared_ptr<Property>> &properties);
 
     // ports and vars
     std::shared_ptr<Port> get_port(const std::string &port_name) const;
     std::shared_ptr<Var> get_var(const std::string &var_name);
     const std::set<std::string> &get_port_names() const { return ports_; }
-    const std::map<std::string, std::shared_ptr<Var>> &vars() const { return vars_; }
+    const SymbolTable<Var> &vars() const { return vars_; }
+    const std::unordered_set<std::shared_ptr<Expr>> &exprs() const { return exprs_; }
     void remove_var(const std::string &var_name);
     bool has_port(const std::string &port_name) { return ports_.find(port_name) != ports_.end(); }
-    bool has_var(const std::string &var_name) { return vars_.find(var_name) != vars_.end(); }
+    bool has_var(const std::string &var_name) { return vars_.count(var_name); }
     void remove_port(const std::string &port_name);
     void rename_var(const std::string &old_name, const std::string &new_name);
     void reindex_vars();
     void add_call_var(const std::shared_ptr<FunctionCallVar> &var);
-    const inline std::map<std::string, std::shared_ptr<Param>> &get_params() const {
-        return params_;
-    }
+    const inline SymbolTable<Param> &get_params() const { return params_; }
     const inline std::map<std::string, std::shared_ptr<Enum>> &get_enums() const { return enums_; }
     std::shared_ptr<Param> get_param(const std::string &param_name) const;
     const std::map<std::string, std::shared_ptr<FSM>> &fsms() const { return fsms_; }
     std::shared_ptr<FunctionStmtBlock> function(const std::string &func_name);
     std::shared_ptr<DPIFunctionStmtBlock> dpi_function(const std::string &func_name);
     std::shared_ptr<BuiltInFunctionStmtBlock> builtin_function(const std::string &func_name);
-    const std::map<std::string, std::shared_ptr<FunctionStmtBlock>> &functions() const {
-        return funcs_;
-    }
+    const SymbolTable<FunctionStmtBlock> &functions() const { return funcs_; }
     bool inline has_function(const std::string &func_name) const {
-        return funcs_.find(func_name) != funcs_.end();
+        return funcs_.count(func_name);
     }
     std::shared_ptr<FunctionStmtBlock> get_function(const std::string &func_name) const;
     void add_function(const std::shared_ptr<FunctionStmtBlock> &func);
@@ -135,7 +160,10 @@ public:
     }
     void remove_stmt(const std::shared_ptr<Stmt> &stmt);
     const std::vector<std::shared_ptr<Stmt>> &get_all_stmts() const { return stmts_; }
-    void set_stmts(const std::vector<std::shared_ptr<Stmt>> &stmts) { stmts_ = stmts; }
+    void set_stmts(const std::vector<std::shared_ptr<Stmt>> &stmts) {
+        stmts_ = stmts;
+        mark_dirty();
+    }
 
     // interfaces
     std::shared_ptr<InterfaceRef> interface(const std::shared_ptr<IDefinition> &def,
@@ -190,7 +218,7 @@ public:
     // if imported from verilog or specified
     bool external() const { return (!lib_files_.empty()) || is_external_; }
     std::string external_filename() const { return lib_files_.empty() ? "" : lib_files_[0]; }
-    void set_external(bool value) { is_external_ = value; }
+    void set_external(bool value);
 
     std::shared_ptr<Stmt> wire_ports(std::shared_ptr<Port> &port1, std::shared_ptr<Port> &port2);
     std::pair<bool, bool> correct_wire_direction(const std::shared_ptr<Var> &var1,
@@ -204,6 +232,9 @@ public:
 
     const std::unordered_set<std::shared_ptr<Generator>> &get_clones() const { return clones_; }
     std::shared_ptr<Generator> clone();
+    // shallow clone that shares the definition and only overrides the parameter values at
+    // instantiation. ports sized by a parameter follow the new value
+    std::shared_ptr<Generator> specialize(const std::map<std::string, int64_t> &values);
     bool is_cloned() const { return is_cloned_; }
     // this is for internal libraries only. use it only if you know what you're doing
     void set_is_cloned(bool value) { is_cloned_ = value; }
@@ -216,7 +247,7 @@ public:
     std::vector<std::string> get_ports(PortType type) const;
     // port bundles
     bool inline has_port_bundle(const std::string &port_name) {
-        return port_bundle_mapping_.find(port_name) != port_bundle_mapping_.end();
+        return port_bundle_mapping_.count(port_name);
     }
     std::shared_ptr<PortBundleRef> add_bundle_port_def(const std::string &port_name,
                                                        const PortBundleDefinition &def);
@@ -224,9 +255,7 @@ public:
         const std::string &port_name, const PortBundleDefinition &def,
         const std::pair<std::string, uint32_t> &debug_info);
     std::shared_ptr<PortBundleRef> get_bundle_ref(const std::string &port_name);
-    const std::map<std::string, std::shared_ptr<PortBundleRef>> &port_bundle_mapping() const {
-        return port_bundle_mapping_;
-    }
+    const SymbolTable<PortBundleRef> &port_bundle_mapping() const { return port_bundle_mapping_; }
     void remove_bundle_port_ref(const std::string &ref_name) {
         port_bundle_mapping_.erase(ref_name);
     }
@@ -239,7 +268,7 @@ public:
     std::string get_child_comment(const std::string &child_name) const;
     void set_child_comment(const std::string &child_name, const std::string &comment);
 
-    ~Generator() override = default;
+    ~Generator() override;
 
     // meta functions
     bool inline has_named_block(const std::string &block_name) const {
@@ -256,9 +285,7 @@ public:
     std::shared_ptr<Var> get_auxiliary_var(uint32_t width, bool signed_ = false);
     bool has_instantiated() const { return has_instantiated_; }
     bool &has_instantiated() { return has_instantiated_; }
-    const std::map<std::string, std::shared_ptr<InterfaceRef>> &interfaces() const {
-        return interfaces_;
-    }
+    const SymbolTable<InterfaceRef> &interfaces() const { return interfaces_; }
     void add_raw_import(const std::string &pkg_name) { raw_package_imports_.emplace(pkg_name); }
     const std::unordered_set<std::string> &raw_package_imports() const {
         return raw_package_imports_;
@@ -269,15 +296,29 @@ public:
     // used for to find out which verilog file it generates to
     std::string verilog_fn;
 
+    // incremental compilation. IR mutations mark the generator and all its ancestors
+    // dirty, since the hierarchical passes and the parent's codegen depend on it.
+    // call mark_dirty() after changing the IR through any other means
+    void mark_dirty();
+    bool is_dirty(uint8_t flags = DirtyState::Passes) const { return dirty_.test(flags); }
+    void clear_dirty(uint8_t flags = DirtyState::Passes) { dirty_.clear(flags); }
+    // true if an incremental pass pipeline is running and neither the generator nor its
+    // parent changed since the last run, in which case the entire subtree is clean
+    bool skip_incremental() const;
+    // module source from the last codegen with the same options, or nullptr if the
+    // generator changed since then
+    const std::string *cached_verilog(const std::string &options) const;
+    void set_cached_verilog(const std::string &options, std::string src);
+
 private:
     std::vector<std::string> lib_files_;
     Context *context_;
 
-    std::map<std::string, std::shared_ptr<Var>> vars_;
+    SymbolTable<Var> vars_;
     std::set<std::string> ports_;
-    std::map<std::string, std::shared_ptr<Param>> params_;
+    SymbolTable<Param> params_;
     std::unordered_set<std::shared_ptr<Expr>> exprs_;
-    std::map<std::string, std::shared_ptr<PortBundleRef>> port_bundle_mapping_;
+    SymbolTable<PortBundleRef> port_bundle_mapping_;
 
     std::vector<std::shared_ptr<Stmt>> stmts_;
 
@@ -298,6 +339,15 @@ private:
     // used to identify whether a module instantiation is created
     bool has_instantiated_ = false;
 
+    // set by the context once it caches the hierarchy rooted at this generator
+    bool hierarchy_cached_ = false;
+    friend class Context;
+
+    // incremental compilation
+    DirtyState dirty_;
+    std::string verilog_cache_options_;
+    std::string verilog_cache_;
+
     // meta values
     // named blocks
     std::unordered_map<std::string, std::shared_ptr<StmtBlock>> named_blocks_;
@@ -306,7 +356,7 @@ private:
     // fsms
     std::map<std::string, std::shared_ptr<FSM>> fsms_;
     // functions
-    std::map<std::string, std::shared_ptr<FunctionStmtBlock>> funcs_;
+    SymbolTable<FunctionStmtBlock> funcs_;
     std::map<uint32_t, std::string> func_index_;
     // function_calls
     std::set<std::shared_ptr<FunctionCallVar>> calls_;
@@ -315,9 +365,9 @@ private:
     // auxiliary var
     std::unordered_map<uint32_t, std::shared_ptr<Var>> auxiliary_vars_;
     // interfaces
-    std::map<std::string, std::shared_ptr<InterfaceRef>> interfaces_;
+    SymbolTable<InterfaceRef> interfaces_;
     // properties
-    std::map<std::string, std::shared_ptr<Property>> properties_;
+    SymbolTable<Property> properties_;
 
     // raw imports. only used when interfacing foreign IPs
     std::unordered_set<std::string> raw_package_imports_;
@@ -12,41 +12,10 @@ using fmt::format;
 
 namespace kratos {
 
-class GeneratorVisitor : public IRVisitor {
-public:
-    explicit GeneratorVisitor(GeneratorGraph *g) : g_(g) {}
-    void visit(Generator *generator) override { g_->add_node(generator); }
-
-private:
-    GeneratorGraph *g_;
-};
-
-class GeneratorGraphVisitor : public IRVisitor {
-public:
-    explicit GeneratorGraphVisitor(GeneratorGraph *g) : g_(g) {}
-    void visit(Generator *generator) override {
-        auto *parent_node = g_->get_node(generator);
-        for (auto const &child : generator->get_child_generators()) {
-            auto *child_node = g_->get_node(child.get());
-            if (child_node->parent != nullptr)
-                throw InternalException(::format("{0} already has a parent",
-                                                 child_node->parent->generator->instance_name));
-            child_node->parent = parent_node;
-            parent_node->children.emplace(child_node->generator);
-        }
-    }
-
-private:
-    GeneratorGraph *g_;
-};
-
 GeneratorGraph::GeneratorGraph(Generator *generator) : root_(generator) {
-    // first pass create nodes for each generator
-    GeneratorVisitor visitor(this);
-    visitor.visit_generator_root(generator);
-    // second pass to build the graph
-    GeneratorGraphVisitor g_visitor(this);
-    g_visitor.visit_generator_root(generator);
+    // a single depth-first walk. since every generator has only one parent, the
+    // post-order is a valid topological order and the depth is the level
+    add_subtree(nullptr, generator, true);
 }
 
 GeneratorNode *GeneratorGraph::add_node(Generator *generator) {
@@ -69,78 +38,88 @@ GeneratorNode *GeneratorGraph::get_node(Generator *generator) {
     return &nodes_.at(generator);
 }
 
-void topological_sort_helper(GeneratorGraph *g, GeneratorNode *node,
-                             std::unordered_set<GeneratorNode *> &visited,
-                             std::queue<GeneratorNode *> &queue) {
-    // mark it as visited
-    visited.emplace(node);
-
-    // visit all the child node
-    for (auto const &child : node->children) {
-        auto *child_node = g->get_node(child);
-        if (visited.find(child_node) == visited.end()) {
-            // visit it
-            topological_sort_helper(g, child_node, visited, queue);
-        }
+void GeneratorGraph::add_subtree(GeneratorNode *parent, Generator *generator, bool sort) {
+    auto *node = add_node(generator);
+    if (parent) {
+        node->parent = parent->generator;
+        node->level = parent->level + 1;
+        node->path = parent->path + "." + generator->instance_name;
+        parent->children.emplace(generator);
+    } else {
+        node->path = generator->instance_name;
+    }
+    if (sort) {
+        if (levels_.size() <= node->level) levels_.resize(node->level + 1);
+        levels_[node->level].emplace_back(generator);
+    }
+    for (auto const &child : generator->get_child_generators()) {
+        add_subtree(node, child.get(), sort);
     }
-    queue.push(node);
+    if (sort) sorted_.emplace_back(generator);
 }
 
-std::queue<GeneratorNode *> GeneratorGraph::topological_sort() {
-    std::unordered_set<GeneratorNode *> visited;
-    std::queue<GeneratorNode *> queue;
-    for (auto &iter : nodes_) {
-        auto *node = &iter.second;
-        if (visited.find(node) == visited.end()) {
-            // visit it
-            topological_sort_helper(this, node, visited, queue);
-        }
+void GeneratorGraph::sort() {
+    sorted_.clear();
+    levels_.clear();
+    sort_subtree(root_);
+    is_sorted_ = true;
+}
+
+void GeneratorGraph::sort_subtree(Generator *generator) {
+    auto const &node = nodes_.at(generator);
+    if (levels_.size() <= node.level) levels_.resize(node.level + 1);
+    levels_[node.level].emplace_back(generator);
+    // same order as the walk in the constructor
+    for (auto const &child : generator->get_child_generators()) {
+        if (node.children.find(child.get()) != node.children.end()) sort_subtree(child.get());
     }
-    return queue;
+    sorted_.emplace_back(generator);
 }
 
-std::vector<Generator *> GeneratorGraph::get_sorted_generators() {
-    auto queue = topological_sort();
-    std::vector<Generator *> result;
-    result.reserve(queue.size());
-    while (!queue.empty()) {
-        result.emplace_back(queue.front()->generator);
-        queue.pop();
+bool GeneratorGraph::add_child(Generator *parent, Generator *child) {
+    auto iter = nodes_.find(parent);
+    // not reachable from the root, or children hidden by an external parent
+    if (iter == nodes_.end() || parent->get_child_generators().empty()) return true;
+    auto *parent_node = &iter->second;
+    if (parent_node->children.find(child) != parent_node->children.end()) return true;
+    // a generator used in multiple places is reported when the graph is rebuilt
+    std::vector<Generator *> subtree = {child};
+    for (uint64_t i = 0; i < subtree.size(); i++) {
+        if (has_node(subtree[i])) return false;
+        for (auto const &gen : subtree[i]->get_child_generators()) subtree.emplace_back(gen.get());
     }
-    return result;
+    add_subtree(parent_node, child, false);
+    is_sorted_ = false;
+    return true;
 }
 
-std::vector<std::vector<Generator *>> GeneratorGraph::get_leveled_generators() {
-    // this is a modified breath-first search
-    std::queue<std::pair<Generator *, uint32_t>> queue;
-    std::unordered_map<GeneratorNode *, uint32_t> level_index;
-
-    queue.push({root_, 0});
-    uint32_t max_level = 0;
-
-    while (!queue.empty()) {
-        const auto &[generator, current_level] = queue.front();
-        queue.pop();
-        auto const &node = get_node(generator);
-        if (level_index.find(node) == level_index.end() || level_index.at(node) < current_level) {
-            // update the new level
-            level_index[node] = current_level;
-        }
-        // loop through all the child generators
-        for (const auto &child_generator : generator->get_child_generators()) {
-            queue.push({child_generator.get(), current_level + 1});
-        }
-        if (current_level > max_level) max_level = current_level;
+void GeneratorGraph::remove_child(Generator *parent, Generator *child) {
+    auto iter = nodes_.find(child);
+    if (iter == nodes_.end() || iter->second.parent != parent) return;
+    std::vector<Generator *> queue = {child};
+    for (uint64_t i = 0; i < queue.size(); i++) {
+        for (auto *gen : nodes_.at(queue[i]).children) queue.emplace_back(gen);
     }
+    for (auto *gen : queue) nodes_.erase(gen);
+    nodes_.at(parent).children.erase(child);
+    is_sorted_ = false;
+}
 
-    // construct the result
-    std::vector<std::vector<Generator *>> result;
-    // notice that max is exclusive
-    result.resize(max_level + 1);
-    for (auto const &[generator_node, level] : level_index) {
-        result[level].emplace_back(generator_node->generator);
+void GeneratorGraph::rename_child(Generator *child) {
+    auto iter = nodes_.find(child);
+    if (iter == nodes_.end() || !iter->second.parent) return;
+    std::vector<GeneratorNode *> queue = {&iter->second};
+    for (uint64_t i = 0; i < queue.size(); i++) {
+        auto *node = queue[i];
+        node->path = nodes_.at(node->parent).path + "." + node->generator->instance_name;
+        for (auto *gen : node->children) queue.emplace_back(&nodes_.at(gen));
     }
-    return result;
+}
+
+std::shared_ptr<const GeneratorGraph> generator_hierarchy(Generator *root) {
+    auto *context = root->context();
+    if (context) return context->hierarchy(root);
+    return std::make_shared<GeneratorGraph>(root);
 }
 
 StatementGraph::StatementGraph(Generator *generator) : root_(generator) {
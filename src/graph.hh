@@ -1,7 +1,6 @@
 #ifndef KRATOS_GRAPH_HH
 #define KRATOS_GRAPH_HH
 
-#include <queue>
 #include <unordered_set>
 #include <vector>
 #include "context.hh"
@@ -9,9 +8,13 @@
 namespace kratos {
 
 struct GeneratorNode {
-    GeneratorNode *parent = nullptr;
+    Generator *parent = nullptr;
     Generator *generator;
     std::set<Generator *> children;
+    // distance from the root of the graph
+    uint32_t level = 0;
+    // instance names from the root of the graph, joined by "."
+    std::string path;
 };
 
 class GeneratorGraph {
@@ -19,16 +22,37 @@ public:
     explicit GeneratorGraph(Generator *);
     GeneratorNode *add_node(Generator *generator);
     GeneratorNode *get_node(Generator *generator);
-    std::vector<Generator *> get_sorted_generators();
-    std::vector<std::vector<Generator *>> get_leveled_generators();
+    bool has_node(const Generator *generator) const { return nodes_.find(generator) != nodes_.end(); }
+    Generator *root() const { return root_; }
+    // children are always ordered before their parents
+    const std::vector<Generator *> &get_sorted_generators() const { return sorted_; }
+    const std::vector<std::vector<Generator *>> &get_leveled_generators() const { return levels_; }
+
+    // in-place updates used by the hierarchy index in Context. add_child returns false if
+    // the graph can't be updated and has to be rebuilt. the updates only keep the nodes
+    // up to date, the orderings above are recomputed by sort() once the updates are done
+    bool add_child(Generator *parent, Generator *child);
+    void remove_child(Generator *parent, Generator *child);
+    void rename_child(Generator *child);
+    bool sorted() const { return is_sorted_; }
+    void sort();
 
 private:
-    std::unordered_map<Generator *, GeneratorNode> nodes_;
-    std::queue<GeneratorNode *> topological_sort();
+    std::unordered_map<const Generator *, GeneratorNode> nodes_;
+    std::vector<Generator *> sorted_;
+    std::vector<std::vector<Generator *>> levels_;
+    bool is_sorted_ = true;
 
     Generator *root_;
+
+    void add_subtree(GeneratorNode *parent, Generator *generator, bool sort);
+    void sort_subtree(Generator *generator);
 };
 
+// the cached hierarchy of the root in its context, or a new graph if the root doesn't
+// belong to a context
+std::shared_ptr<const GeneratorGraph> generator_hierarchy(Generator *root);
+
 struct StmtNode {
     StmtNode *parent = nullptr;
     Stmt *stmt;
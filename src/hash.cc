@@ -220,7 +220,8 @@ static uint64_t hash_var(Var* var) {
     if (!var) return 0;
     if (var->type() == VarType::Expression) {
         auto* expr = reinterpret_cast<Expr*>(var);
-        auto op_hash = (uint64_t)expr->op;
+        // hash the op instead of using its value directly, since UInvert is 0
+        auto op_hash = hash_64_fnv1a(&expr->op, sizeof(expr->op));
         return hash_var(expr->left) ^ hash_var(expr->right) ^ op_hash;
     } else if (var->type() == VarType::ConstValue) {
         auto* c = reinterpret_cast<Const*>(var);
@@ -375,21 +376,30 @@ void hash_generator_name(Context* context, Generator* generator) {
 }
 
 void hash_generators_context(Context* context, Generator* root, HashStrategy strategy) {
-    // clear the hash first
-    if (!context->track_generated()) context->clear_hash();
+    // clear the hash first. incremental runs reuse the hashes of unchanged generators
+    bool const incremental = context->incremental_run();
+    if (!context->track_generated() && !incremental) context->clear_hash();
+    auto reuse_hash = [=](Generator* node) {
+        if (!incremental) return false;
+        if (!node->is_dirty(DirtyState::Hash) && context->has_hash(node)) return true;
+        // stale hash of a changed generator
+        context->remove_hash(node);
+        return false;
+    };
 
     // compute the generator graph
-    GeneratorGraph g(root);
+    auto g = generator_hierarchy(root);
     // if it's sequential, do topological sort
     // if it's parallel, do level sort
 
     if (strategy == HashStrategy::SequentialHash) {
-        auto const& sequence = g.get_sorted_generators();
+        auto const& sequence = g->get_sorted_generators();
         std::vector<Generator*> list;
         // reserve for list
         list.reserve(sequence.size());
 
         for (auto const& node : sequence) {
+            if (reuse_hash(node)) continue;
             // different cases
             if (node->external()) {
                 if (node->external_filename().empty()) {
@@ -410,15 +420,20 @@ void hash_generators_context(Context* context, Generator* root, HashStrategy str
         for (auto const& node : list) {
             uint64_t hash = hash_generator(node);
             context->add_hash(node, hash);
+            node->clear_dirty(DirtyState::Hash);
         }
     } else if (strategy == HashStrategy::ParallelHash) {
         uint32_t num_cpus = get_num_cpus();
         cxxpool::thread_pool pool{num_cpus};
 
-        auto levels = g.get_leveled_generators();
+        auto const& levels = g->get_leveled_generators();
         // we proceed in a reversed order
         for (int i = static_cast<int>(levels.size() - 1); i >= 0; i--) {
-            auto list = levels[i];
+            std::vector<Generator*> list;
+            list.reserve(levels[i].size());
+            for (auto* node : levels[i]) {
+                if (!reuse_hash(node)) list.emplace_back(node);
+            }
             std::vector<uint64_t> hash_values;
             std::vector<std::future<uint64_t>> thread_tasks;
             thread_tasks.reserve(list.size());
@@ -433,6 +448,7 @@ void hash_generators_context(Context* context, Generator* root, HashStrategy str
                 auto const& node = list[j];
                 auto const hash = hash_values[j];
                 context->add_hash(node, hash);
+                node->clear_dirty(DirtyState::Hash);
             }
         }
     }
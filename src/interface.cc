@@ -2,11 +2,42 @@
 
 #include "except.hh"
 #include "fmt/format.h"
+#include "hash.hh"
 
 using fmt::format;
 
 namespace kratos {
 
+uint64_t IDefinition::hash() const {
+    auto value = hash_.load();
+    if (value) return value;
+    // we only hash the structure of the definition, i.e. the same information
+    // that's used to compare definitions in codegen. names are ordered since
+    // ports() and vars() return ordered sets
+    auto const port_names = ports();
+    auto const var_names = vars();
+    std::vector<uint64_t> values;
+    values.reserve(port_names.size() + var_names.size() + 1);
+    values.emplace_back(port_names.size());
+    for (auto const& port_name : port_names) {
+        auto const& [width, size, dir, type] = port(port_name);
+        auto entry = ::format("{0}:{1}:{2}:{3}:{4}", port_name, width,
+                              fmt::join(size.begin(), size.end(), ","), static_cast<int>(dir),
+                              static_cast<int>(type));
+        values.emplace_back(hash_64_fnv1a(entry.c_str(), entry.size()));
+    }
+    for (auto const& var_name : var_names) {
+        auto const& [width, size] = var(var_name);
+        auto entry =
+            ::format("{0}:{1}:{2}", var_name, width, fmt::join(size.begin(), size.end(), ","));
+        values.emplace_back(hash_64_fnv1a(entry.c_str(), entry.size()));
+    }
+    value = hash_64_fnv1a(values.data(), values.size() * sizeof(uint64_t));
+    // it's fine if multiple threads race here since they all compute the same value
+    hash_.store(value);
+    return value;
+}
+
 std::shared_ptr<InterfaceModPortDefinition> InterfaceDefinition::create_modport_def(
     const std::string& name) {
     if (mod_ports_.find(name) != mod_ports_.end())
@@ -33,6 +64,7 @@ std::string InterfaceDefinition::port(const std::string& name, uint32_t width,
     if (ports_.find(name) != ports_.end())
         throw UserException(::format("{0} already exists in {1}", name, name_));
     ports_.emplace(name, std::make_tuple(width, size, dir, type));
+    invalidate_hashes();
     return name;
 }
 
@@ -59,6 +91,7 @@ std::string InterfaceDefinition::var(const std::string& name, uint32_t width,
     if (vars_.find(name) != vars_.end())
         throw UserException(::format("{0} already exists in {1}", name, name_));
     vars_.emplace(name, std::make_pair(width, size));
+    invalidate_hashes();
     return name;
 }
 
@@ -80,6 +113,12 @@ InterfaceDefinition::InterfaceVarDef InterfaceDefinition::var(const std::string&
     return vars_.at(name);
 }
 
+void InterfaceDefinition::invalidate_hashes() {
+    invalidate_hash();
+    // modports derive their port definitions from us
+    for (auto const& iter : mod_ports_) iter.second->invalidate_hash();
+}
+
 bool InterfaceDefinition::has_port(const std::string& name) const {
     return ports_.find(name) != ports_.end();
 }
@@ -106,6 +145,7 @@ void InterfaceModPortDefinition::set_output(const std::string& name) {
         // this is a variable
         outputs_.emplace(name);
     }
+    invalidate_hash();
 }
 
 IDefinition::InterfacePortDef InterfaceModPortDefinition::port(const std::string& name) const {
@@ -148,6 +188,7 @@ void InterfaceModPortDefinition::set_input(const std::string& name) {
         // this is a variable
         inputs_.emplace(name);
     }
+    invalidate_hash();
 }
 
 std::string InterfaceModPortDefinition::def_name() const {
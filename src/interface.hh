@@ -1,6 +1,8 @@
 #ifndef KRATOS_INTERFACE_HH
 #define KRATOS_INTERFACE_HH
 
+#include <atomic>
+
 #include "expr.hh"
 #include "port.hh"
 
@@ -24,7 +26,17 @@ public:
 
     [[nodiscard]] virtual bool is_modport() const { return false; }
 
+    // structural signature of the definition, computed once and cached until the
+    // definition changes. definitions with different hashes are never identical
+    [[nodiscard]] uint64_t hash() const;
+    void invalidate_hash() { hash_ = 0; }
+
     virtual ~IDefinition() = default;
+
+private:
+    // 0 means the signature has not been computed yet. it's atomic since
+    // passes may query it from multiple threads
+    mutable std::atomic<uint64_t> hash_{0};
 };
 
 struct InterfaceDefinition : public IDefinition, std::enable_shared_from_this<InterfaceDefinition> {
@@ -72,6 +84,8 @@ private:
     std::map<std::string, IDefinition::InterfacePortDef> ports_;
     std::map<std::string, IDefinition::InterfaceVarDef> vars_;
     std::map<std::string, std::shared_ptr<InterfaceModPortDefinition>> mod_ports_;
+
+    void invalidate_hashes();
 };
 
 struct InterfaceModPortDefinition : public IDefinition {
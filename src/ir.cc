@@ -1,5 +1,7 @@
 #include "ir.hh"
 
+#include <mutex>
+
 #include "cxxpool.h"
 #include "generator.hh"
 #include "graph.hh"
@@ -7,6 +9,59 @@
 
 namespace kratos {
 
+namespace {
+std::mutex attribute_key_mutex;
+
+std::unordered_map<std::string, uint32_t> &attribute_keys() {
+    static std::unordered_map<std::string, uint32_t> keys;
+    return keys;
+}
+}  // namespace
+
+uint32_t register_attribute_key(const std::string &name) {
+    std::lock_guard guard(attribute_key_mutex);
+    auto &keys = attribute_keys();
+    auto iter = keys.find(name);
+    if (iter != keys.end()) return iter->second;
+    auto id = static_cast<uint32_t>(keys.size());
+    keys.emplace(name, id);
+    return id;
+}
+
+uint32_t num_attribute_keys() {
+    std::lock_guard guard(attribute_key_mutex);
+    return static_cast<uint32_t>(attribute_keys().size());
+}
+
+namespace {
+std::mutex attribute_string_mutex;
+
+std::unordered_map<std::string, std::weak_ptr<const std::string>> &attribute_strings() {
+    // never destroyed, since nodes may release their strings during static destruction
+    static auto *strings = new std::unordered_map<std::string, std::weak_ptr<const std::string>>();
+    return *strings;
+}
+}  // namespace
+
+std::shared_ptr<const std::string> intern_attribute_string(const std::string &value) {
+    std::lock_guard guard(attribute_string_mutex);
+    auto &entry = attribute_strings()[value];
+    auto result = entry.lock();
+    if (result) return result;
+    result = std::shared_ptr<const std::string>(new std::string(value), [](const std::string *str) {
+        {
+            std::lock_guard guard(attribute_string_mutex);
+            auto &strings = attribute_strings();
+            auto iter = strings.find(*str);
+            // the string may have been interned again in the meantime
+            if (iter != strings.end() && iter->second.expired()) strings.erase(iter);
+        }
+        delete str;
+    });
+    entry = result;
+    return result;
+}
+
 uint64_t IRNode::index_of(kratos::IRNode *node) {
     uint64_t index;
     for (index = 0; index < child_count(); index++) {
@@ -40,6 +95,8 @@ void IRVisitor::visit_root(IRNode *root) {
 }
 
 void IRVisitor::visit_generator_root(Generator *generator) {
+    // nothing changed in the entire subtree since the last incremental run
+    if (generator->skip_incremental()) return;
     auto children = generator->get_child_generators();
     generator->accept_generator(this);
     level++;
@@ -48,17 +105,19 @@ void IRVisitor::visit_generator_root(Generator *generator) {
 }
 
 void IRVisitor::visit_generator_root_p(kratos::Generator *generator) {
-    GeneratorGraph graph(generator);
-    auto levels = graph.get_leveled_generators();
+    // the graph is a snapshot, so the visitor is free to change the hierarchy
+    auto graph = generator_hierarchy(generator);
+    auto const &levels = graph->get_leveled_generators();
     uint32_t num_cpus = get_num_cpus();
     cxxpool::thread_pool pool{num_cpus};
     for (int i = static_cast<int>(levels.size() - 1); i >= 0; i--) {
         level = static_cast<uint32_t>(i);
         pool.clear();
-        auto current_level = levels[i];
+        auto const &current_level = levels[i];
         std::vector<std::future<void>> tasks;
         tasks.reserve(current_level.size());
         for (auto *mod : current_level) {
+            if (mod->skip_incremental()) continue;
             auto t = pool.push([=](Generator *g) { g->accept_generator(this); }, mod);
             tasks.emplace_back(std::move(t));
         }
@@ -80,9 +139,11 @@ void IRVisitor::visit_content(Generator *generator) {
         }
     }
     // visit the vars
-    auto var_names = generator->get_all_var_names();
-    for (auto const &name : var_names) {
-        auto var = generator->get_var(name);
+    // the visitor may add or remove vars
+    std::vector<std::shared_ptr<Var>> vars;
+    vars.reserve(generator->vars().size());
+    for (auto const &iter : generator->vars()) vars.emplace_back(iter.second);
+    for (auto const &var : vars) {
         auto *ptr = var.get();
         if (visited_.find(ptr) == visited_.end()) {
             visited_.emplace(ptr);
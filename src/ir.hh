@@ -2,6 +2,7 @@
 #define KRATOS_IR_HH
 
 #include <cstdint>
+#include <variant>
 #include <vector>
 
 #include "context.hh"
@@ -25,6 +26,34 @@ private:
     std::shared_ptr<void> target_ = nullptr;
 };
 
+// typed attributes used by passes internally. every key is registered once and
+// gets a small index, which is used to look up the attribute slot on a node in
+// constant time. string-based Attribute is kept for user annotations
+uint32_t register_attribute_key(const std::string &name);
+uint32_t num_attribute_keys();
+// equal strings share a single copy, which is released with the last slot holding it
+std::shared_ptr<const std::string> intern_attribute_string(const std::string &value);
+
+// every supported value fits into the slot itself
+using AttributeValue = std::variant<std::monostate, bool, int32_t, uint32_t, int64_t, uint64_t,
+                                    double, std::shared_ptr<const std::string>>;
+
+template <typename T>
+class AttributeKey {
+    static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int32_t> ||
+                      std::is_same_v<T, uint32_t> || std::is_same_v<T, int64_t> ||
+                      std::is_same_v<T, uint64_t> || std::is_same_v<T, double> ||
+                      std::is_same_v<T, std::string>,
+                  "Unsupported attribute type");
+
+public:
+    explicit AttributeKey(const std::string &name) : id_(register_attribute_key(name)) {}
+    [[nodiscard]] uint32_t id() const { return id_; }
+
+private:
+    uint32_t id_;
+};
+
 struct IRNode {
 public:
     explicit IRNode(IRNodeKind type) : ast_node_type_(type) {}
@@ -56,11 +85,46 @@ public:
     }
     [[nodiscard]] bool has_attribute(const std::string &value_str) const;
 
+    // typed attributes. values are stored inline without any allocation
+    template <typename T>
+    void set_attribute(const AttributeKey<T> &key, const T &value) {
+        if (key.id() >= typed_attributes_.size()) typed_attributes_.resize(key.id() + 1);
+        if constexpr (std::is_same_v<T, std::string>) {
+            typed_attributes_[key.id()] = intern_attribute_string(value);
+        } else {
+            typed_attributes_[key.id()] = value;
+        }
+    }
+    template <typename T>
+    [[nodiscard]] const T *get_attribute(const AttributeKey<T> &key) const {
+        if (key.id() >= typed_attributes_.size()) return nullptr;
+        auto const &slot = typed_attributes_[key.id()];
+        if constexpr (std::is_same_v<T, std::string>) {
+            auto const *value = std::get_if<std::shared_ptr<const std::string>>(&slot);
+            return value ? value->get() : nullptr;
+        } else {
+            return std::get_if<T>(&slot);
+        }
+    }
+    template <typename T>
+    [[nodiscard]] bool has_attribute(const AttributeKey<T> &key) const {
+        return key.id() < typed_attributes_.size() &&
+               !std::holds_alternative<std::monostate>(typed_attributes_[key.id()]);
+    }
+    template <typename T>
+    void remove_attribute(const AttributeKey<T> &key) {
+        if (key.id() < typed_attributes_.size()) typed_attributes_[key.id()] = std::monostate{};
+    }
+    [[nodiscard]] const std::vector<AttributeValue> &typed_attributes() const {
+        return typed_attributes_;
+    }
+
     virtual ~IRNode() = default;
 
 private:
     IRNodeKind ast_node_type_;
     std::vector<std::shared_ptr<Attribute>> attributes_;
+    std::vector<AttributeValue> typed_attributes_;
 };
 
 class IRVisitor {
@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "except.hh"
+#include "pass.hh"
 #include "stmt.hh"
 #include "util.hh"
 
@@ -55,10 +56,7 @@ SinglePortSRAM::SinglePortSRAM(kratos::Context *context, const std::string &stub
     // generating the actual logic
     auto block = sequential();
     // no assignment type check here
-    auto attr = std::make_shared<Attribute>();
-    attr->type_str = "check_assignment";
-    attr->value_str = "false";
-    block->add_attribute(attr);
+    block->set_attribute(check_assignment_attribute, false);
     block->add_condition({BlockEdgeType::Posedge, clk_});
     // active low for now
     auto chip_en_if = std::make_shared<IfStmt>(chip_enable_->r_not());
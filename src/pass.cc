@@ -8,6 +8,7 @@
 #include <numeric>
 
 #include "codegen.hh"
+#include "cxxpool.h"
 #include "debug.hh"
 #include "event.hh"
 #include "except.hh"
@@ -17,23 +18,30 @@
 #include "graph.hh"
 #include "interface.hh"
 #include "port.hh"
+#include "sim.hh"
+#include "summary.hh"
 #include "syntax.hh"
 #include "tb.hh"
+#include "timing.hh"
 #include "util.hh"
+#include "visitor.hh"
 
 using fmt::format;
 using std::runtime_error;
 
 namespace kratos {
 
+const AttributeKey<std::string> ssa_trigger_attribute("ssa-trigger");
+const AttributeKey<bool> check_assignment_attribute("check_assignment");
+
 std::map<uint32_t, std::vector<std::pair<std::string, uint32_t>>> extract_debug_info_gen(
     Generator* top);
 
-class AssignmentTypeVisitor : public IRVisitor {
+class AssignmentTypeVisitor : public StmtVisitor<AssignmentTypeVisitor> {
 public:
     explicit AssignmentTypeVisitor(AssignmentType type, bool check_type = true)
         : type_(type), check_type_(check_type) {}
-    void visit(AssignStmt* stmt) override {
+    void visit(AssignStmt* stmt) {
         if (stmt->assign_type() == AssignmentType::Undefined) {
             stmt->set_assign_type(type_);
         } else if (check_type_ && stmt->assign_type() != type_) {
@@ -49,24 +57,28 @@ private:
     bool check_type_;
 };
 
-class AssignmentTypeBlockVisitor : public IRVisitor {
-    void visit(CombinationalStmtBlock* block) override {
+class AssignmentTypeBlockVisitor : public StmtVisitor<AssignmentTypeBlockVisitor> {
+public:
+    void visit(CombinationalStmtBlock* block) {
         AssignmentTypeVisitor visitor(AssignmentType::Blocking, true);
-        visitor.visit_root(block->ast_node());
+        visitor.visit_stmt(block);
     }
-    void visit(SequentialStmtBlock* block) override {
+    void visit(SequentialStmtBlock* block) {
         // attribute-based override
+        auto const* check = block->get_attribute(check_assignment_attribute);
+        if (check && !*check) return;
+        // user annotations from the front-end
         auto const& attributes = block->get_attributes();
         for (auto const& attr : attributes) {
             if (attr->type_str == "check_assignment" && attr->value_str == "false") return;
         }
         AssignmentTypeVisitor visitor(AssignmentType::NonBlocking, true);
-        visitor.visit_root(block->ast_node());
+        visitor.visit_stmt(block);
     }
 
-    void visit(FunctionStmtBlock* block) override {
+    void visit(FunctionStmtBlock* block) {
         AssignmentTypeVisitor visitor(AssignmentType::Blocking, true);
-        visitor.visit_root(block->ast_node());
+        visitor.visit_stmt(block);
     }
 };
 
@@ -74,16 +86,15 @@ void fix_assignment_type(Generator* top) {
     // first we fix all the block assignment
     AssignmentTypeBlockVisitor visitor;
     visitor.visit_root(top);
-    visitor.visit_generator_root(top);
 
     // then we assign any existing assignment as blocking assignment
     AssignmentTypeVisitor final_visitor(AssignmentType::Blocking, false);
-    final_visitor.visit_root(top->ast_node());
+    final_visitor.visit_root(top);
 }
 
-class VerifyAssignmentVisitor : public IRVisitor {
+class VerifyAssignmentVisitor : public StmtVisitor<VerifyAssignmentVisitor> {
 public:
-    void visit(AssignStmt* stmt) override {
+    void visit(AssignStmt* stmt) {
         auto* const left = stmt->left();
         auto* right = stmt->right();
         // if the right hand side is a const and it's safe to do so, we will let it happen
@@ -114,10 +125,8 @@ public:
         check_expr(right, stmt);
     }
 
-    void visit(Generator* generator) override {
-        auto vars = generator->get_all_var_names();
-        for (auto const& var_name : vars) {
-            auto var = generator->get_var(var_name);
+    void visit(Generator* generator) {
+        for (auto const& [var_name, var] : generator->vars()) {
             check_var(var.get());
         }
     }
@@ -195,13 +204,12 @@ void verify_assignments(Generator* top) {
 class VarUnusedVisitor : public IRVisitor {
 public:
     void visit(Generator* generator) override {
-        std::set<std::string> vars_to_remove;
-        auto vars = generator->vars();
-        for (auto const& [var_name, var] : vars) {
+        // the iteration is not affected by removing the var it's on
+        for (auto const& [var_name, var] : generator->vars()) {
             if (var->type() != VarType::Base || var->is_interface()) continue;
             if (var->sinks().empty()) {
                 if (var->sources().empty() && !var->is_interface()) {
-                    vars_to_remove.emplace(var_name);
+                    generator->remove_var(var_name);
                 } else {
                     // print out warnings
                     error_mutex_.lock();
@@ -211,11 +219,6 @@ public:
                 }
             }
         }
-
-        // remove unused vars
-        for (auto const& var_name : vars_to_remove) {
-            generator->remove_var(var_name);
-        }
     }
 
 private:
@@ -253,96 +256,54 @@ void remove_unused_stmts(Generator* top) {
     visitor.visit_generator_root(top);
 }
 
-bool connected(const std::shared_ptr<Port>& port, std::unordered_set<uint32_t>& bits) {
-    bool result = false;
-    bits.reserve(port->width());
-    if (!port->sources().empty()) {
-        // it has been assigned. need to compute all the slices
-        auto sources = port->sources();
-        for (const auto& stmt : sources) {
-            auto* src = stmt->left();
-            if (src->type() == VarType::Slice) {
-                auto ptr = src->as<VarSlice>();
-                auto* ptr_parent = ptr->get_var_root_parent();
-                uint32_t high, low;
-                if (ptr_parent != port.get()) {
-                    // it got be a sliced by var
-                    if (!ptr->sliced_by_var())
-                        throw VarException("Internal error. Variable has un-related sources",
-                                           {port.get()});
-                    // it's actually not driven by the current net
-                    continue;
-                } else {
-                    if (ptr->sliced_by_var()) {
-                        // possibly to hit all bits
-                        low = 0;
-                        high = port->width() - 1;
-                    } else {
-                        low = ptr->var_low();
-                        high = ptr->var_high();
-                    }
-                }
-                for (uint32_t i = low; i <= high; i++) {
-                    bits.emplace(i);
-                }
-            } else {
-                result = true;
-                for (uint32_t i = 0; i < port->width(); i++) bits.emplace(i);
-                break;
-            }
-        }
-    }
-    if (result && bits.size() != port->width()) result = false;
-    return result;
-}
-
 class GeneratorConnectivityVisitor : public IRVisitor {
 public:
-    GeneratorConnectivityVisitor() = default;
+    GeneratorConnectivityVisitor(Generator* top, const ModuleSummaries& summaries)
+        : top_(top), summaries_(summaries) {}
 
     void visit(Generator* generator) override {
         // skip if it's an external module or stub module
         if (generator->external() || generator->is_stub()) return;
+        auto const& summary = summaries_.get(generator);
         const auto& port_names = generator->get_port_names();
         for (const auto& port_name : port_names) {
             auto const& port = generator->get_port(port_name);
 
             // based on whether it's an input or output
             // for inputs, if it's not top generator, we need to check if
-            // something is driving it
+            // something is driving it. outputs are driven within the module
+            // so we can use the module summary
+            BitRanges bits;
             if (port->port_direction() == PortDirection::In) {
-                if (is_top_level_) continue;
+                if (generator == top_) continue;
+                bits = driven_bits(port.get());
+            } else {
+                bits = summary.ports.at(port_name).driven_bits;
             }
 
-            std::unordered_set<uint32_t> bits;
-            bool has_error = !connected(port, bits);
-
-            if (has_error) {
+            auto floating = undriven_bits(bits, port->width());
+            if (!floating.empty()) {
                 std::vector<Stmt*> stmt_list;
                 for (auto const& stmt : port->sources()) {
                     stmt_list.emplace_back(stmt.get());
                 }
-                for (uint32_t i = 0; i < port->width(); i++) {
-                    if (bits.find(i) == bits.end()) {
-                        throw StmtException(
-                            ::format("{0}[{1}] is a floating net. Please check your connections",
-                                     port->handle_name(), i),
-                            stmt_list.begin(), stmt_list.end());
-                    }
-                }
+                throw StmtException(
+                    ::format("{0}[{1}] is a floating net. Please check your connections",
+                             port->handle_name(), floating.front().first),
+                    stmt_list.begin(), stmt_list.end());
             }
         }
-
-        is_top_level_ = false;
     }
 
 private:
-    bool is_top_level_ = true;
+    Generator* top_;
+    const ModuleSummaries& summaries_;
 };
 
 void verify_generator_connectivity(Generator* top) {
-    GeneratorConnectivityVisitor visitor;
-    visitor.visit_generator_root(top);
+    ModuleSummaries summaries(top);
+    GeneratorConnectivityVisitor visitor(top, summaries);
+    visitor.visit_generator_root_p(top);
 }
 
 class ZeroGeneratorInputVisitor : public IRVisitor {
@@ -369,77 +330,51 @@ public:
                 for (auto const& port_name : port_names) {
                     auto port = gen->get_port(port_name);
                     if (port->port_direction() == PortDirection::Out) continue;
-                    std::unordered_set<uint32_t> bits;
-                    bool is_connected = connected(port, bits);
-                    if (!is_connected) {
-                        // notice that we can two choices here:
-                        // bit wiring and bulk wiring
-                        // we will implement bulk wiring here since the merge wiring pass is not
-                        // complete at the time of implementation
-                        // compute the set difference
-                        std::vector<uint32_t> diff_bits;
-                        for (uint32_t i = 0; i < port->width(); i++) {
-                            if (bits.find(i) == bits.end()) {
-                                // no need to sort the bits since we're going in order
-                                // so it's already sorted.
-                                diff_bits.emplace_back(i);
-                            }
-                        }
-                        // we will connect the size 1 easily
-                        // however, if it's an array and sliced in a weird way, there is nothing
-                        // easy we can do. for now we will throw an exception
-                        // maximum the slices range
-                        uint32_t low = diff_bits[0];
-                        uint32_t high = low;
-                        uint32_t pre_high = high;
-
-                        // lambda functions to handle the situation
-                        std::function<void(uint32_t, uint32_t)> wire_zero = [=](uint32_t h,
-                                                                                uint32_t l) {
-                            uint32_t ll, hh;
-                            if (port->size().size() == 1 && port->size().front() == 1) {
-                                ll = l;
-                                hh = h;
-                            } else {
-                                if (l % port->var_width() || (h + 1) % port->var_width()) {
-                                    // can't handle it right now
-                                    auto stmts = std::vector<Stmt*>();
-                                    stmts.reserve(port->sources().size());
-                                    for (auto const& stmt : port->sources()) {
-                                        stmts.emplace_back(stmt.get());
-                                    }
-                                    throw StmtException(
-                                        "Cannot fix up unpacked array due to irregular slicing",
-                                        stmts.begin(), stmts.end());
+                    // notice that we can two choices here:
+                    // bit wiring and bulk wiring
+                    // we will implement bulk wiring here since the merge wiring pass is not
+                    // complete at the time of implementation
+                    auto diff_bits = undriven_bits(driven_bits(port.get()), port->width());
+                    if (diff_bits.empty()) continue;
+                    // we will connect the size 1 easily
+                    // however, if it's an array and sliced in a weird way, there is nothing
+                    // easy we can do. for now we will throw an exception
+                    // lambda functions to handle the situation
+                    std::function<void(uint32_t, uint32_t)> wire_zero = [=](uint32_t h,
+                                                                            uint32_t l) {
+                        uint32_t ll, hh;
+                        if (port->size().size() == 1 && port->size().front() == 1) {
+                            ll = l;
+                            hh = h;
+                        } else {
+                            if (l % port->var_width() || (h + 1) % port->var_width()) {
+                                // can't handle it right now
+                                auto stmts = std::vector<Stmt*>();
+                                stmts.reserve(port->sources().size());
+                                for (auto const& stmt : port->sources()) {
+                                    stmts.emplace_back(stmt.get());
                                 }
-                                // compute the low and high
-                                ll = l / port->var_width();
-                                hh = h / port->var_width();
-                            }
-                            std::shared_ptr<AssignStmt> stmt;
-                            // a special case is that the port is not connected at all!
-                            if (ll == 0 && hh == (port->width() - 1)) {
-                                stmt = port->assign(constant(0, port->width(), port->is_signed()));
-                            } else {
-                                auto& slice = port->operator[]({hh, ll});
-                                stmt = slice.assign(constant(0, slice.width(), slice.is_signed()));
-                            }
-                            stmt->fn_name_ln.emplace_back(std::make_pair(__FILE__, __LINE__));
-                            gen->add_stmt(stmt);
-                        };
-
-                        for (auto const bit : diff_bits) {
-                            high = bit;
-                            if (high - pre_high > 1) {
-                                // there is a gap
-                                wire_zero(pre_high, low);
-                                low = high;
-                                pre_high = low;
-                            } else {
-                                pre_high = high;
+                                throw StmtException(
+                                    "Cannot fix up unpacked array due to irregular slicing",
+                                    stmts.begin(), stmts.end());
                             }
+                            // compute the low and high
+                            ll = l / port->var_width();
+                            hh = h / port->var_width();
+                        }
+                        std::shared_ptr<AssignStmt> stmt;
+                        // a special case is that the port is not connected at all!
+                        if (ll == 0 && hh == (port->width() - 1)) {
+                            stmt = port->assign(constant(0, port->width(), port->is_signed()));
+                        } else {
+                            auto& slice = port->operator[]({hh, ll});
+                            stmt = slice.assign(constant(0, slice.width(), slice.is_signed()));
                         }
-                        // the last bit
+                        stmt->fn_name_ln.emplace_back(std::make_pair(__FILE__, __LINE__));
+                        gen->add_stmt(stmt);
+                    };
+
+                    for (auto const& [low, high] : diff_bits) {
                         wire_zero(high, low);
                     }
                 }
@@ -546,6 +481,34 @@ void track_generators(Generator* top) {
     }
 }
 
+std::string generate_module_verilog(Generator* generator, const std::string& package_name,
+                                   const std::string& header_filename) {
+    auto* context = generator->context();
+    if (!context || !context->incremental()) {
+        SystemVerilogCodeGen codegen(generator, package_name, header_filename);
+        return codegen.str();
+    }
+    // the options change the module header
+    auto options = package_name + "/" + header_filename;
+    if (auto const* src = generator->cached_verilog(options)) return *src;
+    SystemVerilogCodeGen codegen(generator, package_name, header_filename);
+    auto src = codegen.str();
+    generator->set_cached_verilog(options, src);
+    return src;
+}
+
+class ClearIncrementalVisitor : public IRVisitor {
+public:
+    void visit(Generator* generator) override { generator->clear_dirty(DirtyState::Passes); }
+};
+
+void finish_incremental(Generator* top) {
+    // every change has been processed by the pass pipeline once the verilog is generated
+    if (!top->context() || !top->context()->incremental()) return;
+    ClearIncrementalVisitor visitor;
+    visitor.visit_generator_root(top);
+}
+
 std::map<std::string, std::string> generate_verilog(Generator* top) {
     // this pass assumes that all the generators has been uniquified
     std::map<std::string, std::string> result;
@@ -555,10 +518,10 @@ std::map<std::string, std::string> generate_verilog(Generator* top) {
     unique_visitor.visit_generator_root(top);
     auto const& generator_map = unique_visitor.generator_map();
     for (const auto& [module_name, module_gen] : generator_map) {
-        SystemVerilogCodeGen codegen(module_gen);
-        result.emplace(module_name, codegen.str());
+        result.emplace(module_name, generate_module_verilog(module_gen, "", ""));
     }
     track_generators(top);
+    finish_incremental(top);
     return result;
 }
 
@@ -581,9 +544,10 @@ void generate_verilog(Generator* top, const std::string& output_dir,
     std::string header_filename = package_name + ".svh";
     std::map<std::string, std::string> result;
     for (const auto& [module_name, module_gen] : generator_map) {
-        SystemVerilogCodeGen codegen(module_gen, package_name, header_filename);
-        result.emplace(module_name, codegen.str());
+        result.emplace(module_name,
+                       generate_module_verilog(module_gen, package_name, header_filename));
     }
+    finish_incremental(top);
     // write out the content to the output_dir
     // we assume output_dir already exists
     // notice that if the content is the same, we don't override to avoid modifying the timestamps
@@ -668,12 +632,25 @@ void hash_generators(Generator* top, HashStrategy strategy) {
 void uniquify_generators(Generator* top) {
     // we assume users has run the hash_generators function
     Context* context = top->context();
+    // the module sets are ordered by address. visit the generators parents first and in
+    // instance order instead, so the new names don't depend on where they are allocated
+    std::unordered_map<const Generator*, uint64_t> order;
+    auto graph = generator_hierarchy(top);
+    for (auto const& level : graph->get_leveled_generators()) {
+        for (auto* gen : level) order.emplace(gen, order.size());
+    }
+    auto rank = [&](const Generator* gen) {
+        auto iter = order.find(gen);
+        return iter == order.end() ? order.size() : iter->second;
+    };
     auto const& names = context->get_generator_names();
     for (auto const& name : names) {
         auto const module_sets = context->get_generators_by_name(name);
         std::vector<Generator*> module_instances;
         module_instances.reserve(module_sets.size());
         for (auto const& m : module_sets) module_instances.emplace_back(m.get());
+        std::stable_sort(module_instances.begin(), module_instances.end(),
+                         [&](auto* a, auto* b) { return rank(a) < rank(b); });
         // notice that since it is a set copied by value, it is fine to iterate through it
         if (module_instances.size() == 1)
             // only one module. we are good
@@ -1057,14 +1034,17 @@ void check_non_synthesizable_content(Generator* top) {
     }
 }
 
-class ActiveVisitor : public IRVisitor {
+class ActiveVisitor : public StmtVisitor<ActiveVisitor> {
     // we can be very clever about how to detect the wrong negative
-    // 1. we determine the activate low or high from the sequential conditions
+    // 1. we determine the activate low or high from the sequential conditions, which is
+    //    summarized per module
     // 2. whenever we meet a if reset statement, we check it against it
     //    because if the async reset is used properly, we will determine the port type first first
     //    if the port is used as an sync reset, the port active type will be undefined.
 public:
-    void visit(IfStmt* stmt) override {
+    explicit ActiveVisitor(const ModuleSummary& summary) : reset_map_(summary.resets) {}
+
+    void visit(IfStmt* stmt) {
         auto predicate = stmt->predicate();
         // notice this just catch some simple mistakes
         // thus is designed to be zero false negative
@@ -1078,7 +1058,7 @@ public:
                         ::format("{0} is used has a synchronous reset", port->to_string()),
                         {port, stmt});
                 }
-                bool reset_high = reset_map_.at(port);
+                bool reset_high = reset_map_.at(port).active_high;
                 if (!reset_high)
                     throw VarException("Active low signal used as active high", {port, stmt});
             } else if (port->port_type() == PortType::Reset) {
@@ -1101,7 +1081,7 @@ public:
                                 ::format("{0} is used has a synchronous reset", port->to_string()),
                                 {port.get(), stmt});
                         }
-                        bool reset_high = reset_map_.at(port.get());
+                        bool reset_high = reset_map_.at(port.get()).active_high;
                         if (reset_high) {
                             throw VarException("Active high signal used as active low",
                                                {port.get(), stmt});
@@ -1119,7 +1099,7 @@ public:
         }
     }
 
-    void visit(SequentialStmtBlock* stmt) override {
+    void visit(SequentialStmtBlock* stmt) {
         auto const& sensitivity = stmt->get_conditions();
         for (auto const& [t, v] : sensitivity) {
             if (v->type() == VarType::PortIO) {
@@ -1137,17 +1117,12 @@ public:
                                 {port, stmt});
                         }
                     }
-                    if (reset_map_.find(port) != reset_map_.end()) {
-                        // check consistency
-                        if (reset_map_.at(port) != reset_high) {
-                            throw VarException(
-                                ::format("Inconsistent active low/high usage for {0}",
-                                         port->to_string()),
-                                {port, stmt, get_reset_stmt(port)});
-                        }
-                    } else {
-                        reset_map_.emplace(std::make_pair(port, reset_high));
-                        reset_map_.emplace(std::make_pair(port, stmt));
+                    // check consistency against the first usage
+                    if (reset_map_.at(port).active_high != reset_high) {
+                        throw VarException(
+                            ::format("Inconsistent active low/high usage for {0}",
+                                     port->to_string()),
+                            {port, stmt, get_reset_stmt(port)});
                     }
                 } else if (port->port_type() == PortType::Reset) {
                     throw VarException(
@@ -1160,25 +1135,40 @@ public:
     }
 
 private:
-    std::unordered_map<Port*, bool> reset_map_;
-    std::unordered_map<Port*, Stmt*> reset_stmt_;
+    const std::unordered_map<const Port*, ResetSummary>& reset_map_;
 
     Stmt* get_reset_stmt(Port* port) const {
-        if (reset_stmt_.find(port) != reset_stmt_.end()) return reset_stmt_.at(port);
+        if (reset_map_.find(port) != reset_map_.end()) return reset_map_.at(port).stmt;
         return nullptr;
     }
 };
 
+class ActiveHighVisitor : public IRVisitor {
+public:
+    explicit ActiveHighVisitor(const ModuleSummaries& summaries) : summaries_(summaries) {}
+
+    void visit(Generator* generator) override {
+        // clones don't have any content
+        if (generator->external()) return;
+        ActiveVisitor visitor(summaries_.get(generator));
+        visitor.visit_content(generator);
+    }
+
+private:
+    const ModuleSummaries& summaries_;
+};
+
 void check_active_high(Generator* top) {
-    ActiveVisitor visitor;
-    visitor.visit_root(top);
+    ModuleSummaries summaries(top);
+    ActiveHighVisitor visitor(summaries);
+    visitor.visit_generator_root_p(top);
 }
 
-class TransformIfCase : public IRVisitor {
+class TransformIfCase : public StmtVisitor<TransformIfCase> {
 public:
-    void visit(CombinationalStmtBlock* stmts) override { transform_block(stmts); }
-    void visit(SequentialStmtBlock* stmts) override { transform_block(stmts); }
-    void visit(ScopedStmtBlock* stmts) override { transform_block(stmts); }
+    void visit(CombinationalStmtBlock* stmts) { transform_block(stmts); }
+    void visit(SequentialStmtBlock* stmts) { transform_block(stmts); }
+    void visit(ScopedStmtBlock* stmts) { transform_block(stmts); }
 
 private:
     void static transform_block(StmtBlock* stmts) {
@@ -1273,11 +1263,11 @@ void transform_if_to_case(Generator* top) {
     visitor.visit_root(top);
 }
 
-class MergeIfVisitor : public IRVisitor {
+class MergeIfVisitor : public StmtVisitor<MergeIfVisitor> {
 public:
-    void visit(CombinationalStmtBlock* stmts) override { transform_block(stmts); }
-    void visit(SequentialStmtBlock* stmts) override { transform_block(stmts); }
-    void visit(ScopedStmtBlock* stmts) override { transform_block(stmts); }
+    void visit(CombinationalStmtBlock* stmts) { transform_block(stmts); }
+    void visit(SequentialStmtBlock* stmts) { transform_block(stmts); }
+    void visit(ScopedStmtBlock* stmts) { transform_block(stmts); }
 
 private:
     using IfStmtType = std::pair<std::shared_ptr<IfStmt>, std::shared_ptr<Const>>;
@@ -1286,7 +1276,8 @@ private:
     // if target is the same
     // all equality comparison and against an constant
     void static transform_block(StmtBlock* block) {
-        // only run marked ones
+        // only run marked ones. it's a user annotation, e.g. add_always(merge_if_block=True),
+        // so it stays a string attribute
         if (!block->has_attribute("merge_if_block")) return;
         std::map<Var*, std::vector<IfStmtType>> result;
         get_targeted_if(block, result);
@@ -1364,68 +1355,164 @@ void merge_if_block(Generator* top) {
 class VarFanOutVisitor : public IRVisitor {
 public:
     void visit(Generator* generator) override {
-        auto var_names = generator->get_all_var_names();
-        for (auto const& var_name : var_names) {
-            auto var = generator->get_var(var_name);
-            std::vector<std::pair<std::shared_ptr<Var>, std::shared_ptr<AssignStmt>>> chain;
-            compute_assign_chain(var, chain);
-            if (chain.size() <= 2) continue;  // nothing to be done
+        // wires that are connected through fanout-one assignments are collected into
+        // equivalence classes with a union-find, where each class is rooted at the var
+        // the whole chain collapses into. then all the classes are collapsed at once
+        auto const& vars = generator->vars();
+        auto const num_vars = static_cast<uint64_t>(vars.size());
+        std::vector<Var*> nodes;
+        nodes.reserve(num_vars);
+        std::unordered_map<const Var*, uint64_t> index;
+        index.reserve(num_vars);
+        for (auto const& iter : vars) {
+            index.emplace(iter.second.get(), nodes.size());
+            nodes.emplace_back(iter.second.get());
+        }
+        // the next var in the chain and the assignment to it. num_vars means none
+        std::vector<uint64_t> next(num_vars, num_vars);
+        std::vector<std::shared_ptr<AssignStmt>> next_stmt(num_vars);
+        for (uint64_t i = 0; i < num_vars; i++) {
+            auto stmt = next_assignment(nodes[i]);
+            if (!stmt) continue;
+            auto iter = index.find(stmt->left());
+            if (iter == index.end()) continue;
+            next[i] = iter->second;
+            next_stmt[i] = stmt;
+        }
+
+        auto links = compute_links(nodes, next);
+
+        // union-find. since every var links to at most one var, the parent of a var is
+        // simply the var it links to, which makes the root the destination
+        std::vector<uint64_t> parent(num_vars);
+        for (uint64_t i = 0; i < num_vars; i++) parent[i] = links[i] ? next[i] : i;
+        auto find = [&parent](uint64_t i) {
+            auto root = i;
+            while (parent[root] != root) root = parent[root];
+            while (parent[i] != root) {
+                auto n = parent[i];
+                parent[i] = root;
+                i = n;
+            }
+            return root;
+        };
+        std::unordered_map<uint64_t, std::vector<uint64_t>> classes;
+        std::vector<uint64_t> roots;
+        for (uint64_t i = 0; i < num_vars; i++) {
+            if (!links[i]) continue;
+            auto root = find(i);
+            auto& members = classes[root];
+            if (members.empty()) roots.emplace_back(root);
+            members.emplace_back(i);
+        }
+
+        std::unordered_set<std::shared_ptr<Stmt>> removed_stmts;
+        std::vector<std::shared_ptr<AssignStmt>> new_stmts;
+        for (auto const root : roots) {
+            auto const& members = classes.at(root);
+            // a single assignment is not a chain. notice that the root is not included
+            if (members.size() < 2) continue;
+            auto* dst = nodes[root];
 
             std::vector<std::pair<std::string, uint32_t>> debug_info;
-
-            for (uint64_t i = 0; i < chain.size() - 1; i++) {
-                auto& [pre, stmt] = chain[i];
-                auto next = chain[i + 1].first;
-
-                // insert debug info
+            for (auto const i : members) {
+                auto const& stmt = next_stmt[i];
                 if (generator->debug) {
                     debug_info.insert(debug_info.end(), stmt->fn_name_ln.begin(),
                                       stmt->fn_name_ln.end());
                 }
-
-                next->unassign(stmt);
+                stmt->right()->remove_sink(stmt);
+                stmt->left()->remove_source(stmt);
+                removed_stmts.emplace(stmt);
             }
 
-            auto dst = chain.back().first;
-            Var::move_src_to(var.get(), dst.get(), generator, false);
-            // if both of them are ports, we need to add a statement
-            if (var->type() == VarType::PortIO && dst->type() == VarType::PortIO) {
-                // need to add a top assign statement
-                auto stmt = dst->assign(var, AssignmentType::Blocking);
-                if (generator->debug) {
-                    // copy every vars definition over
-                    stmt->fn_name_ln = debug_info;
-                    stmt->fn_name_ln.emplace_back(__FILE__, __LINE__);
+            for (auto const i : members) {
+                auto* var = nodes[i];
+                if (var->type() == VarType::PortIO) {
+                    // ports are always at the head of the chain and their sources may
+                    // live in the parent, so we keep them connected to the destination
+                    auto stmt = dst->assign(var->shared_from_this(), AssignmentType::Blocking);
+                    if (generator->debug) {
+                        // copy every vars definition over
+                        stmt->fn_name_ln = debug_info;
+                        stmt->fn_name_ln.emplace_back(__FILE__, __LINE__);
+                    }
+                    new_stmts.emplace_back(stmt);
+                } else {
+                    Var::move_src_to(var, dst, generator, false);
                 }
-                generator->add_stmt(stmt);
             }
         }
+
+        if (removed_stmts.empty()) return;
+        auto const& stmts = generator->get_all_stmts();
+        std::vector<std::shared_ptr<Stmt>> result;
+        result.reserve(stmts.size() - removed_stmts.size());
+        for (auto const& stmt : stmts) {
+            if (removed_stmts.find(stmt) == removed_stmts.end()) result.emplace_back(stmt);
+        }
+        generator->set_stmts(result);
+        for (auto const& stmt : new_stmts) generator->add_stmt(stmt);
     }
 
-    void static compute_assign_chain(
-        const std::shared_ptr<Var>& var,
-        std::vector<std::pair<std::shared_ptr<Var>, std::shared_ptr<AssignStmt>>>& queue) {
-        if (var->sinks().size() == 1) {
-            auto const& stmt = *(var->sinks().begin());
-            if (!stmt->parent()) return;
-            if (stmt->parent()->ir_node_kind() == IRNodeKind::GeneratorKind) {
-                auto* sink_var = stmt->left();
-                if (sink_var->parent() != var->parent() || sink_var->is_interface()) {
-                    // not the same parent
-                    return;
+private:
+    // the only sink of the var if it's a plain top-level assignment to another
+    // var in the same generator
+    static std::shared_ptr<AssignStmt> next_assignment(Var* var) {
+        if (var->sinks().size() != 1) return nullptr;
+        auto const& stmt = *(var->sinks().begin());
+        if (!stmt->parent()) return nullptr;
+        if (stmt->parent()->ir_node_kind() != IRNodeKind::GeneratorKind) return nullptr;
+        auto* sink_var = stmt->left();
+        // not the same parent
+        if (sink_var->parent() != var->parent() || sink_var->is_interface()) return nullptr;
+        // FIXME: need to re-work on fanout one wire removal
+        //  For now disable the expression based search
+        if (stmt->right() != var) return nullptr;
+        return stmt;
+    }
+
+    // whether the var can be merged into the next one. the chain stops at the var
+    // that has no further fanout-one assignment, and the assignment into a var that
+    // has a single sink which can't be followed is kept. ports can only be the head or
+    // the destination of a chain. vars in a combinational loop are left alone
+    static std::vector<bool> compute_links(const std::vector<Var*>& nodes,
+                                           const std::vector<uint64_t>& next) {
+        enum class State : uint8_t { Unknown, Visiting, Linked, Unlinked };
+        auto const num_vars = static_cast<uint64_t>(nodes.size());
+        std::vector<State> states(num_vars, State::Unknown);
+        std::vector<uint64_t> path;
+        for (uint64_t i = 0; i < num_vars; i++) {
+            if (states[i] != State::Unknown) continue;
+            // walk down the chain iteratively, since it can be very long
+            path.clear();
+            auto j = i;
+            while (j != num_vars && states[j] == State::Unknown) {
+                states[j] = State::Visiting;
+                path.emplace_back(j);
+                j = next[j];
+            }
+            uint64_t loop_start = path.size();
+            if (j != num_vars && states[j] == State::Visiting) {
+                loop_start = std::find(path.begin(), path.end(), j) - path.begin();
+            }
+            for (auto k = path.size(); k > 0; k--) {
+                auto const node = path[k - 1];
+                if (k - 1 >= loop_start || next[node] == num_vars) {
+                    states[node] = State::Unlinked;
+                    continue;
                 }
-                // FIXME: need to re-work on fanout one wire removal
-                //  For now disable the expression based search
-                if (stmt->right() != var.get()) {
-                    // expr based
-                    return;
+                auto const n = next[node];
+                bool linked = nodes[n]->sinks().size() != 1 || next[n] != num_vars;
+                if (nodes[n]->type() == VarType::PortIO && states[n] == State::Linked) {
+                    linked = false;
                 }
-                queue.emplace_back(std::make_pair(var, stmt));
-                compute_assign_chain(sink_var->shared_from_this(), queue);
+                states[node] = linked ? State::Linked : State::Unlinked;
             }
-        } else {
-            queue.emplace_back(std::make_pair(var, nullptr));
         }
+        std::vector<bool> result(num_vars);
+        for (uint64_t i = 0; i < num_vars; i++) result[i] = states[i] == State::Linked;
+        return result;
     }
 };
 
@@ -1434,68 +1521,28 @@ void remove_fanout_one_wires(Generator* top) {
     visitor.visit_generator_root_p(top);
 }
 
-class RemovePassThroughVisitor : public IRVisitor {
+class PassThroughModuleVisitor : public IRVisitor {
 public:
     void visit(Generator* generator) override {
-        const auto& children = generator->get_child_generators();
-        std::vector<std::shared_ptr<Generator>> child_to_remove;
-        for (auto const& child : children) {
-            if (is_pass_through(child.get())) {
-                // need to remove it
-                child_to_remove.emplace_back(child);
-                // add it to the set
-                if (!child->is_cloned()) pass_through_.emplace(child.get());
-            }
-        }
-
-        for (auto const& child : child_to_remove) {
-            // we move the src and sinks around
-            const auto& port_names = child->get_port_names();
-            for (auto const& port_name : port_names) {
-                auto port = child->get_port(port_name);
-                if (port->port_direction() == PortDirection::In) {
-                    // move the src to whatever it's connected to
-                    // basically compress the module into a variable
-                    // we will let the later downstream passes to remove the extra wiring
-                    auto* next_port = (*(port->sinks().begin()))->left();
-                    auto var_name =
-                        generator->get_unique_variable_name(child->instance_name, port->name);
-                    auto& new_var = generator->var(var_name, port->var_width(), port->size(),
-                                                   port->is_signed());
-                    if (generator->debug) {
-                        // need to copy the changes over
-                        new_var.fn_name_ln = std::vector<std::pair<std::string, uint32_t>>(
-                            child->fn_name_ln.begin(), child->fn_name_ln.end());
-                        new_var.fn_name_ln.emplace_back(__FILE__, __LINE__);
-                    }
-                    Var::move_src_to(port.get(), &new_var, generator, false);
-                    // move the sinks over
-                    Var::move_sink_to(next_port, &new_var, generator, false);
-                }
-            }
-            // remove it from the generator children
-            generator->remove_child_generator(child->shared_from_this());
-        }
+        if (generator->is_cloned() || !is_pass_through(generator)) return;
+        std::lock_guard guard(lock_);
+        pass_through_.emplace(generator);
     }
 
+    const std::unordered_set<Generator*>& pass_through() const { return pass_through_; }
+
 private:
-    bool is_pass_through(Generator* generator) {
-        if (generator->is_cloned()) {
-            auto* ref_gen = generator->def_instance();
-            if (!ref_gen) {
-                throw GeneratorException(::format("{0} is cloned but doesn't have def instance",
-                                                  generator->instance_name),
-                                         {generator});
-            }
-            return pass_through_.find(ref_gen) != pass_through_.end();
-        }
+    std::mutex lock_;
+    std::unordered_set<Generator*> pass_through_;
+
+    static bool is_pass_through(Generator* generator) {
         const auto vars = generator->get_vars();
         // has to be empty
         if (!vars.empty()) return false;
         // has to have exact number of assignments as ports
         // ports has to be an even number, i.e. one in to one out
         // maybe we can relax this restriction later
-        auto const port_names = generator->get_port_names();
+        auto const& port_names = generator->get_port_names();
         if (port_names.size() % 2) return false;
         if (generator->stmts_count() != port_names.size() / 2) return false;
 
@@ -1503,7 +1550,7 @@ private:
         for (const auto& port_name : port_names) {
             auto const port = generator->get_port(port_name);
             if (port->port_direction() == PortDirection::In) {
-                auto sinks = port->sinks();
+                auto const& sinks = port->sinks();
                 if (sinks.size() != 1) return false;
             } else {
                 auto const& sources = port->sources();
@@ -1516,13 +1563,92 @@ private:
         }
         return true;
     }
+};
 
-    std::unordered_set<Generator*> pass_through_;
+class RemovePassThroughVisitor : public IRVisitor {
+public:
+    explicit RemovePassThroughVisitor(const std::unordered_set<Generator*>& pass_through)
+        : pass_through_(pass_through) {}
+
+    void visit(Generator* generator) override {
+        const auto& children = generator->get_child_generators();
+        std::vector<std::shared_ptr<Generator>> child_to_remove;
+        for (auto const& child : children) {
+            if (is_pass_through(child.get())) {
+                // need to remove it
+                child_to_remove.emplace_back(child);
+            }
+        }
+        if (child_to_remove.empty()) return;
+        std::lock_guard guard(lock_);
+        removals_.emplace_back(generator, std::move(child_to_remove));
+    }
+
+    // the parent and the child share the connections, so the rewiring can't be done
+    // in parallel
+    void remove_pass_through() {
+        for (auto const& [generator, children] : removals_) {
+            for (auto const& child : children) remove_child(generator, child);
+        }
+        removals_.clear();
+    }
+
+private:
+    const std::unordered_set<Generator*>& pass_through_;
+    std::mutex lock_;
+    std::vector<std::pair<Generator*, std::vector<std::shared_ptr<Generator>>>> removals_;
+
+    bool is_pass_through(Generator* generator) {
+        if (generator->is_cloned()) {
+            auto* ref_gen = generator->def_instance();
+            if (!ref_gen) {
+                throw GeneratorException(::format("{0} is cloned but doesn't have def instance",
+                                                  generator->instance_name),
+                                         {generator});
+            }
+            return pass_through_.find(ref_gen) != pass_through_.end();
+        }
+        return pass_through_.find(generator) != pass_through_.end();
+    }
+
+    static void remove_child(Generator* generator, const std::shared_ptr<Generator>& child) {
+        // we move the src and sinks around
+        const auto& port_names = child->get_port_names();
+        for (auto const& port_name : port_names) {
+            auto port = child->get_port(port_name);
+            if (port->port_direction() == PortDirection::In) {
+                // move the src to whatever it's connected to
+                // basically compress the module into a variable
+                // we will let the later downstream passes to remove the extra wiring
+                auto* next_port = (*(port->sinks().begin()))->left();
+                auto var_name =
+                    generator->get_unique_variable_name(child->instance_name, port->name);
+                auto& new_var = generator->var(var_name, port->var_width(), port->size(),
+                                               port->is_signed());
+                if (generator->debug) {
+                    // need to copy the changes over
+                    new_var.fn_name_ln = std::vector<std::pair<std::string, uint32_t>>(
+                        child->fn_name_ln.begin(), child->fn_name_ln.end());
+                    new_var.fn_name_ln.emplace_back(__FILE__, __LINE__);
+                }
+                Var::move_src_to(port.get(), &new_var, generator, false);
+                // move the sinks over
+                Var::move_sink_to(next_port, &new_var, generator, false);
+            }
+        }
+        // remove it from the generator children
+        generator->remove_child_generator(child);
+    }
 };
 
 void remove_pass_through_modules(Generator* top) {
-    RemovePassThroughVisitor visitor;
-    visitor.visit_generator_root(top);
+    // pass-through modules are identified on the original hierarchy first. the
+    // removals are collected in parallel and applied serially afterwards
+    PassThroughModuleVisitor pass_through_visitor;
+    pass_through_visitor.visit_generator_root_p(top);
+    RemovePassThroughVisitor visitor(pass_through_visitor.pass_through());
+    visitor.visit_generator_root_p(top);
+    visitor.remove_pass_through();
 }
 
 // this is only for visiting the vars and assignments in the current generator
@@ -1748,9 +1874,7 @@ std::map<Stmt*, std::string> compute_enable_condition(Generator* top) {
 class PortPackedVisitor : public IRVisitor {
 public:
     void visit(Generator* generator) override {
-        auto const& var_names = generator->get_all_var_names();
-        for (auto const& var_name : var_names) {
-            auto var = generator->get_var(var_name);
+        for (auto const& [var_name, var] : generator->vars()) {
             if (var->is_struct()) {
                 PackedStruct struct_def("", std::vector<std::tuple<std::string, uint32_t>>());
                 if (var->type() == VarType::PortIO) {
@@ -2125,8 +2249,9 @@ void merge_wire_assignments(Generator* top) {
     visitor.visit_root(top);
 }
 
-class SensitivityVisitor : public IRVisitor {
-    void visit(SequentialStmtBlock* stmt) override {
+class SensitivityVisitor : public StmtVisitor<SensitivityVisitor> {
+public:
+    void visit(SequentialStmtBlock* stmt) {
         auto const& sensitivity_list = stmt->get_conditions();
         for (auto const& iter : sensitivity_list) {
             auto const& var = iter.second;
@@ -2167,6 +2292,512 @@ void check_always_sensitivity(Generator* top) {
     visitor.visit_root(top);
 }
 
+// vars referenced by anything other than the continuous assignments the retiming is
+// allowed to rewrite. their values have to stay the same after retiming
+class RetimingReferenceVisitor : public StmtVisitor<RetimingReferenceVisitor> {
+public:
+    RetimingReferenceVisitor(const std::unordered_set<const AssignStmt*>& drivers,
+                             std::unordered_set<const Var*>& refs)
+        : drivers_(drivers), refs_(refs) {}
+
+    void visit(AssignStmt* stmt) {
+        if (drivers_.find(stmt) != drivers_.end()) return;
+        add(stmt->left());
+        add(stmt->right());
+    }
+    void visit(IfStmt* stmt) { add(stmt->predicate().get()); }
+    void visit(SwitchStmt* stmt) { add(stmt->target().get()); }
+    void visit(FunctionCallStmt* stmt) { add(stmt->var().get()); }
+    void visit(ReturnStmt* stmt) { add(stmt->value().get()); }
+    void visit(SequentialStmtBlock* stmt) {
+        for (auto const& iter : stmt->get_conditions()) add(iter.second.get());
+    }
+    // the instance ports are connected directly in the generated code
+    void visit(ModuleInstantiationStmt* stmt) { add_mapping(stmt); }
+    void visit(InterfaceInstantiationStmt* stmt) { add_mapping(stmt); }
+    void visit(AssertBase* stmt) {
+        if (stmt->assert_type() == AssertType::AssertValue) {
+            add(static_cast<AssertValueStmt*>(stmt)->value());
+        } else {
+            // properties may refer to any signal across cycles
+            has_property = true;
+        }
+    }
+    void visit(AuxiliaryStmt* stmt) {
+        if (stmt->aux_type() != AuxiliaryType::EventTracing) return;
+        auto* event = static_cast<EventTracingStmt*>(stmt);
+        for (auto const& iter : event->event_fields()) add(iter.second.get());
+        for (auto const& iter : event->match_values()) add(iter.second.get());
+    }
+
+    bool has_property = false;
+
+    // every var the value is computed from
+    static void collect(const Var* var, std::unordered_set<const Var*>& result) {
+        if (!var) return;
+        result.emplace(var);
+        switch (var->type()) {
+            case VarType::Expression: {
+                auto const* expr = static_cast<const Expr*>(var);
+                if (expr->op == ExprOp::Concat) {
+                    for (auto const* v : static_cast<const VarConcat*>(expr)->vars()) {
+                        collect(v, result);
+                    }
+                } else if (expr->op == ExprOp::Extend) {
+                    collect(static_cast<const VarExtend*>(expr)->parent_var(), result);
+                } else {
+                    if (expr->op == ExprOp::Conditional) {
+                        collect(static_cast<const ConditionalExpr*>(expr)->condition, result);
+                    }
+                    collect(expr->left, result);
+                    collect(expr->right, result);
+                }
+                break;
+            }
+            case VarType::Slice: {
+                auto const* slice = static_cast<const VarSlice*>(var);
+                if (slice->sliced_by_var()) {
+                    collect(static_cast<const VarVarSlice*>(slice)->sliced_var(), result);
+                }
+                collect(slice->parent_var, result);
+                break;
+            }
+            case VarType::BaseCasted: {
+                collect(const_cast<VarCasted*>(static_cast<const VarCasted*>(var))->parent_var(),
+                        result);
+                break;
+            }
+            default: {
+                if (var->is_function()) {
+                    auto const* call = static_cast<const FunctionCallVar*>(var);
+                    for (auto const& iter : call->args()) collect(iter.second.get(), result);
+                }
+                break;
+            }
+        }
+    }
+
+private:
+    const std::unordered_set<const AssignStmt*>& drivers_;
+    std::unordered_set<const Var*>& refs_;
+
+    void add(const Var* var) { collect(var, refs_); }
+    void add_mapping(const InstantiationStmt* stmt) {
+        for (auto const& [port, var] : stmt->port_mapping()) add(var);
+    }
+};
+
+// moves the pipeline registers of a generator backwards into the combinational logic
+// that drives its outputs, so that the logic depth of each stage is balanced. only the
+// cones made of top-level continuous assignments are retimed, and every retimed output
+// is still delayed by exactly the number of stages, so that valid signals stay aligned
+// with their data
+class PipelineRetiming {
+public:
+    PipelineRetiming(Generator* generator, std::vector<StmtBlock*> targets)
+        : generator_(generator), targets_(std::move(targets)) {}
+
+    // returns the outputs that have been retimed. the rest need to be pipelined as is
+    std::unordered_set<Var*> run() {
+        if (!find_cones()) return {};
+        for (auto* output : outputs_) {
+            if (!add_node(output)) return {};
+        }
+        assign_stages();
+        rebuild();
+        return {outputs_.begin(), outputs_.end()};
+    }
+
+private:
+    enum class NodeKind { Net, Expr, Slice, Cast, Concat, Extend, Leaf, Const };
+
+    struct Node {
+        Var* var;
+        NodeKind kind;
+        // operands with the delay from each of them to the node
+        std::vector<std::pair<uint32_t, double>> ops;
+        // constants don't need any register
+        bool free = false;
+        uint32_t stage = 0;
+        double local = 0;
+    };
+
+    Generator* generator_;
+    std::vector<StmtBlock*> targets_;
+
+    std::vector<Var*> outputs_;
+    std::unordered_map<const Var*, std::shared_ptr<AssignStmt>> drivers_;
+    std::unordered_set<const Var*> nets_;
+    std::unordered_set<const Var*> retimed_;
+    std::unordered_set<const Var*> external_;
+
+    // in post order
+    std::vector<Node> nodes_;
+    std::unordered_map<const Var*, uint32_t> node_ids_;
+    std::unordered_set<const Var*> visiting_;
+    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<Var>> values_;
+
+    static bool plain_var(const Var* var) {
+        return (var->type() == VarType::Base || var->type() == VarType::PortIO) &&
+               !var->is_function() && !var->is_interface() && !var->is_enum() &&
+               !var->is_struct() && var->size().size() == 1 && var->size()[0] == 1;
+    }
+
+    // the single top-level continuous assignment that drives the whole var
+    std::shared_ptr<AssignStmt> driver(const Var* var) const {
+        if (var->sources().size() != 1) return nullptr;
+        auto stmt = *var->sources().begin();
+        if (stmt->left() != var || stmt->assign_type() == AssignmentType::NonBlocking ||
+            stmt->parent() != generator_)
+            return nullptr;
+        return stmt;
+    }
+
+    bool find_cones() {
+        std::unordered_set<const AssignStmt*> driver_stmts;
+        for (auto const& [name, var] : generator_->vars()) {
+            if (!plain_var(var.get())) continue;
+            auto stmt = driver(var.get());
+            if (!stmt) continue;
+            if (var->type() == VarType::PortIO) {
+                auto* port = static_cast<Port*>(var.get());
+                if (port->port_direction() != PortDirection::Out) continue;
+                outputs_.emplace_back(var.get());
+            } else {
+                nets_.emplace(var.get());
+            }
+            drivers_.emplace(var.get(), stmt);
+            driver_stmts.emplace(stmt.get());
+        }
+
+        RetimingReferenceVisitor visitor(driver_stmts, external_);
+        visitor.visit_content(generator_);
+        if (visitor.has_property) return false;
+        // vars used inside the expressions that are not retimed
+        for (auto const& [var, stmt] : drivers_) scan(stmt->right(), false);
+
+        // a net can only be retimed if it only feeds retimed nets and outputs
+        std::unordered_set<const Var*> outputs;
+        for (auto* output : outputs_) {
+            if (!external_.count(output) && output->sinks().empty()) outputs.emplace(output);
+        }
+        for (auto const* var : external_) nets_.erase(var);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto iter = nets_.begin(); iter != nets_.end();) {
+                auto const* net = *iter;
+                auto used = std::all_of(net->sinks().begin(), net->sinks().end(),
+                                        [&](auto const& stmt) {
+                                            return nets_.count(stmt->left()) ||
+                                                   outputs.count(stmt->left());
+                                        });
+                if (used) {
+                    iter++;
+                } else {
+                    iter = nets_.erase(iter);
+                    changed = true;
+                }
+            }
+        }
+        outputs_.erase(std::remove_if(outputs_.begin(), outputs_.end(),
+                                      [&](Var* var) { return !outputs.count(var); }),
+                       outputs_.end());
+        retimed_.insert(outputs_.begin(), outputs_.end());
+        return !outputs_.empty();
+    }
+
+    // nets under the nodes the retiming can't see through are external
+    void scan(const Var* var, bool opaque) {
+        if (opaque) {
+            RetimingReferenceVisitor::collect(var, external_);
+            return;
+        }
+        switch (var->type()) {
+            case VarType::Expression: {
+                auto const* expr = static_cast<const Expr*>(var);
+                if (expr->op == ExprOp::Concat) {
+                    for (auto const* v : static_cast<const VarConcat*>(expr)->vars()) {
+                        scan(v, false);
+                    }
+                } else if (expr->op == ExprOp::Extend) {
+                    scan(static_cast<const VarExtend*>(expr)->parent_var(), false);
+                } else {
+                    if (expr->op == ExprOp::Conditional) {
+                        scan(static_cast<const ConditionalExpr*>(expr)->condition, false);
+                    }
+                    scan(expr->left, false);
+                    if (expr->right) scan(expr->right, false);
+                }
+                break;
+            }
+            case VarType::Slice: {
+                auto const* slice = static_cast<const VarSlice*>(var);
+                scan(slice->parent_var, slice->sliced_by_var());
+                if (slice->sliced_by_var()) {
+                    scan(static_cast<const VarVarSlice*>(slice)->sliced_var(), true);
+                }
+                break;
+            }
+            case VarType::BaseCasted: {
+                auto* casted = const_cast<VarCasted*>(static_cast<const VarCasted*>(var));
+                scan(casted->parent_var(), !transparent_cast(casted));
+                break;
+            }
+            default: {
+                if (var->is_function()) RetimingReferenceVisitor::collect(var, external_);
+                break;
+            }
+        }
+    }
+
+    static bool transparent_cast(VarCasted* var) {
+        auto type = var->cast_type();
+        return type == VarCastType::Signed || type == VarCastType::Unsigned ||
+               type == VarCastType::Resize;
+    }
+
+    // builds the nodes in post order. returns false on combinational loops
+    bool add_node(Var* var) {
+        if (node_ids_.count(var)) return true;
+        if (visiting_.count(var)) return false;
+        visiting_.emplace(var);
+
+        Node node{var, NodeKind::Leaf, {}};
+        auto add_op = [&](Var* op, double delay) {
+            if (!add_node(op)) return false;
+            node.ops.emplace_back(node_ids_.at(op), delay);
+            return true;
+        };
+        bool ok = true;
+        if (nets_.count(var) || retimed_.count(var)) {
+            node.kind = NodeKind::Net;
+            ok = add_op(drivers_.at(var)->right(), 0);
+        } else if (var->type() == VarType::ConstValue || var->type() == VarType::Parameter) {
+            node.kind = NodeKind::Const;
+        } else if (var->type() == VarType::Expression) {
+            auto* expr = static_cast<Expr*>(var);
+            if (expr->op == ExprOp::Concat) {
+                node.kind = NodeKind::Concat;
+                for (auto* v : static_cast<VarConcat*>(expr)->vars()) ok = ok && add_op(v, 0);
+            } else if (expr->op == ExprOp::Extend) {
+                node.kind = NodeKind::Extend;
+                ok = add_op(static_cast<VarExtend*>(expr)->parent_var(), 0);
+            } else {
+                node.kind = NodeKind::Expr;
+                auto delay = estimate_op_delay(expr).delay;
+                if (expr->op == ExprOp::Conditional) {
+                    ok = add_op(static_cast<ConditionalExpr*>(expr)->condition, delay);
+                }
+                ok = ok && add_op(expr->left, delay);
+                if (expr->right) ok = ok && add_op(expr->right, delay);
+            }
+        } else if (var->type() == VarType::Slice &&
+                   !static_cast<VarSlice*>(var)->sliced_by_var()) {
+            node.kind = NodeKind::Slice;
+            ok = add_op(static_cast<VarSlice*>(var)->parent_var, 0);
+        } else if (var->type() == VarType::BaseCasted &&
+                   transparent_cast(static_cast<VarCasted*>(var))) {
+            node.kind = NodeKind::Cast;
+            ok = add_op(static_cast<VarCasted*>(var)->parent_var(), 0);
+        }
+        if (!ok) return false;
+
+        if (node.kind == NodeKind::Const) {
+            node.free = true;
+        } else if (node.kind != NodeKind::Leaf) {
+            node.free = std::all_of(node.ops.begin(), node.ops.end(),
+                                    [this](auto const& op) { return nodes_[op.first].free; });
+        }
+        visiting_.erase(var);
+        node_ids_.emplace(var, static_cast<uint32_t>(nodes_.size()));
+        nodes_.emplace_back(std::move(node));
+        return true;
+    }
+
+    // as soon as possible, starting a new stage whenever the logic of the current one
+    // exceeds the period
+    bool schedule(double period) {
+        constexpr double epsilon = 1e-9;
+        auto last_stage = static_cast<uint32_t>(targets_.size() - 1);
+        for (auto& node : nodes_) {
+            node.stage = 0;
+            node.local = 0;
+            if (node.free) continue;
+            for (auto const& [op, delay] : node.ops) {
+                if (!nodes_[op].free) node.stage = std::max(node.stage, nodes_[op].stage);
+            }
+            double max_delay = 0;
+            for (auto const& [op, delay] : node.ops) {
+                auto const& n = nodes_[op];
+                auto local = (!n.free && n.stage == node.stage) ? n.local + delay : delay;
+                node.local = std::max(node.local, local);
+                max_delay = std::max(max_delay, delay);
+            }
+            if (node.local > period + epsilon) {
+                node.stage++;
+                node.local = max_delay;
+                if (node.stage > last_stage) return false;
+            }
+        }
+        return true;
+    }
+
+    void assign_stages() {
+        double low = 0, high = 0;
+        for (auto const& node : nodes_) {
+            for (auto const& [op, delay] : node.ops) low = std::max(low, delay);
+        }
+        // the whole logic in a single stage always works
+        schedule(std::numeric_limits<double>::max());
+        for (auto const& node : nodes_) high = std::max(high, node.local);
+        if (!schedule(low)) {
+            for (uint32_t i = 0; i < 32 && high - low > 1e-6; i++) {
+                auto mid = (low + high) / 2;
+                if (schedule(mid)) {
+                    high = mid;
+                } else {
+                    low = mid;
+                }
+            }
+            schedule(high);
+        }
+    }
+
+    std::shared_ptr<Var> new_var(const std::string& name, const Var* var) {
+        auto new_name = generator_->get_unique_variable_name("", name);
+        auto& result = generator_->var(new_name, var->width(), 1, var->is_signed());
+        if (generator_->debug) result.fn_name_ln.emplace_back(std::make_pair(__FILE__, __LINE__));
+        return result.shared_from_this();
+    }
+
+    std::string base_name(uint32_t id) const {
+        auto const& node = nodes_[id];
+        if (plain_var(node.var)) return node.var->name;
+        return "retime";
+    }
+
+    // the value of the node in the given stage
+    std::shared_ptr<Var> value(uint32_t id, uint32_t stage) {
+        auto& node = nodes_[id];
+        if (node.free) return node.var->shared_from_this();
+        auto key = std::make_pair(id, stage);
+        auto iter = values_.find(key);
+        if (iter != values_.end()) return iter->second;
+
+        std::shared_ptr<Var> result;
+        if (stage > node.stage) {
+            auto pre = value(id, stage - 1);
+            if (!plain_var(pre.get())) {
+                // registers need a named source
+                auto tmp = new_var(base_name(id), node.var);
+                add_stmt(generator_, tmp->assign(pre));
+                pre = tmp;
+            }
+            result = new_var(::format("{0}_stage_{1}", base_name(id), stage), node.var);
+            targets_[stage - 1]->add_stmt(result->assign(pre, AssignmentType::NonBlocking));
+        } else {
+            result = rebuild_node(id, stage);
+        }
+        values_.emplace(key, result);
+        return result;
+    }
+
+    std::shared_ptr<Var> rebuild_node(uint32_t id, uint32_t stage) {
+        auto const& node = nodes_[id];
+        auto* var = node.var;
+        if (node.kind == NodeKind::Leaf || node.kind == NodeKind::Net)
+            return var->shared_from_this();
+        std::vector<std::shared_ptr<Var>> ops;
+        bool changed = false;
+        for (auto const& [op, delay] : node.ops) {
+            ops.emplace_back(value(op, stage));
+            changed = changed || ops.back().get() != nodes_[op].var;
+        }
+        if (!changed) return var->shared_from_this();
+
+        switch (node.kind) {
+            case NodeKind::Expr: {
+                auto* expr = static_cast<Expr*>(var);
+                if (expr->op == ExprOp::Conditional) {
+                    auto result = std::make_shared<ConditionalExpr>(ops[0], ops[1], ops[2]);
+                    generator_->add_expr(result);
+                    return result;
+                }
+                auto* right = ops.size() > 1 ? ops[1].get() : nullptr;
+                return generator_->expr(expr->op, ops[0].get(), right).shared_from_this();
+            }
+            case NodeKind::Slice: {
+                auto parent = ops[0];
+                if (!plain_var(parent.get())) {
+                    auto tmp = new_var(base_name(node.ops[0].first), parent.get());
+                    add_stmt(generator_, tmp->assign(parent));
+                    parent = tmp;
+                }
+                return static_cast<VarSlice*>(var)->slice_var(parent);
+            }
+            case NodeKind::Cast: {
+                auto* casted = static_cast<VarCasted*>(var);
+                auto result = ops[0]->cast(casted->cast_type());
+                if (casted->cast_type() == VarCastType::Resize) {
+                    result->as<VarCasted>()->set_target_width(casted->width());
+                }
+                return result;
+            }
+            case NodeKind::Concat: {
+                auto* result = &ops[0]->concat(*ops[1]);
+                for (uint64_t i = 2; i < ops.size(); i++) result = &result->concat(*ops[i]);
+                return result->shared_from_this();
+            }
+            case NodeKind::Extend: {
+                return ops[0]->extend(var->width()).shared_from_this();
+            }
+            default:
+                return var->shared_from_this();
+        }
+    }
+
+    static void add_stmt(Generator* generator, const std::shared_ptr<AssignStmt>& stmt) {
+        generator->add_stmt(stmt);
+        if (generator->debug) stmt->fn_name_ln.emplace_back(std::make_pair(__FILE__, __LINE__));
+    }
+
+    void remove_driver(Var* var) {
+        auto stmt = drivers_.at(var);
+        var->remove_source(stmt);
+        // the sinks are added to every var the expression is computed from
+        std::unordered_set<const Var*> vars;
+        RetimingReferenceVisitor::collect(stmt->right(), vars);
+        for (auto const* v : vars) const_cast<Var*>(v)->remove_sink(stmt);
+        generator_->remove_stmt(stmt);
+    }
+
+    void rebuild() {
+        auto last_stage = static_cast<uint32_t>(targets_.size() - 1);
+        // the outputs have to be computed first, since they decide which values are used
+        std::vector<std::shared_ptr<Var>> output_values;
+        for (auto* output : outputs_) {
+            auto const& node = nodes_[node_ids_.at(output)];
+            output_values.emplace_back(value(node.ops[0].first, last_stage));
+        }
+        // re-drive the nets from their values in their own stage
+        for (uint32_t id = 0; id < nodes_.size(); id++) {
+            auto const& node = nodes_[id];
+            if (node.kind != NodeKind::Net || !nets_.count(node.var)) continue;
+            auto right = value(node.ops[0].first, node.stage);
+            if (right.get() == drivers_.at(node.var)->right()) continue;
+            remove_driver(node.var);
+            add_stmt(generator_, node.var->assign(right));
+        }
+        for (uint64_t i = 0; i < outputs_.size(); i++) {
+            auto* output = outputs_[i];
+            remove_driver(output);
+            auto stmt = output->assign(output_values[i], AssignmentType::NonBlocking);
+            targets_[last_stage]->add_stmt(stmt);
+        }
+    }
+};
+
 class PipelineInsertionVisitor : public IRVisitor {
 public:
     void visit(Generator* generator) override {
@@ -2176,6 +2807,7 @@ public:
         std::string clock_name;
         auto attributes = generator->get_attributes();
         uint32_t num_stages = 0;
+        bool retime = false;
         for (auto const& attr : attributes) {
             if (attr->type_str == "pipeline") {
                 try {
@@ -2190,6 +2822,8 @@ public:
                 }
             } else if (attr->type_str == "pipeline_clk") {
                 clock_name = attr->value_str;
+            } else if (attr->type_str == "pipeline_retime") {
+                retime = attr->value_str != "0" && attr->value_str != "false";
             }
         }
         if (has_attribute) {
@@ -2209,17 +2843,38 @@ public:
             // we need to create all the registers based on the posedge of the clock
             std::vector<std::shared_ptr<SequentialStmtBlock>> blocks;
             blocks.resize(num_stages);
+            // where the registers of each stage go
+            std::vector<StmtBlock*> targets;
+            targets.resize(num_stages);
+            // the clock enable only gates the registers in retiming mode, to keep the
+            // existing designs unchanged
+            std::shared_ptr<Port> clk_en;
+            if (retime) {
+                auto clk_en_names = generator->get_ports(PortType::ClockEnable);
+                if (!clk_en_names.empty()) clk_en = generator->get_port(clk_en_names[0]);
+            }
             for (uint32_t i = 0; i < num_stages; i++) {
                 blocks[i] = std::make_shared<SequentialStmtBlock>();
                 generator->add_stmt(blocks[i]);
                 blocks[i]->add_condition({BlockEdgeType::Posedge, clock_port});
                 if (generator->debug)
                     blocks[i]->fn_name_ln.emplace_back(std::make_pair(__FILE__, __LINE__));
+                targets[i] = blocks[i].get();
+                if (clk_en) {
+                    auto if_ = std::make_shared<IfStmt>(clk_en);
+                    blocks[i]->add_stmt(if_);
+                    targets[i] = if_->then_body().get();
+                }
+            }
+            std::unordered_set<Var*> retimed;
+            if (retime) {
+                PipelineRetiming retiming(generator, targets);
+                retimed = retiming.run();
             }
             // get all the outputs
             for (auto const& port_name : port_names) {
                 auto port = generator->get_port(port_name);
-                if (port->port_direction() == PortDirection::In) {
+                if (port->port_direction() == PortDirection::In || retimed.count(port.get())) {
                     continue;
                 }
                 std::vector<std::shared_ptr<Var>> vars;
@@ -2239,10 +2894,11 @@ public:
                 for (uint32_t i = 0; i < num_stages - 1; i++) {
                     auto pre_stage = vars[i];
                     auto next_stage = vars[i + 1];
-                    blocks[i]->add_stmt(next_stage->assign(pre_stage, AssignmentType::NonBlocking));
+                    targets[i]->add_stmt(
+                        next_stage->assign(pre_stage, AssignmentType::NonBlocking));
                 }
                 // last stage
-                blocks[num_stages - 1]->add_stmt(
+                targets[num_stages - 1]->add_stmt(
                     port->assign(vars[num_stages - 1], AssignmentType::NonBlocking));
             }
         }
@@ -2296,6 +2952,11 @@ static std::shared_ptr<IfStmt> create_if_stmt_wrapper(StmtBlock* block, Port& po
 
 class InsertClockIRVisitor : public IRVisitor {
 public:
+    InsertClockIRVisitor(Generator* top, std::unordered_set<const Stmt*> skipped_blocks)
+        : InsertClockIRVisitor(top) {
+        skipped_blocks_ = std::move(skipped_blocks);
+    }
+
     explicit InsertClockIRVisitor(Generator* top) : top_(top) {
         // find out the top clock enable signal
         auto ports = top->get_ports(PortType::ClockEnable);
@@ -2343,7 +3004,7 @@ public:
     }
 
     void visit(SequentialStmtBlock* block) override {
-        if (!clk_en_) return;
+        if (!clk_en_ || skipped_blocks_.count(block)) return;
         auto num_stmts = block->size();
         auto* generator = block->generator_parent();
         auto clk_en = generator->get_port(clk_en_name_);
@@ -2378,6 +3039,7 @@ private:
     std::string clk_en_name_;
     Port* clk_en_;
     Generator* top_;
+    std::unordered_set<const Stmt*> skipped_blocks_;
 
     bool has_clk_en_stmt(StmtBlock* block) const {
         if (!block->empty()) {
@@ -2407,6 +3069,15 @@ void auto_insert_clock_enable(Generator* top) {
     visitor.visit_root(top);
 }
 
+void auto_insert_clock_enable(Generator* top, const ActivityProfile& profile, double threshold) {
+    std::unordered_set<const Stmt*> skipped_blocks;
+    for (auto const& group : profile.register_groups) {
+        if (group.activity.activity >= threshold) skipped_blocks.emplace(group.block);
+    }
+    InsertClockIRVisitor visitor(top, std::move(skipped_blocks));
+    visitor.visit_root(top);
+}
+
 class InsertSyncReset : public IRVisitor {
 public:
     explicit InsertSyncReset(Generator* gen) {
@@ -2542,9 +3213,19 @@ void auto_insert_sync_reset(Generator* top) {
     visitor.visit_generator_root_p(top);
 }
 
+struct PortBundleEntry {
+    std::string entry_name;
+    Generator* generator;
+    // structural hash of the bundle ports
+    uint64_t hash;
+};
+
 class PortBundleVisitor : public IRVisitor {
 public:
     void visit(Generator* generator) override {
+        // entries are collected locally and merged once per generator to keep
+        // the lock contention low
+        std::vector<std::pair<std::string, PortBundleEntry>> entries;
         auto const& mappings = generator->port_bundle_mapping();
         for (auto const& [entry_name, ref] : mappings) {
             const auto& mapping = ref->name_mappings();
@@ -2573,82 +3254,116 @@ public:
             if (same_direction && dir != PortDirection::InOut && !mapping.empty()) {
                 // this is the one we need to convert
                 auto bundle_name = ref->def_name();
-                bundle_mapping_[bundle_name].emplace_back(std::make_pair(entry_name, generator));
+                entries.emplace_back(bundle_name,
+                                     PortBundleEntry{entry_name, generator,
+                                                     bundle_hash(generator, ref.get())});
             }
         }
+        if (entries.empty()) return;
+        std::lock_guard guard(lock_);
+        for (auto& [bundle_name, entry] : entries) {
+            bundle_mapping_[bundle_name].emplace_back(std::move(entry));
+        }
     }
 
-    const std::map<std::string, std::vector<std::pair<std::string, Generator*>>>& bundle_mapping() {
+    const std::map<std::string, std::vector<PortBundleEntry>>& bundle_mapping() {
+        // make the order independent of the thread scheduling
+        for (auto& iter : bundle_mapping_) {
+            auto& entries = iter.second;
+            std::sort(entries.begin(), entries.end(),
+                      [](const PortBundleEntry& a, const PortBundleEntry& b) {
+                          auto const& name_a = a.generator->handle_name();
+                          auto const& name_b = b.generator->handle_name();
+                          if (name_a != name_b) return name_a < name_b;
+                          return a.entry_name < b.entry_name;
+                      });
+        }
         return bundle_mapping_;
     }
 
 private:
-    std::map<std::string, std::vector<std::pair<std::string, Generator*>>> bundle_mapping_;
+    std::mutex lock_;
+    std::map<std::string, std::vector<PortBundleEntry>> bundle_mapping_;
+
+    static uint64_t bundle_hash(Generator* generator, const PortBundleRef* ref) {
+        uint64_t hash = 0;
+        // name mappings are ordered by the port name
+        for (auto const& [port_name, real_name] : ref->name_mappings()) {
+            auto port = generator->get_port(real_name);
+            uint64_t values[] = {hash, hash_64_fnv1a(port_name.c_str(), port_name.size()),
+                                 port->var_width(), port->width(), port->is_signed()};
+            hash = hash_64_fnv1a(values, sizeof(values));
+        }
+        return hash;
+    }
 };
 
-void merge_bundle_mapping(
-    const std::map<std::string, std::vector<std::pair<std::string, Generator*>>>& old_mapping) {
-    for (auto const& [bundle_name, generators] : old_mapping) {
-        std::map<Generator*, uint64_t> bundle_hashs;
-        std::shared_ptr<PortBundleRef> ref_port_ref;
-        Generator* ref_generator = nullptr;
-        for (auto const& [entry_name, generator] : generators) {
-            auto ref = generator->get_bundle_ref(entry_name);
-            auto mappings = ref->name_mappings();
-            std::vector<std::string> ports;
-            ports.reserve(mappings.size());
-            for (auto const& iter : mappings) {
-                ports.emplace_back(iter.first);
-            }
-            std::sort(ports.begin(), ports.end());
-            std::string base_str;
-            for (auto const& port_name : ports) {
-                auto port = generator->get_port(mappings.at(port_name));
-                base_str.append(::format("{0}{1}{2}{3}", port->var_width(), port->width(),
-                                         port->is_signed(), port_name));
-            }
-            uint64_t hash = hash_64_fnv1a(base_str.c_str(), base_str.size());
-            if (bundle_hashs.find(generator) != bundle_hashs.end()) {
-                if (bundle_hashs.at(generator) != hash)
-                    throw UserException(::format(
-                        "Port bundle with same name {0} have different definition", bundle_name));
-            }
-            bundle_hashs.emplace(generator, hash);
-
-            ref_generator = generator;
-            ref_port_ref = ref;
-        }
-        // for now we require the naming of the bundle has to be the same
-        bool initialized = false;
-        uint64_t base_hash = 0;
-        for (auto const& iter : bundle_hashs) {
-            uint64_t hash = iter.second;
-            if (!initialized) {
-                initialized = true;
-                base_hash = hash;
-            } else {
-                if (base_hash != hash) {
-                    throw UserException(::format(
-                        "Port bundle with same name {0} have different definition", bundle_name));
-                }
+static bool same_bundle(const PortBundleEntry& ref_entry, const PortBundleEntry& entry) {
+    auto const& ref_mapping =
+        ref_entry.generator->get_bundle_ref(ref_entry.entry_name)->name_mappings();
+    auto const& mapping = entry.generator->get_bundle_ref(entry.entry_name)->name_mappings();
+    if (ref_mapping.size() != mapping.size()) return false;
+    // both are ordered by the port name
+    for (auto ref_iter = ref_mapping.begin(), iter = mapping.begin(); iter != mapping.end();
+         ref_iter++, iter++) {
+        if (ref_iter->first != iter->first) return false;
+        auto ref_port = ref_entry.generator->get_port(ref_iter->second);
+        auto port = entry.generator->get_port(iter->second);
+        if (ref_port->var_width() != port->var_width() || ref_port->width() != port->width() ||
+            ref_port->is_signed() != port->is_signed())
+            return false;
+    }
+    return true;
+}
+
+void merge_bundle_mapping(const std::map<std::string, std::vector<PortBundleEntry>>& mapping) {
+    // first pass: make sure the bundles with the same name are identical and
+    // create the packed struct for each of them
+    std::map<std::string, PackedStruct> structs;
+    // entries grouped by generator, in the order they show up
+    std::vector<Generator*> generators;
+    std::unordered_map<Generator*, std::vector<std::pair<std::string, const PackedStruct*>>>
+        generator_entries;
+    for (auto const& [bundle_name, entries] : mapping) {
+        if (entries.empty()) throw InternalException("ref generator cannot be null");
+        auto const& ref_entry = entries.front();
+        // for now we require the naming of the bundle has to be the same. different hashes
+        // are rejected right away, matching ones are still compared in case of a collision
+        for (auto const& entry : entries) {
+            if (entry.hash != ref_entry.hash || !same_bundle(ref_entry, entry)) {
+                throw UserException(::format(
+                    "Port bundle with same name {0} have different definition", bundle_name));
             }
         }
-        if (!ref_generator) throw InternalException("ref generator cannot be null");
         // create a packed struct
         std::vector<std::tuple<std::string, uint32_t, bool>> def;
-        auto const& mapping = ref_port_ref->name_mappings();
-        for (auto const& [var_name, real_name] : mapping) {
+        auto* ref_generator = ref_entry.generator;
+        auto ref_port_ref = ref_generator->get_bundle_ref(ref_entry.entry_name);
+        auto const& ref_mapping = ref_port_ref->name_mappings();
+        def.reserve(ref_mapping.size());
+        for (auto const& [var_name, real_name] : ref_mapping) {
             auto port = ref_generator->get_port(real_name);
             def.emplace_back(std::make_tuple(var_name, port->width(), port->is_signed()));
         }
-        PackedStruct struct_(bundle_name, def);
-        for (auto const& [entry_name, generator] : generators) {
-            auto* p = dynamic_cast<Generator*>(generator->parent());
+        auto const& struct_ =
+            structs.emplace(bundle_name, PackedStruct(bundle_name, def)).first->second;
+        for (auto const& entry : entries) {
+            auto& gen_entries = generator_entries[entry.generator];
+            if (gen_entries.empty()) generators.emplace_back(entry.generator);
+            gen_entries.emplace_back(entry.entry_name, &struct_);
+        }
+    }
+
+    // second pass: rewire the ports, one generator at a time. connections live in
+    // the parent generator, which is shared among siblings, so this part stays serial
+    for (auto* generator : generators) {
+        auto* p = dynamic_cast<Generator*>(generator->parent());
+        for (auto const& [entry_name, struct_] : generator_entries.at(generator)) {
             // move sources around the ports
             auto ref = generator->get_bundle_ref(entry_name);
             auto const& m = ref->name_mappings();
             auto dir = generator->get_port(m.begin()->second)->port_direction();
-            auto& packed = generator->port_packed(dir, entry_name, struct_);
+            auto& packed = generator->port_packed(dir, entry_name, *struct_);
 
             for (auto const& [attr, real_name] : m) {
                 auto target = generator->get_port(real_name);
@@ -2679,8 +3394,7 @@ void merge_bundle_mapping(
 void change_port_bundle_struct(Generator* top) {
     // pass to extract all the bundles
     PortBundleVisitor b_visitor;
-    // this cannot be parallelized if we don't use a lock
-    b_visitor.visit_generator_root(top);
+    b_visitor.visit_generator_root_p(top);
     merge_bundle_mapping(b_visitor.bundle_mapping());
 }
 
@@ -2884,53 +3598,108 @@ public:
     }
 
 private:
-    bool static check_stmt_block(StmtBlock* stmt, Var* var, bool full_branch) {
-        return check_stmt_condition(
-            stmt,
-            [=](Stmt* s) -> bool {
-                if (s->type() == StatementType::Assign) {
-                    auto assign = s->as<AssignStmt>();
-                    return assign->left() == var;
-                }
-                return false;
-            },
-            false, full_branch);
+    // bitset indexed by the id of the assigned variables
+    using VarSet = std::vector<uint64_t>;
+
+    static Var* assigned_var(AssignStmt* stmt) {
+        auto* left = stmt->left();
+        if (left->type() == VarType::Slice) {
+            auto* slice = reinterpret_cast<VarSlice*>(left);
+            left = const_cast<Var*>(slice->get_var_root_parent());
+        }
+        return left;
     }
 
-    static void check_stmt_block(StmtBlock* stmt, Var* var, const std::vector<Stmt*>& stmts,
-                                 bool full_branch) {
-        auto check = [=](Stmt* s) -> bool {
-            if (s->type() == StatementType::Assign) {
-                auto* assign = reinterpret_cast<AssignStmt*>(s);
-                auto* left = assign->left();
-                if (left->type() == VarType::Slice) {
-                    auto* slice = reinterpret_cast<VarSlice*>(left);
-                    left = const_cast<Var*>(slice->get_var_root_parent());
+    static bool is_full_switch(SwitchStmt* stmt) {
+        auto const& cases = stmt->body();
+        // if there is no default case, all the cases have to be covered
+        // the only exception is that if the target is an enum and we've covered all it's enum
+        // case
+        if (cases.find(nullptr) != cases.end()) return true;
+        uint64_t targeted_cases;
+        if (stmt->target()->is_enum()) {
+            auto* enum_var = dynamic_cast<EnumType*>(stmt->target().get());
+            if (!enum_var) throw InternalException("Unable to resolve enum type");
+            auto const* enum_def = enum_var->enum_type();
+            targeted_cases = enum_def->values.size();
+        } else {
+            auto width = stmt->target()->width();
+            if (width >= 64) return false;
+            targeted_cases = 1ull << width;
+        }
+        return cases.size() == targeted_cases;
+    }
+
+    // computes the set of variables that are assigned in every control flow. the result
+    // of each branch is merged at the joins, so the whole block is only visited once
+    static VarSet definitely_assigned(Stmt* stmt, const std::unordered_map<Var*, uint64_t>& ids,
+                                      uint64_t num_words) {
+        VarSet result(num_words, 0);
+        switch (stmt->type()) {
+            case StatementType::Assign: {
+                auto* var = assigned_var(reinterpret_cast<AssignStmt*>(stmt));
+                auto iter = ids.find(var);
+                if (iter != ids.end()) result[iter->second / 64] |= 1ull << (iter->second % 64);
+                break;
+            }
+            case StatementType::Block: {
+                auto* block = reinterpret_cast<StmtBlock*>(stmt);
+                for (auto const& s : *block) {
+                    auto set = definitely_assigned(s.get(), ids, num_words);
+                    for (uint64_t i = 0; i < num_words; i++) result[i] |= set[i];
                 }
-                return left == var;
-            } else if (s->type() == StatementType::Block) {
-                auto* block = reinterpret_cast<StmtBlock*>(s);
-                if (block->block_type() == StatementBlockType::Function) {
-                    // function call to set the variable
-                    return check_stmt_block(block, var, full_branch);
+                break;
+            }
+            case StatementType::If: {
+                auto* if_ = reinterpret_cast<IfStmt*>(stmt);
+                result = definitely_assigned(if_->then_body().get(), ids, num_words);
+                auto set = definitely_assigned(if_->else_body().get(), ids, num_words);
+                for (uint64_t i = 0; i < num_words; i++) result[i] &= set[i];
+                break;
+            }
+            case StatementType::Switch: {
+                auto* switch_ = reinterpret_cast<SwitchStmt*>(stmt);
+                if (switch_->body().empty() || !is_full_switch(switch_)) break;
+                bool first = true;
+                for (auto const& iter : switch_->body()) {
+                    auto set = definitely_assigned(iter.second.get(), ids, num_words);
+                    if (first) {
+                        result = std::move(set);
+                        first = false;
+                    } else {
+                        for (uint64_t i = 0; i < num_words; i++) result[i] &= set[i];
+                    }
                 }
+                break;
+            }
+            case StatementType::For: {
+                auto* for_ = reinterpret_cast<ForStmt*>(stmt);
+                result = definitely_assigned(for_->get_loop_body().get(), ids, num_words);
+                break;
+            }
+            default: {
             }
-            return false;
-        };
-        if (!check_stmt_condition(stmt, check, false, full_branch)) {
-            // things goes wrong
-            // need to recover all the statements
-            throw StmtException(::format("{0} will be inferred as latch", var->to_string()),
-                                stmts.begin(), stmts.end());
         }
+        return result;
     }
 
     void static check_combinational(CombinationalStmtBlock* stmt) {
         AssignedVarVisitor visitor;
         visitor.visit_root(stmt);
-        const auto& vars = visitor.assigned_vars();
-        for (auto const& iter : vars) {
-            check_stmt_block(stmt, iter.first, iter.second, true);
+        auto const& vars = visitor.assigned_vars();
+        if (vars.empty()) return;
+        std::unordered_map<Var*, uint64_t> ids;
+        ids.reserve(vars.size());
+        for (auto* var : visitor.vars()) ids.emplace(var, ids.size());
+        uint64_t num_words = (ids.size() + 63) / 64;
+        auto assigned = definitely_assigned(stmt, ids, num_words);
+        for (auto* var : visitor.vars()) {
+            auto id = ids.at(var);
+            if (!(assigned[id / 64] & (1ull << (id % 64)))) {
+                auto const& stmts = vars.at(var);
+                throw StmtException(::format("{0} will be inferred as latch", var->to_string()),
+                                    stmts.begin(), stmts.end());
+            }
         }
     }
 
@@ -2951,9 +3720,17 @@ private:
             for (auto const& if_ : ifs) {
                 AssignedVarVisitor a_v;
                 a_v.visit_root(if_->then_body().get());
-                auto vars = a_v.assigned_vars();
-                for (auto const& [v, stmts] : vars) {
-                    check_stmt_block(if_->else_body().get(), v, stmts, false);
+                // any assignment in the else body is sufficient
+                AssignedVarVisitor else_v(false);
+                else_v.visit_root(if_->else_body().get());
+                auto const& else_vars = else_v.assigned_vars();
+                for (auto* v : a_v.vars()) {
+                    if (else_vars.find(v) == else_vars.end()) {
+                        auto const& stmts = a_v.assigned_vars().at(v);
+                        throw StmtException(
+                            ::format("{0} will be inferred as latch", v->to_string()),
+                            stmts.begin(), stmts.end());
+                    }
                 }
             }
         }
@@ -2989,23 +3766,31 @@ private:
 
     class AssignedVarVisitor : public IRVisitor {
     public:
+        explicit AssignedVarVisitor(bool skip_var_slice = true)
+            : skip_var_slice_(skip_var_slice) {}
         void visit(AssignStmt* stmt) override {
             auto* left = stmt->left();
             if (left->type() == VarType::Slice) {
                 auto* slice = reinterpret_cast<VarSlice*>(left);
-                if (slice->sliced_by_var()) {
+                if (skip_var_slice_ && slice->sliced_by_var()) {
                     return;
                 }
                 left = const_cast<Var*>(slice->get_var_root_parent());
             }
-            assigned_vars_[left].emplace_back(stmt);
+            auto& stmts = assigned_vars_[left];
+            if (stmts.empty()) vars_.emplace_back(left);
+            stmts.emplace_back(stmt);
         }
         const std::unordered_map<Var*, std::vector<Stmt*>>& assigned_vars() const {
             return assigned_vars_;
         }
+        // in the order of first assignment
+        const std::vector<Var*>& vars() const { return vars_; }
 
     private:
+        bool skip_var_slice_;
         std::unordered_map<Var*, std::vector<Stmt*>> assigned_vars_;
+        std::vector<Var*> vars_;
     };
 };
 
@@ -3016,125 +3801,156 @@ void check_inferred_latch(Generator* top) {
 
 class MultipleDriverVisitor : public IRVisitor {
 public:
-    void visit(Var* var) override { check_var(var); }
-    void visit(Port* port) override { check_var(port); }
+    void visit(Generator* generator) override {
+        // scopes are cached per generator so generators can be checked in parallel
+        std::unordered_map<IRNode*, StmtScope> scopes;
+        for (auto const& iter : generator->vars()) {
+            check_var(iter.second.get(), scopes);
+        }
+    }
 
 private:
-    static bool share_root(IRNode* node1, IRNode* node2) {
-        std::set<IRNode*> nodes1;
-        std::set<IRNode*> nodes2;
-        while (node1->parent() && node1->parent()->ir_node_kind() == IRNodeKind::StmtKind) {
-            nodes1.emplace(node1);
-            node1 = node1->parent();
-        }
-        while (node2->parent() && node2->parent()->ir_node_kind() == IRNodeKind::StmtKind) {
-            nodes2.emplace(node2);
-            node2 = node2->parent();
-        }
-        std::set<IRNode*> diff;
-        std::set_intersection(nodes1.begin(), nodes1.end(), nodes2.begin(), nodes2.end(),
-                              std::inserter(diff, diff.begin()));
-        return !diff.empty();
+    struct StmtScope {
+        // top-level statement that holds the node
+        Stmt* root;
+        // ancestor right below the root. nullptr if the node is the root itself
+        IRNode* branch;
+        // how many times the node is executed due to enclosing for loops
+        uint64_t iterations;
+        // there is an if or switch between the node and the innermost enclosing loop
+        bool conditional;
+    };
+
+    struct Driver {
+        Stmt* stmt;
+        IRNode* parent;
+        Stmt* root;
+    };
+
+    struct DrivenRange {
+        uint32_t high;
+        Driver driver;
+    };
+
+    static uint64_t loop_count(const ForStmt* stmt) {
+        auto start = stmt->start(), end = stmt->end(), step = stmt->step();
+        if (step > 0 && end > start) return (end - start + step - 1) / step;
+        if (step < 0 && end < start) return (start - end - step - 1) / (-step);
+        return 0;
     }
 
-    static bool has_for_loop(Stmt* stmt) {
-        if (stmt->type() == StatementType::For) {
-            return true;
-        } else {
-            auto* p = stmt->parent();
-            if (p && p->ir_node_kind() == IRNodeKind::StmtKind) {
-                return has_for_loop(reinterpret_cast<Stmt*>(p));
+    static const StmtScope& get_scope(IRNode* node,
+                                      std::unordered_map<IRNode*, StmtScope>& scopes) {
+        auto iter = scopes.find(node);
+        if (iter != scopes.end()) return iter->second;
+        uint64_t iterations = 1;
+        bool is_loop = false, is_condition = false;
+        if (node->ir_node_kind() == IRNodeKind::StmtKind) {
+            auto type = reinterpret_cast<Stmt*>(node)->type();
+            if (type == StatementType::For) {
+                iterations = loop_count(reinterpret_cast<ForStmt*>(node));
+                is_loop = iterations > 1;
             }
+            is_condition = type == StatementType::If || type == StatementType::Switch;
+        }
+        StmtScope scope{};
+        auto* parent = node->parent();
+        if (!parent || parent->ir_node_kind() != IRNodeKind::StmtKind) {
+            scope = {reinterpret_cast<Stmt*>(node), nullptr, iterations, is_condition};
+        } else {
+            auto const& parent_scope = get_scope(parent, scopes);
+            scope.root = parent_scope.root;
+            scope.branch = parent_scope.branch ? parent_scope.branch : node;
+            scope.iterations = parent_scope.iterations * iterations;
+            // a condition outside of the loop applies to every iteration alike
+            scope.conditional = is_condition || (!is_loop && parent_scope.conditional);
+        }
+        return scopes.emplace(node, scope).first->second;
+    }
+
+    static bool is_block(Stmt* stmt, StatementBlockType type) {
+        return stmt->type() == StatementType::Block &&
+               reinterpret_cast<StmtBlock*>(stmt)->block_type() == type;
+    }
+
+    static bool has_multiple_driver(const Driver& driver, const Driver& ref,
+                                    std::unordered_map<IRNode*, StmtScope>& scopes) {
+        // the purpose of the following statement is to make sure that there is no
+        // other assignment that's assigning the same var slice in the same scope
+        // it cannot be driven through different blocks, either.
+        // notice that there is a caveat. in combinational block, as long as the
+        // they are in the same stmt parent, they can have different scope, since
+        // having different scope implies priority. as a result, we need to filter
+        // this case out
+        if (driver.root != ref.root) return true;
+        if (driver.parent == ref.parent) {
+            return !is_block(driver.root, StatementBlockType::Combinational) &&
+                   !is_block(driver.root, StatementBlockType::Latch);
+        }
+        if (is_block(driver.root, StatementBlockType::Sequential)) {
+            // TODO: this algorithm is not perfect as it only
+            //  accounts for standalone assignments
+            // two scopes share an ancestor below the root iff they are in the same
+            // top-level branch
+            if (driver.parent == driver.root || ref.parent == ref.root) return true;
+            return get_scope(driver.parent, scopes).branch != get_scope(ref.parent, scopes).branch;
         }
         return false;
     }
 
-    static void check_var(Var* var) {
-        std::unordered_map<uint32_t, std::pair<IRNode*, Stmt*>> parents;
+    static void check_var(Var* var, std::unordered_map<IRNode*, StmtScope>& scopes) {
+        // driven bit ranges, indexed by the low bit
+        std::map<uint32_t, DrivenRange> ranges;
         for (auto const& stmt : var->sources()) {
-            // TODO: FIX THIS
-            //  This is a hack to bypass the check if there is a for loop
-            if (has_for_loop(stmt.get())) continue;
             auto* v = stmt->left();
             if (v->get_var_root_parent() != var) continue;
             if (v->type() == VarType::Slice) {
                 auto slice = v->as<VarSlice>();
                 if (slice->sliced_by_var()) continue;
             }
+            auto const& scope = get_scope(stmt.get(), scopes);
+            Driver driver{stmt.get(), stmt->parent(), scope.root};
+            // the same bits driven in every iteration of a loop. procedural blocks with
+            // priority are fine, and so are assignments behind a condition inside the loop,
+            // e.g. a priority encoder. drivers from the parent generator, i.e. port
+            // connections in genvar loops, target a different instance in each iteration
+            if (scope.iterations > 1 && !scope.conditional &&
+                scope.root->parent() == var->generator() &&
+                !is_block(scope.root, StatementBlockType::Combinational) &&
+                !is_block(scope.root, StatementBlockType::Latch)) {
+                throw StmtException(
+                    ::format("{0} has multiple driver in the same for loop", var->handle_name()),
+                    {var, stmt->parent(), stmt.get()});
+            }
+
             uint32_t var_low = v->var_low();
             uint32_t var_high = v->var_high();
-            for (uint32_t i = var_low; i <= var_high; i++) {
-                if (parents.find(i) != parents.end()) {
-                    auto* parent = stmt->parent();
-                    auto* stmt_parent = non_gen_root_parent(stmt.get());
-                    auto const& [ref_parent, ref_stmt_parent] = parents.at(i);
-                    // the purpose of the following statement is to make sure that there is no
-                    // other assignment that's assigning the same var slice in the same scope
-                    // it cannot be driven through different blocks, either.
-                    // notice that there is a caveat. in combinational block, as long as the
-                    // they are in the same stmt parent, they can have different scope, since
-                    // having different scope implies priority. as a result, we need to filter
-                    // this case out
-                    bool has_multiple_driver = stmt_parent != ref_stmt_parent;
-                    if (!has_multiple_driver) {
-                        // skip the special case
-                        if (parent == ref_parent) {
-                            has_multiple_driver = true;
-                            if (stmt_parent->ir_node_kind() == IRNodeKind::StmtKind) {
-                                auto* st = dynamic_cast<Stmt*>(stmt_parent);
-                                if (st && st->type() == StatementType::Block) {
-                                    auto* block = dynamic_cast<StmtBlock*>(st);
-                                    if (block->block_type() == StatementBlockType::Combinational ||
-                                        block->block_type() == StatementBlockType::Latch) {
-                                        has_multiple_driver = false;
-                                    }
-                                }
-                            }
-                        } else {
-                            if (stmt_parent->ir_node_kind() == IRNodeKind::StmtKind) {
-                                auto* st = dynamic_cast<Stmt*>(stmt_parent);
-                                if (st && st->type() == StatementType::Block) {
-                                    auto* block = dynamic_cast<StmtBlock*>(st);
-                                    if (block->block_type() == StatementBlockType::Sequential) {
-                                        // TODO: this algorithm is not perfect as it only
-                                        //  accounts for standalone assignments
-                                        has_multiple_driver = !share_root(parent, ref_parent);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    if (has_multiple_driver) {
-                        throw StmtException(::format("{0} has multiple driver in the same scope",
-                                                     var->handle_name()),
-                                            {var, parent, stmt.get()});
-                    }
-                } else {
-                    parents.emplace(
-                        i, std::make_pair(stmt->parent(), non_gen_root_parent(stmt.get())));
+            // find the first range that may overlap
+            auto iter = ranges.upper_bound(var_low);
+            if (iter != ranges.begin() && std::prev(iter)->second.high >= var_low) iter--;
+            std::vector<std::pair<uint32_t, uint32_t>> gaps;
+            uint64_t next = var_low;
+            for (; iter != ranges.end() && iter->first <= var_high; iter++) {
+                auto const& [high, ref] = iter->second;
+                if (has_multiple_driver(driver, ref, scopes)) {
+                    throw StmtException(::format("{0} has multiple driver in the same scope",
+                                                 var->handle_name()),
+                                        {var, driver.parent, stmt.get()});
                 }
+                if (iter->first > next) gaps.emplace_back(next, iter->first - 1);
+                next = std::max<uint64_t>(next, static_cast<uint64_t>(high) + 1);
             }
-        }
-    }
-
-    static Stmt* non_gen_root_parent(Stmt* stmt) {
-        // this is just to get the root stmt parent that's holding given stmt
-        IRNode* parent = stmt;
-        uint32_t count = 0;
-        while (parent->parent() && parent->parent()->ir_node_kind() == IRNodeKind::StmtKind) {
-            parent = parent->parent();
-            // this is to prevent infinite loop
-            if (count++ > 10000) {
-                throw InternalException(::format("Unable to find parent for statement"));
+            if (next <= var_high) gaps.emplace_back(next, var_high);
+            for (auto const& [low, high] : gaps) {
+                ranges.emplace(low, DrivenRange{high, driver});
             }
         }
-        return reinterpret_cast<Stmt*>(parent);
     }
 };
 
 void check_multiple_driver(Generator* top) {
     MultipleDriverVisitor visitor;
-    visitor.visit_content(top);
+    visitor.visit_generator_root_p(top);
 }
 
 class CombinationalLoopVisitor : public IRVisitor {
@@ -3331,112 +4147,103 @@ std::string get_trigger_attribute(const std::shared_ptr<StmtBlock>& blk) {
 class SSATransformFixVisitor : public IRVisitor {
 public:
     void visit(Generator* gen) override {
-        auto stmts = gen->get_all_stmts();
-        std::set<std::shared_ptr<Stmt>> remove_stmts;
-        for (auto const& stmt : stmts) {
+        std::vector<std::shared_ptr<StmtBlock>> blocks;
+        // marked by the user through add_always(ssa_transform=True)
+        for (auto const& stmt : gen->get_all_stmts()) {
             if (stmt->type() == StatementType::Block && stmt->has_attribute("ssa")) {
                 auto blk_stmt = stmt->as<StmtBlock>();
                 if (blk_stmt->block_type() == StatementBlockType::Combinational) {
-                    process_always_comb(blk_stmt, gen);
-                    remove_stmts.emplace(stmt);
+                    blocks.emplace_back(blk_stmt);
                 }
             }
         }
-        // clean the unused always_comb
-        for (auto const& stmt : remove_stmts) {
-            gen->remove_stmt(stmt);
+        if (!blocks.empty()) blocks_.emplace_back(gen, std::move(blocks));
+    }
+
+    void process() {
+        // blocks are independent of each other, so their scopes can be fixed in parallel
+        uint32_t num_cpus = get_num_cpus();
+        cxxpool::thread_pool pool{num_cpus};
+        std::vector<std::future<void>> tasks;
+        for (auto const& [gen, blocks] : blocks_) {
+            for (auto const& blk : blocks) {
+                tasks.emplace_back(pool.push(process_always_comb, blk));
+            }
         }
+        for (auto& task : tasks) task.get();
+
+        // moving the assignments to the generator is cheap, but it touches the
+        // connections of vars shared among generators
+        for (auto const& [gen, blocks] : blocks_) move_stmts(gen, blocks);
     }
 
 private:
-    static void process_always_comb(const std::shared_ptr<StmtBlock>& blk, Generator* gen) {
+    std::vector<std::pair<Generator*, std::vector<std::shared_ptr<StmtBlock>>>> blocks_;
+
+    static void process_always_comb(const std::shared_ptr<StmtBlock>& blk) {
         // also need to fix the scope variables
-        // we assume that every statement here has been SSA transformed
-        using SymbolMapping = std::unordered_map<std::string, std::string>;
-        uint64_t current_scope = 1;
-        std::unordered_map<uint64_t, SymbolMapping> symbol_mappings = {{current_scope, {}}};
-        std::unordered_set<Stmt*> stmts;
+        // we assume that every statement here has been SSA transformed.
+        // every new scope starts as a copy of the current one, hence a single symbol table
+        // is enough. symbols point to the SSA attribute of the target, which outlives the
+        // pass, and map to the latest assigned var
+        std::unordered_map<std::string_view, const Var*> symbols;
         auto trigger_str = get_trigger_attribute(blk);
         for (auto const& stmt : *blk) {
             if (stmt->type() != StatementType::Assign)
                 throw StmtException("Invalid SSA transform", {stmt.get()});
             auto assign_stmt = stmt->as<AssignStmt>();
-            auto* left = assign_stmt->left();
-            auto scope_id = get_target_scope(left);
-            if (scope_id) {
-                // detect when to start a new scope
-                if (current_scope != *scope_id) {
-                    // copy current scope to the new one
-                    auto const& current_mapping = symbol_mappings.at(current_scope);
-                    symbol_mappings[*scope_id] = {};
-                    for (auto const& iter : current_mapping) {
-                        symbol_mappings[*scope_id].emplace(iter);
-                    }
-                }
-                current_scope = *scope_id;
-            }
-            auto& symbol_mapping = symbol_mappings.at(current_scope);
+            auto const* left = assign_stmt->left();
             // every statement is assign, and every variable should have been SSA transformed
-            auto parse_result = get_target_var_name(left);
-            if (!parse_result) throw StmtException("Invalid SSA transform", {stmt.get()});
-            auto const& [target_scope_name, target_var_name] = *parse_result;
-            // look into its scope variables
+            auto target_name = get_target_var_name(left);
+            if (!target_name) throw StmtException("Invalid SSA transform", {stmt.get()});
+            // look into its scope variables. only copy the scope if some var gets renamed
             auto const& scope = stmt->scope_context();
-            std::map<std::string, std::pair<bool, std::string>> new_scope;
+            std::optional<std::map<std::string, std::pair<bool, std::string>>> new_scope;
             for (auto const& [name, var_map] : scope) {
-                auto const& [is_var, var_name] = var_map;
-                if (is_var && symbol_mapping.find(name) != symbol_mapping.end()) {
-                    new_scope.emplace(name, std::make_pair(true, symbol_mapping.at(name)));
-                } else {
-                    // just put it in the new scope
-                    new_scope.emplace(name, var_map);
-                }
+                if (!var_map.first) continue;
+                auto iter = symbols.find(name);
+                if (iter == symbols.end()) continue;
+                if (!new_scope) new_scope = scope;
+                new_scope->at(name) = std::make_pair(true, iter->second->to_string());
             }
-            stmt->set_scope_context(new_scope);
+            if (new_scope) stmt->set_scope_context(*new_scope);
 
             // just update the table name
             // update symbol after the scope since the left side hasn't showed up in scope yet
-            symbol_mapping[target_scope_name] = left->to_string();
+            symbols[*target_name] = left;
 
             // set the trigger property
-            auto trigger_attribute = std::make_shared<Attribute>();
-            trigger_attribute->type_str = "ssa-trigger";
-            trigger_attribute->value_str = trigger_str;
-            stmt->add_attribute(trigger_attribute);
-
-            // move the assignment to the global scope
-            gen->add_stmt(stmt);
-            stmts.emplace(stmt.get());
+            stmt->set_attribute(ssa_trigger_attribute, trigger_str);
         }
+    }
 
-        // clear out the always_comb
-        blk->clear();
-        // clear will reset the parents
-        for (auto* stmt : stmts) stmt->set_parent(gen);
+    static void move_stmts(Generator* gen, const std::vector<std::shared_ptr<StmtBlock>>& blocks) {
+        // the blocks are removed and their assignments moved to the global scope at once
+        std::unordered_set<Stmt*> removed;
+        for (auto const& blk : blocks) removed.emplace(blk.get());
+        std::vector<std::shared_ptr<Stmt>> stmts;
+        stmts.reserve(gen->stmts_count());
+        for (auto const& stmt : gen->get_all_stmts()) {
+            if (removed.find(stmt.get()) == removed.end()) stmts.emplace_back(stmt);
+        }
+        for (auto const& blk : blocks) {
+            auto begin = stmts.size();
+            stmts.insert(stmts.end(), blk->begin(), blk->end());
+            // clear out the always_comb
+            blk->clear();
+            // clear will reset the parents
+            for (auto i = begin; i < stmts.size(); i++) stmts[i]->set_parent(gen);
+        }
+        gen->set_stmts(stmts);
     }
 
-    static std::optional<std::pair<std::string, std::string>> get_target_var_name(const Var* var) {
+    static std::optional<std::string_view> get_target_var_name(const Var* var) {
         auto const& attrs = var->get_attributes();
         for (auto const& attr : attrs) {
-            auto const& value_str = attr->value_str;
+            std::string_view value_str = attr->value_str;
             if (value_str.rfind("ssa=") == 0) {
                 auto pos = value_str.rfind(':');
-                auto scope_name = value_str.substr(4, pos - 4);
-                auto var_name = value_str.substr(pos + 1);
-                return std::make_pair(scope_name, var_name);
-            }
-        }
-        return std::nullopt;
-    }
-
-    static std::optional<uint64_t> get_target_scope(const Var* var) {
-        auto const& attrs = var->get_attributes();
-        for (auto const& attr : attrs) {
-            auto const& value_str = attr->value_str;
-            auto pos = value_str.rfind("ssa-scope=");
-            if (pos == 0) {
-                auto v = value_str.substr(10);
-                return std::stoul(v);
+                return value_str.substr(4, pos - 4);
             }
         }
         return std::nullopt;
@@ -3445,7 +4252,8 @@ private:
 
 void ssa_transform_fix(Generator* top) {
     SSATransformFixVisitor visitor;
-    visitor.visit_root(top);
+    visitor.visit_generator_root(top);
+    visitor.process();
 }
 
 class GeneratorPropertyVisitor : public IRVisitor {
@@ -3514,12 +4322,7 @@ public:
     explicit GeneratorVarVisitor(bool registers_only) : registers_only_(registers_only) {}
 
     void visit(Generator* generator) override {
-        auto vars = generator->get_all_var_names();
-        for (auto const& var_name : vars) {
-            auto const& var = generator->get_var(var_name);
-            if (!var)
-                throw InternalException(
-                    ::format("Cannot get {0} from {1}", var_name, generator->name));
+        for (auto const& [var_name, var] : generator->vars()) {
             // detect if it has any non-blocking assignment
             auto const& sources = var->sources();
             if (registers_only_) {
@@ -3546,109 +4349,144 @@ private:
 class LiftGenVarInstanceVisitor : public IRVisitor {
 public:
     void visit(Generator* top) override {
-        // we are only interested in generator instances that shares the same name
-        // and has the same hash
-        std::unordered_map<uint64_t, std::vector<ModuleInstantiationStmt*>> generator_map;
+        // we are only interested in generator instances that has the same hash and are
+        // connected the same way, e.g. to the same variables or to the same arrays sliced by
+        // one bit. instances are grouped in a single pass over the statements
         // we use the hash value. I'm pretty sure that this won't catch all the corner cases
         // but it's good enough for now
         auto const* context = top->context();
+        std::vector<InstanceGroup> groups;
+        std::unordered_map<uint64_t, std::vector<uint64_t>> group_index;
         // we assume the module instantiation is done
         for (auto const& stmt : top->get_all_stmts()) {
-            if (stmt->type() == StatementType::ModuleInstantiation) {
-                auto* inst = reinterpret_cast<ModuleInstantiationStmt*>(stmt.get());
-                auto const* gen = inst->target();
-
-                if (!context->has_hash(gen)) {
-                    throw UserException("Cannot find hash for generator");
-                }
-                auto hash = context->get_hash(gen);
-                generator_map[hash].emplace_back(inst);
+            if (stmt->type() != StatementType::ModuleInstantiation) continue;
+            auto* inst = reinterpret_cast<ModuleInstantiationStmt*>(stmt.get());
+            auto const* gen = inst->target();
+            if (!context->has_hash(gen)) {
+                throw UserException("Cannot find hash for generator");
             }
+            ConnectionPattern pattern{context->get_hash(gen), {}};
+            std::vector<uint32_t> indices;
+            if (!get_connection(top, gen, pattern, indices)) continue;
+
+            auto& candidates = group_index[pattern_hash(pattern)];
+            auto pos = std::find_if(candidates.begin(), candidates.end(),
+                                    [&](uint64_t i) { return groups[i].pattern == pattern; });
+            if (pos == candidates.end()) {
+                candidates.emplace_back(groups.size());
+                groups.emplace_back(InstanceGroup{std::move(pattern), {}, {}});
+                pos = std::prev(candidates.end());
+            }
+            auto& group = groups[*pos];
+            group.instances.emplace_back(inst);
+            group.indices.emplace_back(std::move(indices));
         }
 
         // only interested in entries that has more than 1 entries
-        for (auto const& [hash, generators] : generator_map) {
-            if (generators.size() <= 1) continue;
-            std::unordered_map<std::string, PortInfo> port_mapping;
-            bool check = check_child_instance(generators, port_mapping);
-            if (check) {
-                // change it to a loop structure
-                create_gen_var_instance(generators, port_mapping);
-            }
+        std::unordered_set<Stmt*> removed_stmts;
+        for (auto const& group : groups) {
+            if (group.instances.size() <= 1 || !check_indices(group)) continue;
+            // change it to a loop structure
+            create_gen_var_instance(top, group, removed_stmts);
+        }
+        if (removed_stmts.empty()) return;
+        std::vector<std::shared_ptr<Stmt>> stmts;
+        stmts.reserve(top->stmts_count());
+        for (auto const& stmt : top->get_all_stmts()) {
+            if (removed_stmts.find(stmt.get()) == removed_stmts.end()) stmts.emplace_back(stmt);
         }
+        top->set_stmts(stmts);
     }
 
 private:
-    using PortInfo = std::unordered_map<std::string, std::unordered_set<uint64_t>>;
-    // NOLINTNEXTLINE
-    bool static check_child_instance(const std::vector<ModuleInstantiationStmt*>& generators,
-                                     std::unordered_map<std::string, PortInfo>& port_mapping) {
-        // check if all the ports are connected to the same variable and index
-        for (auto const* inst : generators) {
-            auto const* gen = inst->target();
-            for (auto const& port_name : gen->get_port_names()) {
-                auto const& port = gen->get_port(port_name);
-                // get connected net
-                // we assume the port connections are already checked
-                Var* net;
-                if (port->port_direction() == PortDirection::In) {
-                    auto const& stmt = *port->sources().begin();
-                    net = stmt->right();
-                } else {
-                    auto const& stmt = *port->sinks().begin();
-                    net = stmt->left();
-                    // if it's a fanout to a sliced net
-                    if (net->sinks().size() == 1) {
-                        auto const &next_stmt = *net->sinks().begin();
-                        auto *n = next_stmt->left();
-                        if (n->type() == VarType::Slice) {
-                            net = n;
-                        }
+    struct ConnectionPattern {
+        uint64_t hash;
+        // in port name order, the connected variable and whether it's sliced by one bit
+        std::vector<std::pair<Var*, bool>> nets;
+
+        bool operator==(const ConnectionPattern& pattern) const {
+            return hash == pattern.hash && nets == pattern.nets;
+        }
+    };
+
+    struct InstanceGroup {
+        ConnectionPattern pattern;
+        std::vector<ModuleInstantiationStmt*> instances;
+        // per instance, the bit index of every sliced port
+        std::vector<std::vector<uint32_t>> indices;
+    };
+
+    static uint64_t pattern_hash(const ConnectionPattern& pattern) {
+        uint64_t hash = pattern.hash;
+        for (auto const& [var, sliced] : pattern.nets) {
+            uint64_t values[] = {hash, reinterpret_cast<uint64_t>(var), sliced};
+            hash = hash_64_fnv1a(values, sizeof(values));
+        }
+        return hash;
+    }
+
+    static bool get_connection(Generator* top, const Generator* gen, ConnectionPattern& pattern,
+                               std::vector<uint32_t>& indices) {
+        auto const& port_names = gen->get_port_names();
+        pattern.nets.reserve(port_names.size());
+        for (auto const& port_name : port_names) {
+            auto const& port = gen->get_port(port_name);
+            // get connected net
+            // we assume the port connections are already checked
+            Var* net;
+            if (port->port_direction() == PortDirection::In) {
+                if (port->sources().empty()) return false;
+                auto const& stmt = *port->sources().begin();
+                net = stmt->right();
+            } else {
+                if (port->sinks().empty()) return false;
+                auto const& stmt = *port->sinks().begin();
+                net = stmt->left();
+                // if it's a fanout to a sliced net
+                if (net->sinks().size() == 1) {
+                    auto const& next_stmt = *net->sinks().begin();
+                    auto* n = next_stmt->left();
+                    if (n->type() == VarType::Slice) {
+                        net = n;
                     }
                 }
-                if (net->type() == VarType::Slice) {
-                    auto* slice = reinterpret_cast<VarSlice*>(net);
-                    auto* parent = slice->parent_var;
-                    if (slice->high != slice->low) {
-                        // ranged slice not allowed
-                        return false;
-                    }
-                    port_mapping[port_name][parent->to_string()].emplace(slice->high);
-                } else {
-                    port_mapping[port_name][net->to_string()] = {};
-                }
-            }
-        }
-
-        // make sure all the array match
-        return std::all_of(port_mapping.begin(), port_mapping.end(),
-                           [&generators](auto const& iter) -> bool {
-                               auto const& [port_name, info] = iter;
-                               // has to have one parent
-                               if (info.size() != 1) {
-                                   return false;
-                               }
-                               // if it's array slicing
-                               auto const& links = info.begin()->second;
-                               if (!links.empty()) {
-                                   // has to match with the array size
-                                   if (links.size() != generators.size()) {
-                                       return false;
-                                   }
-                                   for (uint64_t i = 0; i < generators.size(); i++) {
-                                       if (links.find(i) == links.end()) {
-                                           return false;
-                                       }
-                                   }
-                               }
-                               return true;
-                           });
-    }
-
-    static void create_gen_var_instance(
-        const std::vector<ModuleInstantiationStmt*>& generators,
-        const std::unordered_map<std::string, PortInfo>& port_mapping) {
-        auto* gen = generators[0]->generator_parent();
+            }
+            bool sliced = net->type() == VarType::Slice;
+            if (sliced) {
+                auto* slice = reinterpret_cast<VarSlice*>(net);
+                if (slice->high != slice->low) {
+                    // ranged slice not allowed
+                    return false;
+                }
+                indices.emplace_back(slice->high);
+                net = slice->parent_var;
+            }
+            // has to be a named variable in the parent, since the loop body refers to it
+            auto var = top->get_var(net->to_string());
+            if (var.get() != net) return false;
+            pattern.nets.emplace_back(net, sliced);
+        }
+        return true;
+    }
+
+    static bool check_indices(const InstanceGroup& group) {
+        // every array has to be sliced exactly once at each index
+        auto const size = group.instances.size();
+        auto const num_sliced = group.indices.front().size();
+        for (uint64_t i = 0; i < num_sliced; i++) {
+            std::vector<bool> visited(size, false);
+            for (auto const& indices : group.indices) {
+                auto index = indices[i];
+                if (index >= size || visited[index]) return false;
+                visited[index] = true;
+            }
+        }
+        return true;
+    }
+
+    static void create_gen_var_instance(Generator* gen, const InstanceGroup& group,
+                                        std::unordered_set<Stmt*>& removed_stmts) {
+        auto const& generators = group.instances;
         // need to allocate a var name
         auto const new_var = gen->get_unique_variable_name("", "i");
         // need to create a for loop with genvar loop variable
@@ -3659,37 +4497,40 @@ private:
         gen->add_stmt(for_stmt);
         auto blk_name = find_common_instance_name(generators);
         gen->add_named_block(blk_name, for_stmt->get_loop_body());
+        // the loop body refers to the same variables for every instance
+        std::vector<std::shared_ptr<Var>> target_vars;
+        target_vars.reserve(group.pattern.nets.size());
+        for (auto const& [net, sliced] : group.pattern.nets) {
+            auto target_var_base = net->shared_from_this();
+            if (sliced) {
+                target_vars.emplace_back(target_var_base->operator[](iter).shared_from_this());
+            } else {
+                target_vars.emplace_back(target_var_base);
+            }
+        }
         for (auto* inst : generators) {
             // remove statement first
-            // const cast
+            // the statements are removed from the generator all at once by the caller
             auto* s = const_cast<ModuleInstantiationStmt*>(inst);
             for_stmt->add_genvar_stmt(s->shared_from_this());
-            gen->remove_stmt(s->shared_from_this());
+            removed_stmts.emplace(s);
             s->set_parent(for_stmt.get());
             auto const* child = inst->target();
             // need to rewrite all the connections
             // first we remove all of the connections
             // remote_stmt will take care of the connection if it doesn't exist
-            for (auto const& [port_name, info] : port_mapping) {
+            uint64_t i = 0;
+            for (auto const& port_name : child->get_port_names()) {
                 auto port = child->get_port(port_name);
-                // get the target_var
-                auto mapping = *info.begin();
-                auto const& target_name = mapping.first;
-                auto const& target_var_base = gen->get_var(target_name);
-                std::shared_ptr<Var> target_var;
-                if (mapping.second.empty()) {
-                    target_var = target_var_base;
-                } else {
-                    target_var = target_var_base->operator[](iter).shared_from_this();
-                }
+                auto const& target_var = target_vars[i++];
                 if (port->port_direction() == PortDirection::In) {
                     auto const& source_stmt = *port->sources().begin();
-                    gen->remove_stmt(source_stmt);
+                    removed_stmts.emplace(source_stmt.get());
                     port->clear_sources(false);
                     port->add_source(port->assign(target_var));
                 } else {
                     auto const& sink_stmt = *port->sinks().begin();
-                    gen->remove_stmt(sink_stmt);
+                    removed_stmts.emplace(sink_stmt.get());
                     port->add_sink(target_var->assign(port));
                     port->clear_sinks(false);
                 }
@@ -3702,35 +4543,28 @@ private:
 
             // name all the instance name to inst
             // remove const cast hack
-            auto *target_inst = const_cast<Generator*>(s->target());
+            auto* target_inst = const_cast<Generator*>(s->target());
             target_inst->instance_name = "inst";
         }
     }
 
     static std::string find_common_instance_name(
         const std::vector<ModuleInstantiationStmt*>& generators) {
-        std::stringstream gen_inst_name;
-        auto const& inst_ref = generators[0]->target()->instance_name;
-        for (uint64_t s = 0; s < inst_ref.size(); s++) {
-            bool diff = false;
-            for (uint64_t i = 1; i < generators.size(); i++) {
-                auto const& c = generators[i]->target()->instance_name[s];
-                if (c != inst_ref[s]) {
-                    diff = true;
-                    break;
-                }
-            }
-            if (diff) {
-                break;
-            } else {
-                gen_inst_name << inst_ref[s];
-            }
-        }
-        auto str = gen_inst_name.str();
+        // the common prefix of all the names is the one shared by the first and the last
+        // name in sorted order
+        auto [first, last] = std::minmax_element(
+            generators.begin(), generators.end(), [](auto const* a, auto const* b) {
+                return a->target()->instance_name < b->target()->instance_name;
+            });
+        auto const& first_name = (*first)->target()->instance_name;
+        auto const& last_name = (*last)->target()->instance_name;
+        auto length = std::mismatch(first_name.begin(), first_name.end(), last_name.begin(),
+                                    last_name.end())
+                          .first -
+                      first_name.begin();
+        auto str = first_name.substr(0, length);
         // remote _ at the end
-        while (str[str.size() - 1] == '_') {
-            str = str.substr(0, str.size() - 1);
-        }
+        while (!str.empty() && str.back() == '_') str.pop_back();
         // if it's empty, use gen_blk and the definition name
         if (str.empty()) {
             str = "genblk_" + generators[0]->target()->name;
@@ -3742,7 +4576,7 @@ private:
 void lift_genvar_instances(Generator* top) {
     LiftGenVarInstanceVisitor visitor;
     // only local to the current generator so we can run it in parallel
-    visitor.visit_generator_root(top);
+    visitor.visit_generator_root_p(top);
 }
 
 std::vector<std::string> extract_register_names(Generator* top) {
@@ -3782,10 +4616,21 @@ void PassManager::add_pass(const std::string& name) {
 }
 
 void PassManager::run_passes(Generator* generator) {
-    for (const auto& fn_name : passes_order_) {
-        auto fn = passes_.at(fn_name);
-        fn(generator);
+    auto* context = generator->context();
+    bool const incremental = context && context->incremental();
+    // nothing changed since the last codegen
+    if (incremental && !generator->is_dirty()) return;
+    if (incremental) context->set_incremental_run(true);
+    try {
+        for (const auto& fn_name : passes_order_) {
+            auto fn = passes_.at(fn_name);
+            fn(generator);
+        }
+    } catch (...) {
+        if (incremental) context->set_incremental_run(false);
+        throw;
     }
+    if (incremental) context->set_incremental_run(false);
 }
 
 void PassManager::register_builtin_passes() {
@@ -3835,6 +4680,8 @@ void PassManager::register_builtin_passes() {
 
     register_pass("inject_clock_break_points", &inject_clock_break_points);
 
+    register_pass("inject_breakpoint_bitmap", &inject_breakpoint_bitmap);
+
     register_pass("inject_assert_fail_exception", &inject_assert_fail_exception);
 
     register_pass("insert_verilator_public", &insert_verilator_public);
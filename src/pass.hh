@@ -10,6 +10,11 @@
 namespace kratos {
 
 enum class HashStrategy : int { SequentialHash, ParallelHash };
+struct ActivityProfile;
+
+// typed attributes set and consumed by the builtin passes
+extern const AttributeKey<std::string> ssa_trigger_attribute;
+extern const AttributeKey<bool> check_assignment_attribute;
 
 void fix_assignment_type(Generator* top);
 
@@ -111,6 +116,9 @@ void merge_wire_assignments(Generator* top);
 void insert_pipeline_stages(Generator* top);
 
 void auto_insert_clock_enable(Generator *top);
+// only gates the register groups whose activity factor in the profile is below the
+// threshold. busy registers are rarely idle, so the enable logic doesn't pay off
+void auto_insert_clock_enable(Generator *top, const ActivityProfile &profile, double threshold);
 
 void auto_insert_sync_reset(Generator *top);
 
@@ -1,11 +1,14 @@
 #include "sim.hh"
 
+#include <random>
+
 #include "eval.hh"
 #include "except.hh"
 #include "fmt/format.h"
 #include "pass.hh"
 #include "stmt.hh"
 #include "util.hh"
+#include "visitor.hh"
 
 using fmt::format;
 
@@ -181,7 +184,7 @@ private:
     };
 };
 
-Simulator::Simulator(kratos::Generator *generator) {
+Simulator::Simulator(kratos::Generator *generator) : generator_(generator) {
     if (!generator) return;
     // fix the assignment type
     fix_assignment_type(generator);
@@ -191,6 +194,19 @@ Simulator::Simulator(kratos::Generator *generator) {
     visitor.visit_generator_root_p(generator);
     dependency_ = visitor.dependency();
     linked_dependency_ = visitor.linked_dependency();
+    // clocks are the vars that trigger sequential blocks on the rising edge
+    for (auto const &[var, stmts] : dependency_) {
+        for (auto const *stmt : stmts) {
+            if (stmt->type() != StatementType::Block) continue;
+            auto const *block = reinterpret_cast<const StmtBlock *>(stmt);
+            if (block->block_type() != StatementBlockType::Sequential) continue;
+            auto const &conditions =
+                reinterpret_cast<const SequentialStmtBlock *>(block)->get_conditions();
+            for (auto const &[edge, v] : conditions) {
+                if (edge == BlockEdgeType::Posedge && v.get() == var) clocks_.emplace(var);
+            }
+        }
+    }
     init_pull_up_value(generator);
 }
 
@@ -279,11 +295,16 @@ void Simulator::set_value_(const kratos::Var *var, std::optional<uint64_t> op_va
     } else if (var->type() == VarType::Slice) {
         auto const *root = var->get_var_root_parent();
         std::vector<uint64_t *> values;
+        // the bits that have never been set are not toggles
+        bool init = false;
         if (root->type() == VarType::ConstValue || root->type() == VarType::Parameter) {
             throw UserException(::format("Cannot set value for constant {0}", var->handle_name()));
         } else if (root->size().size() == 1 && root->size().front() == 1) {
             // this is size one
-            if (values_.find(root) == values_.end()) values_[root] = 0;
+            if (values_.find(root) == values_.end()) {
+                values_[root] = 0;
+                init = true;
+            }
             values = {&values_.at(root)};
         } else {
             uint32_t base = 1;
@@ -291,6 +312,7 @@ void Simulator::set_value_(const kratos::Var *var, std::optional<uint64_t> op_va
                 base *= s;
             }
             if (complex_values_.find(root) == complex_values_.end()) {
+                init = true;
                 // fill in values
                 std::vector<uint64_t> v(base);
                 for (uint64_t i = 0; i < base; i++) v[i] = 0;
@@ -317,6 +339,7 @@ void Simulator::set_value_(const kratos::Var *var, std::optional<uint64_t> op_va
         value = value & (0xFFFFFFFFFFFFFFFF >> (var_high - var_low + 1));
         *v = *v | (value << var_low);
         if (*v != temp) {
+            if (!init) count_toggles(root, temp, *v);
             std::unordered_set<uint32_t> changed_bits;
             uint64_t m = (*v) ^ temp;
             for (uint32_t bit = 0; bit < root->width(); bit++) {
@@ -332,6 +355,7 @@ void Simulator::set_value_(const kratos::Var *var, std::optional<uint64_t> op_va
             auto temp = values_.at(var);
             if (temp != value) {
                 values_[var] = value;
+                count_toggles(var, temp, value);
                 uint64_t m = value ^ temp;
                 for (uint32_t bit = 0; bit < var->width(); bit++) {
                     if ((m >> bit) & 1u) {
@@ -464,6 +488,7 @@ void Simulator::set_complex_value_(const kratos::Var *var,
     for (uint32_t i = low; i <= high; i++) {
         if (*(values[i]) != value[i] || fill_in) {
             uint32_t bit_mask = (*values[i]) ^ value[i];
+            if (!fill_in) count_toggles(fill_var, *values[i], value[i]);
             *(values[i]) = value[i];
             for (uint32_t bit = 0; bit < var_width; bit++) {
                 if ((bit_mask >> bit) & 1u || fill_in) {
@@ -836,4 +861,206 @@ std::optional<std::vector<uint64_t>> Simulator::eval_expr(const kratos::Var *var
     }
 }
 
+void Simulator::count_toggles(const Var *var, uint64_t old_value, uint64_t new_value) {
+    if (!count_toggles_) return;
+    toggles_[var] += __builtin_popcountll(old_value ^ new_value);
+    if (clocks_.find(var) != clocks_.end() && !(old_value & 1u) && (new_value & 1u)) {
+        clock_edges_[var]++;
+    }
+}
+
+void Simulator::reset_toggle_count() {
+    toggles_.clear();
+    clock_edges_.clear();
+}
+
+uint64_t Simulator::toggle_count(const Var *var) const {
+    auto const *root = var->get_var_root_parent();
+    auto iter = toggles_.find(root);
+    return iter == toggles_.end() ? 0 : iter->second;
+}
+
+uint64_t Simulator::num_cycles() const {
+    // the fastest clock
+    uint64_t result = 0;
+    for (auto const &iter : clock_edges_) result = std::max(result, iter.second);
+    return result;
+}
+
+class RegisterGroupVisitor : public StmtVisitor<RegisterGroupVisitor> {
+public:
+    void visit(AssignStmt *stmt) {
+        auto const *var = stmt->left()->get_var_root_parent();
+        registers.emplace(var->handle_name(), var);
+    }
+
+    // sorted by handle names
+    std::map<std::string, const Var *> registers;
+};
+
+ActivityProfile Simulator::activity_profile() const {
+    ActivityProfile profile;
+    profile.cycles = num_cycles();
+    auto update = [&profile](ToggleActivity &activity, uint64_t toggles, uint64_t bits) {
+        activity.toggles += toggles;
+        activity.bits += bits;
+        if (profile.cycles > 0 && activity.bits > 0) {
+            activity.activity = static_cast<double>(activity.toggles) /
+                                static_cast<double>(activity.bits * profile.cycles);
+        }
+    };
+    if (!generator_) return profile;
+
+    std::vector<Generator *> generators = {generator_};
+    for (uint64_t i = 0; i < generators.size(); i++) {
+        auto *generator = generators[i];
+        if (generator->external()) continue;
+        for (auto const &child : generator->get_child_generators()) {
+            generators.emplace_back(child.get());
+        }
+        auto &generator_activity = profile.generators[generator->handle_name()];
+        for (auto const &[name, var] : generator->vars()) {
+            auto toggles = toggle_count(var.get());
+            update(profile.signals[var->handle_name()], toggles, var->width());
+            update(generator_activity, toggles, var->width());
+        }
+
+        for (uint64_t j = 0; j < generator->stmts_count(); j++) {
+            auto stmt = generator->get_stmt(j);
+            if (stmt->type() != StatementType::Block ||
+                stmt->as<StmtBlock>()->block_type() != StatementBlockType::Sequential)
+                continue;
+            RegisterGroupVisitor visitor;
+            visitor.visit_stmt(stmt.get());
+            auto &group = profile.register_groups.emplace_back();
+            group.block = reinterpret_cast<const SequentialStmtBlock *>(stmt.get());
+            group.generator = generator->handle_name();
+            for (auto const &[handle_name, var] : visitor.registers) {
+                group.registers.emplace_back(handle_name);
+                update(group.activity, toggle_count(var), var->width());
+            }
+        }
+    }
+    return profile;
+}
+
+std::string EquivalenceResult::to_string() const {
+    if (!mismatch) return ::format("No mismatch in {0} cycles", cycles);
+    auto value_str = [](const std::optional<uint64_t> &value) {
+        return value ? ::format("0x{0:X}", *value) : "x";
+    };
+    std::vector<std::string> inputs;
+    for (auto const &[name, value] : mismatch->inputs) {
+        inputs.emplace_back(::format("{0}=0x{1:X}", name, value));
+    }
+    return ::format("Mismatch at cycle {0} on {1}: expected {2}, got {3}. Inputs: {4}",
+                    mismatch->cycle, mismatch->port, value_str(mismatch->expected),
+                    value_str(mismatch->actual), fmt::join(inputs.begin(), inputs.end(), ", "));
+}
+
+class NegedgeResetVisitor : public IRVisitor {
+public:
+    void visit(SequentialStmtBlock *block) override {
+        for (auto const &[edge, var] : block->get_conditions()) {
+            if (edge != BlockEdgeType::Negedge || var->type() != VarType::PortIO) continue;
+            auto port_type = var->as<Port>()->port_type();
+            if (port_type == PortType::AsyncReset || port_type == PortType::Reset)
+                has_negedge_reset = true;
+        }
+    }
+
+    bool has_negedge_reset = false;
+};
+
+EquivalenceResult check_equivalence(Generator *reference, Generator *design, uint64_t num_cycles,
+                                    uint64_t seed) {
+    auto const port_names = reference->get_port_names();
+    if (port_names != design->get_port_names())
+        throw UserException(::format("{0} and {1} have different ports", reference->name,
+                                     design->name));
+    std::vector<std::pair<Port *, Port *>> clocks, resets, inputs, outputs;
+    for (auto const &name : port_names) {
+        auto *ref_port = reference->get_port(name).get();
+        auto *port = design->get_port(name).get();
+        if (ref_port->port_direction() != port->port_direction() ||
+            ref_port->port_type() != port->port_type() || ref_port->width() != port->width() ||
+            ref_port->is_signed() != port->is_signed())
+            throw VarException(::format("Port {0} does not match", name), {ref_port, port});
+        if (ref_port->width() > 64 || ref_port->size().size() > 1 || ref_port->size()[0] > 1)
+            throw VarException(::format("Port {0} is too wide to be checked", name), {ref_port});
+        auto pair = std::make_pair(ref_port, port);
+        if (ref_port->port_direction() == PortDirection::Out) {
+            outputs.emplace_back(pair);
+        } else if (ref_port->port_direction() == PortDirection::InOut) {
+            throw VarException(::format("Inout port {0} is not supported", name), {ref_port});
+        } else if (ref_port->port_type() == PortType::Clock) {
+            clocks.emplace_back(pair);
+        } else if (ref_port->port_type() == PortType::AsyncReset ||
+                   ref_port->port_type() == PortType::Reset) {
+            resets.emplace_back(pair);
+        } else {
+            inputs.emplace_back(pair);
+        }
+    }
+    // resets triggered on the falling edge are active low, unless specified otherwise
+    NegedgeResetVisitor visitor;
+    visitor.visit_root(reference);
+    auto reset_value = [&visitor](const Port *port, bool assert_) -> uint64_t {
+        auto active_high = port->active_high().value_or(!visitor.has_negedge_reset);
+        return assert_ == active_high;
+    };
+
+    Simulator ref_sim(reference);
+    Simulator sim(design);
+    auto set = [&](const std::pair<Port *, Port *> &ports, uint64_t value) {
+        ref_sim.set(ports.first, value);
+        sim.set(ports.second, value);
+    };
+
+    std::mt19937_64 rng(seed);
+    auto stimulus = [&rng](uint32_t width) -> uint64_t {
+        auto mask = width >= 64 ? ~0ull : (1ull << width) - 1;
+        // one in four values is a corner case
+        switch (rng() % 16) {
+            case 0:
+                return 0;
+            case 1:
+                return mask;
+            case 2:
+                return 0x5555555555555555ull & mask;
+            case 3:
+                return (1ull << (width - 1)) | 1ull;
+            default:
+                return rng() & mask;
+        }
+    };
+
+    EquivalenceResult result;
+    for (auto const &clk : clocks) set(clk, 0);
+    for (uint64_t cycle = 0; cycle < num_cycles; cycle++) {
+        std::map<std::string, uint64_t> values;
+        for (auto const &rst : resets) {
+            auto value = reset_value(rst.first, cycle == 0);
+            set(rst, value);
+            values.emplace(rst.first->name, value);
+        }
+        for (auto const &input : inputs) {
+            auto value = stimulus(input.first->width());
+            set(input, value);
+            values.emplace(input.first->name, value);
+        }
+        for (auto const &[ref_port, port] : outputs) {
+            auto expected = ref_sim.get(ref_port);
+            auto actual = sim.get(port);
+            if (expected == actual) continue;
+            result.mismatch = EquivalenceMismatch{cycle, ref_port->name, expected, actual, values};
+            return result;
+        }
+        for (auto const &clk : clocks) set(clk, 1);
+        for (auto const &clk : clocks) set(clk, 0);
+        result.cycles++;
+    }
+    return result;
+}
+
 }  // namespace kratos
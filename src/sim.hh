@@ -6,6 +6,31 @@
 
 namespace kratos {
 constexpr uint64_t MAX_SIMULATION_DEPTH = 0xFFFFFFFF;
+
+// the activity factor is the average number of toggles per bit per clock cycle
+struct ToggleActivity {
+    uint64_t toggles = 0;
+    uint64_t bits = 0;
+    double activity = 0;
+};
+
+// registers written by the same always_ff block, which share a clock enable
+struct RegisterGroupActivity {
+    const SequentialStmtBlock *block = nullptr;
+    std::string generator;
+    // handle names
+    std::vector<std::string> registers;
+    ToggleActivity activity;
+};
+
+struct ActivityProfile {
+    uint64_t cycles = 0;
+    // indexed by handle names
+    std::map<std::string, ToggleActivity> signals;
+    std::map<std::string, ToggleActivity> generators;
+    std::vector<RegisterGroupActivity> register_groups;
+};
+
 class Simulator {
 public:
     explicit Simulator(Generator *generator);
@@ -23,6 +48,14 @@ public:
 
     static uint64_t static_evaluate_expr(Var *expr);
 
+    // toggle counting is off by default. cycles are counted on the rising edges of the
+    // clocks used by the sequential blocks
+    void set_toggle_count(bool enable) { count_toggles_ = enable; }
+    void reset_toggle_count();
+    uint64_t toggle_count(const Var *var) const;
+    uint64_t num_cycles() const;
+    ActivityProfile activity_profile() const;
+
 protected:
     void set_value_(const Var *var, std::optional<uint64_t> op_value);
     void set_complex_value_(const Var *var, const std::optional<std::vector<uint64_t>> &op_value);
@@ -57,7 +90,43 @@ private:
     void init_pull_up_value(Generator *generator);
 
     uint64_t simulation_depth_ = 0;
+
+    Generator *generator_ = nullptr;
+    bool count_toggles_ = false;
+    // indexed by the root vars
+    std::unordered_map<const Var *, uint64_t> toggles_;
+    std::unordered_map<const Var *, uint64_t> clock_edges_;
+    std::unordered_set<const Var *> clocks_;
+
+    void count_toggles(const Var *var, uint64_t old_value, uint64_t new_value);
+};
+
+struct EquivalenceMismatch {
+    uint64_t cycle = 0;
+    std::string port;
+    // nullopt if the value is unknown, e.g. from a register that is not reset
+    std::optional<uint64_t> expected;
+    std::optional<uint64_t> actual;
+    // the stimulus of the mismatching cycle, indexed by the input port names
+    std::map<std::string, uint64_t> inputs;
 };
+
+struct EquivalenceResult {
+    // number of cycles that matched
+    uint64_t cycles = 0;
+    std::optional<EquivalenceMismatch> mismatch;
+
+    bool equivalent() const { return !mismatch; }
+    std::string to_string() const;
+};
+
+// simulates both generators in lockstep with the same stimulus and compares the outputs
+// every cycle, once the inputs settle. the ports have to match by name, direction, type
+// and width. every clock is pulsed once per cycle and the resets are only asserted in the
+// first one. the data inputs take random values, mixed with corner cases such as zero,
+// all ones and alternating bits. ports wider than 64 bits and arrays are not supported
+EquivalenceResult check_equivalence(Generator *reference, Generator *design,
+                                    uint64_t num_cycles = 1000, uint64_t seed = 0);
 }  // namespace kratos
 
 #endif  // KRATOS_SIM_HH
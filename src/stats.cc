@@ -0,0 +1,233 @@
+#include "stats.hh"
+
+#include "cxxpool.h"
+#include "graph.hh"
+#include "stmt.hh"
+#include "tb.hh"
+#include "util.hh"
+
+namespace kratos {
+
+void MemoryReport::merge(const MemoryReport &report) {
+    for (auto const &[kind, usage] : report.node_kinds) node_kinds[kind].merge(usage);
+    for (auto const &[name, usage] : report.generators) generators[name].merge(usage);
+    for (auto const &[name, usage] : report.modules) modules[name].merge(usage);
+    total.merge(report.total);
+}
+
+namespace {
+
+uint64_t string_size(const std::string &str) {
+    // short strings are stored inside the object itself
+    auto const *begin = reinterpret_cast<const char *>(&str);
+    auto const *data = str.data();
+    if (data >= begin && data < begin + sizeof(str)) return 0;
+    return str.capacity() + 1;
+}
+
+template <typename T>
+uint64_t vector_size(const std::vector<T> &vector) {
+    return vector.capacity() * sizeof(T);
+}
+
+// one allocated node per entry plus the bucket array
+template <typename T>
+uint64_t unordered_size(const T &container) {
+    return container.size() * (sizeof(typename T::value_type) + 2 * sizeof(void *)) +
+           container.bucket_count() * sizeof(void *);
+}
+
+// red-black tree nodes carry three pointers and the color
+template <typename T>
+uint64_t tree_size(const T &container) {
+    return container.size() * (sizeof(typename T::value_type) + 4 * sizeof(void *));
+}
+
+template <typename T>
+uint64_t table_size(const SymbolTable<T> &table) {
+    uint64_t size = table.memory_size();
+    for (auto const &[name, node] : table.entries()) size += string_size(name);
+    return size;
+}
+
+class MemoryUsageVisitor : public IRVisitor {
+public:
+    explicit MemoryUsageVisitor(Generator *generator) : generator_(generator) {}
+
+    void visit(Var *var) override { add_var(var, "Var", sizeof(Var)); }
+    void visit(Port *var) override { add_var(var, "Port", sizeof(Port)); }
+    void visit(VarSlice *var) override { add_var(var, "VarSlice", sizeof(VarSlice)); }
+    void visit(VarVarSlice *var) override { add_var(var, "VarVarSlice", sizeof(VarVarSlice)); }
+    void visit(VarConcat *var) override { add_var(var, "VarConcat", sizeof(VarConcat)); }
+    void visit(Expr *var) override { add_var(var, "Expr", sizeof(Expr)); }
+    void visit(EnumVar *var) override { add_var(var, "EnumVar", sizeof(EnumVar)); }
+    void visit(EnumConst *var) override { add_var(var, "EnumConst", sizeof(EnumConst)); }
+    void visit(Const *var) override { add_var(var, "Const", sizeof(Const)); }
+    void visit(Param *var) override { add_var(var, "Param", sizeof(Param)); }
+    void visit(FunctionCallVar *var) override {
+        add_var(var, "FunctionCallVar", sizeof(FunctionCallVar));
+    }
+
+    void visit(AssignStmt *stmt) override { add_stmt(stmt, "AssignStmt", sizeof(AssignStmt)); }
+    void visit(ScopedStmtBlock *stmt) override {
+        add_stmt(stmt, "ScopedStmtBlock", sizeof(ScopedStmtBlock));
+    }
+    void visit(IfStmt *stmt) override { add_stmt(stmt, "IfStmt", sizeof(IfStmt)); }
+    void visit(SwitchStmt *stmt) override { add_stmt(stmt, "SwitchStmt", sizeof(SwitchStmt)); }
+    void visit(ForStmt *stmt) override { add_stmt(stmt, "ForStmt", sizeof(ForStmt)); }
+    void visit(CombinationalStmtBlock *stmt) override {
+        add_stmt(stmt, "CombinationalStmtBlock", sizeof(CombinationalStmtBlock));
+    }
+    void visit(SequentialStmtBlock *stmt) override {
+        add_stmt(stmt, "SequentialStmtBlock", sizeof(SequentialStmtBlock));
+    }
+    void visit(LatchStmtBlock *stmt) override {
+        add_stmt(stmt, "LatchStmtBlock", sizeof(LatchStmtBlock));
+    }
+    void visit(FunctionStmtBlock *stmt) override {
+        add_stmt(stmt, "FunctionStmtBlock", sizeof(FunctionStmtBlock));
+    }
+    void visit(InitialStmtBlock *stmt) override {
+        add_stmt(stmt, "InitialStmtBlock", sizeof(InitialStmtBlock));
+    }
+    void visit(FunctionCallStmt *stmt) override {
+        add_stmt(stmt, "FunctionCallStmt", sizeof(FunctionCallStmt));
+    }
+    void visit(ReturnStmt *stmt) override { add_stmt(stmt, "ReturnStmt", sizeof(ReturnStmt)); }
+    void visit(ModuleInstantiationStmt *stmt) override {
+        add_stmt(stmt, "ModuleInstantiationStmt", sizeof(ModuleInstantiationStmt));
+    }
+    void visit(InterfaceInstantiationStmt *stmt) override {
+        add_stmt(stmt, "InterfaceInstantiationStmt", sizeof(InterfaceInstantiationStmt));
+    }
+    void visit(AuxiliaryStmt *stmt) override {
+        add_stmt(stmt, "AuxiliaryStmt", sizeof(AuxiliaryStmt));
+    }
+    void visit(AssertBase *stmt) override { add_stmt(stmt, "AssertBase", sizeof(AssertBase)); }
+
+    void visit(Generator *generator) override {
+        uint64_t size = sizeof(Generator) + table_size(generator->vars()) +
+                        tree_size(generator->get_port_names()) +
+                        table_size(generator->get_params()) +
+                        unordered_size(generator->exprs()) +
+                        generator->stmts_count() * sizeof(std::shared_ptr<Stmt>);
+        add("Generator", size);
+        add_string(generator->name);
+        add_string(generator->instance_name);
+        add_string(generator->verilog_fn);
+        add_node(generator);
+    }
+
+    void compute() {
+        visit(generator_);
+        for (uint64_t i = 0; i < generator_->stmts_count(); i++) {
+            visit_node(generator_->get_child(i));
+        }
+        for (auto const &iter : generator_->vars()) visit_node(iter.second.get());
+        for (auto const &iter : generator_->get_params()) visit_node(iter.second.get());
+        for (auto const &expr : generator_->exprs()) visit_node(expr.get());
+        for (auto const &iter : generator_->functions()) visit_node(iter.second.get());
+    }
+
+    const MemoryReport &report() const { return report_; }
+
+private:
+    Generator *generator_;
+    MemoryReport report_;
+
+    void visit_node(IRNode *node) {
+        if (visited_.emplace(node).second) visit_root(node);
+    }
+
+    void add(const std::string &kind, uint64_t size) {
+        report_.node_kinds[kind].add(size);
+        report_.total.add(size);
+    }
+
+    void add_string(const std::string &str) {
+        auto size = string_size(str);
+        if (size) add("string", size);
+    }
+
+    void add_node(IRNode *node) {
+        if (!node->fn_name_ln.empty()) {
+            uint64_t size = vector_size(node->fn_name_ln);
+            for (auto const &iter : node->fn_name_ln) size += string_size(iter.first);
+            add("fn_name_ln", size);
+        }
+        for (auto const &attr : node->get_attributes()) {
+            add("Attribute", sizeof(Attribute) + string_size(attr->type_str) +
+                                 string_size(attr->value_str));
+        }
+        auto const &typed_attributes = node->typed_attributes();
+        if (!typed_attributes.empty()) add("Attribute", vector_size(typed_attributes));
+        add_string(node->comment);
+    }
+
+    void add_var(Var *var, const std::string &kind, uint64_t size) {
+        // vars referenced from other generators, e.g. child ports or constants,
+        // are accounted by their owners
+        if (var->generator() != generator_) return;
+        size += unordered_size(var->sinks()) + unordered_size(var->sources()) +
+                vector_size(var->get_slices());
+        add(kind, size);
+        add_string(var->name);
+        add_string(var->before_var_str());
+        add_string(var->after_var_str());
+        add_node(var);
+    }
+
+    void add_stmt(Stmt *stmt, const std::string &kind, uint64_t size) {
+        size += tree_size(stmt->scope_context());
+        add(kind, size);
+        add_node(stmt);
+    }
+};
+
+MemoryReport compute_generator_memory_usage(Generator *generator) {
+    MemoryUsageVisitor visitor(generator);
+    visitor.compute();
+    auto report = visitor.report();
+    report.generators[generator->handle_name()] = report.total;
+    report.modules[generator->name] = report.total;
+    return report;
+}
+
+MemoryReport compute_memory_usage(const std::vector<Generator *> &generators) {
+    uint32_t num_cpus = get_num_cpus();
+    cxxpool::thread_pool pool{num_cpus};
+    std::vector<std::future<MemoryReport>> tasks;
+    tasks.reserve(generators.size());
+    for (auto *gen : generators) {
+        tasks.emplace_back(pool.push(compute_generator_memory_usage, gen));
+    }
+    MemoryReport result;
+    for (auto &task : tasks) {
+        result.merge(task.get());
+    }
+    return result;
+}
+
+}  // namespace
+
+MemoryReport compute_memory_usage(Generator *top) {
+    auto graph = generator_hierarchy(top);
+    return compute_memory_usage(graph->get_sorted_generators());
+}
+
+MemoryReport compute_memory_usage(Context *context) {
+    std::vector<Generator *> generators;
+    std::unordered_set<Generator *> visited;
+    auto add_generator = [&](Generator *gen) {
+        if (visited.emplace(gen).second) generators.emplace_back(gen);
+    };
+    for (auto const &name : context->get_generator_names()) {
+        for (auto const &gen : context->get_generators_by_name(name)) {
+            add_generator(gen.get());
+            for (auto const &clone : gen->get_clones()) add_generator(clone.get());
+        }
+    }
+    return compute_memory_usage(generators);
+}
+
+}  // namespace kratos
@@ -0,0 +1,46 @@
+#ifndef KRATOS_STATS_HH
+#define KRATOS_STATS_HH
+
+#include "generator.hh"
+
+namespace kratos {
+
+struct MemoryUsage {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+
+    void add(uint64_t size) {
+        count++;
+        bytes += size;
+    }
+    void merge(const MemoryUsage &usage) {
+        count += usage.count;
+        bytes += usage.bytes;
+    }
+};
+
+// estimated memory footprint of the IR. node sizes are computed from the static
+// type of each node plus the heap storage of its strings and containers;
+// allocator overhead is not included. constants are shared by every generator
+// and therefore not attributed to any of them
+struct MemoryReport {
+    // indexed by node kind, e.g. Var, Expr, AssignStmt, as well as the
+    // auxiliary storage: Attribute, fn_name_ln and string
+    std::map<std::string, MemoryUsage> node_kinds;
+    // indexed by generator handle name
+    std::map<std::string, MemoryUsage> generators;
+    // indexed by module (generator) name
+    std::map<std::string, MemoryUsage> modules;
+    MemoryUsage total;
+
+    void merge(const MemoryReport &report);
+};
+
+// only generators reachable from top
+MemoryReport compute_memory_usage(Generator *top);
+// every generator owned by the context
+MemoryReport compute_memory_usage(Context *context);
+
+}  // namespace kratos
+
+#endif  // KRATOS_STATS_HH
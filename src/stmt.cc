@@ -392,6 +392,7 @@ void StmtBlock::add_stmt(const std::shared_ptr<Stmt> &stmt) {
     }
     stmt->set_parent(this);
     stmts_.emplace_back(stmt);
+    if (auto *gen = generator_parent()) gen->mark_dirty();
 }
 
 void StmtBlock::clear() {
@@ -410,13 +411,17 @@ void StmtBlock::set_parent(IRNode *parent) {
 
 void StmtBlock::remove_stmt(const std::shared_ptr<kratos::Stmt> &stmt) {
     auto pos = std::find(stmts_.begin(), stmts_.end(), stmt);
-    if (pos != stmts_.end()) stmts_.erase(pos);
+    if (pos != stmts_.end()) {
+        stmts_.erase(pos);
+        if (auto *gen = generator_parent()) gen->mark_dirty();
+    }
 }
 
 void StmtBlock::set_child(uint64_t index, const std::shared_ptr<Stmt> &stmt) {
     if (index < stmts_.size()) {
         stmts_[index] = stmt;
         stmt->set_parent(this);
+        if (auto *gen = generator_parent()) gen->mark_dirty();
     }
 }
 
@@ -0,0 +1,126 @@
+#include "summary.hh"
+
+#include "except.hh"
+#include "fmt/format.h"
+#include "stmt.hh"
+
+using fmt::format;
+
+namespace kratos {
+
+BitRanges driven_bits(Var *port) {
+    BitRanges ranges;
+    auto const width = port->width();
+    if (!width) return ranges;
+    for (auto const &stmt : port->sources()) {
+        auto *src = stmt->left();
+        if (src->type() != VarType::Slice) {
+            // driven as a whole
+            return {{0, width - 1}};
+        }
+        auto *ptr = reinterpret_cast<VarSlice *>(src);
+        if (ptr->get_var_root_parent() != port) {
+            // it got be a sliced by var
+            if (!ptr->sliced_by_var())
+                throw VarException("Internal error. Variable has un-related sources", {port});
+            // it's actually not driven by the current net
+            continue;
+        }
+        if (ptr->sliced_by_var()) {
+            // possibly to hit all bits
+            return {{0, width - 1}};
+        }
+        ranges.emplace_back(ptr->var_low(), ptr->var_high());
+    }
+    if (ranges.empty()) return ranges;
+    // merge the overlapping and adjacent ranges
+    std::sort(ranges.begin(), ranges.end());
+    BitRanges result;
+    result.reserve(ranges.size());
+    result.emplace_back(ranges.front());
+    for (uint64_t i = 1; i < ranges.size(); i++) {
+        auto &last = result.back();
+        auto const &[low, high] = ranges[i];
+        if (static_cast<uint64_t>(low) <= static_cast<uint64_t>(last.second) + 1) {
+            last.second = std::max(last.second, high);
+        } else {
+            result.emplace_back(low, high);
+        }
+    }
+    return result;
+}
+
+BitRanges undriven_bits(const BitRanges &ranges, uint32_t width) {
+    BitRanges result;
+    uint64_t next = 0;
+    for (auto const &[low, high] : ranges) {
+        if (low >= width) break;
+        if (low > next) result.emplace_back(next, low - 1);
+        next = std::max<uint64_t>(next, static_cast<uint64_t>(high) + 1);
+    }
+    if (next < width) result.emplace_back(next, width - 1);
+    return result;
+}
+
+class ModuleSummaryVisitor : public IRVisitor {
+public:
+    explicit ModuleSummaryVisitor(ModuleSummaries *summaries) : summaries_(summaries) {}
+
+    void visit(Generator *generator) override {
+        auto *def = generator->is_cloned() ? generator->def_instance() : generator;
+        if (!def) return;
+        {
+            std::lock_guard guard(summaries_->lock_);
+            // only the first instance computes the summary
+            if (!summaries_->summaries_.emplace(def, ModuleSummary{}).second) return;
+        }
+        auto summary = compute(def);
+        std::lock_guard guard(summaries_->lock_);
+        summaries_->summaries_.at(def) = std::move(summary);
+    }
+
+private:
+    ModuleSummaries *summaries_;
+
+    static ModuleSummary compute(Generator *generator) {
+        ModuleSummary summary;
+        for (auto const &port_name : generator->get_port_names()) {
+            auto port = generator->get_port(port_name);
+            auto &port_summary = summary.ports[port_name];
+            if (port->port_direction() != PortDirection::In)
+                port_summary.driven_bits = driven_bits(port.get());
+        }
+
+        // sequential blocks are always at the top level
+        for (auto const &stmt : generator->get_all_stmts()) {
+            if (stmt->type() != StatementType::Block) continue;
+            auto block = stmt->as<StmtBlock>();
+            if (block->block_type() != StatementBlockType::Sequential) continue;
+            auto seq = stmt->as<SequentialStmtBlock>();
+            for (auto const &[edge, var] : seq->get_conditions()) {
+                if (var->type() != VarType::PortIO) continue;
+                auto const *port = reinterpret_cast<const Port *>(var.get());
+                if (port->port_type() != PortType::AsyncReset) continue;
+                summary.resets.emplace(port,
+                                       ResetSummary{edge == BlockEdgeType::Posedge, stmt.get()});
+            }
+        }
+        return summary;
+    }
+};
+
+ModuleSummaries::ModuleSummaries(Generator *top) {
+    ModuleSummaryVisitor visitor(this);
+    visitor.visit_generator_root_p(top);
+}
+
+const ModuleSummary &ModuleSummaries::get(Generator *generator) const {
+    auto *def = generator->is_cloned() ? generator->def_instance() : generator;
+    auto iter = summaries_.find(def);
+    if (iter == summaries_.end())
+        throw InternalException(
+            ::format("Unable to find module summary for {0}", generator->handle_name()));
+    return iter->second;
+}
+
+}  // namespace kratos
@@ -0,0 +1,54 @@
+#ifndef KRATOS_SUMMARY_HH
+#define KRATOS_SUMMARY_HH
+
+#include <mutex>
+
+#include "generator.hh"
+
+namespace kratos {
+
+// sorted, non-overlapping inclusive bit ranges [low, high]
+using BitRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// bits of the port driven by its sources
+BitRanges driven_bits(Var *port);
+// bits in [0, width) that are not covered by the ranges
+BitRanges undriven_bits(const BitRanges &ranges, uint32_t width);
+
+struct PortSummary {
+    // bits driven from within the module. not computed for inputs since they are
+    // driven by the parent, which differs per instance
+    BitRanges driven_bits;
+};
+
+struct ResetSummary {
+    // inferred from the first sequential block triggered by the reset
+    bool active_high;
+    Stmt *stmt;
+};
+
+// per-definition facts that hierarchical checks need about a module. clones share
+// the summary of their definition
+struct ModuleSummary {
+    std::map<std::string, PortSummary> ports;
+    // async resets used by the sequential blocks, including child ports
+    std::unordered_map<const Port *, ResetSummary> resets;
+};
+
+class ModuleSummaries {
+public:
+    // summaries are computed bottom-up, one per definition reachable from top
+    explicit ModuleSummaries(Generator *top);
+
+    const ModuleSummary &get(Generator *generator) const;
+
+private:
+    std::unordered_map<const Generator *, ModuleSummary> summaries_;
+    std::mutex lock_;
+
+    friend class ModuleSummaryVisitor;
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_SUMMARY_HH
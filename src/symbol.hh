@@ -0,0 +1,278 @@
+#ifndef KRATOS_SYMBOL_HH
+#define KRATOS_SYMBOL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kratos {
+
+// name -> node table used by the generator. entries are kept in insertion order and
+// indexed by an open-addressing hash table with linear probing. iteration goes through
+// a sorted view that is cached until the next insertion or rename, so it visits the
+// entries in the same order as the std::map it replaces. like the std::map, iterators
+// stay valid when other entries are added or erased: an iterator holds on to the view it
+// started with and skips the erased entries, and the erased entries are only compacted
+// away once no view is in use
+template <typename T>
+class SymbolTable {
+    // entry indices sorted by name
+    using View = std::vector<uint32_t>;
+
+public:
+    using value_type = std::pair<std::string, std::shared_ptr<T>>;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = SymbolTable::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        const_iterator() = default;
+
+        reference operator*() const { return table_->entries_[(*view_)[pos_]]; }
+        pointer operator->() const { return &(**this); }
+        const_iterator &operator++() {
+            pos_++;
+            skip_erased();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+        bool operator==(const const_iterator &iter) const {
+            if (at_end() || iter.at_end()) return at_end() == iter.at_end();
+            return view_ == iter.view_ && pos_ == iter.pos_;
+        }
+        bool operator!=(const const_iterator &iter) const { return !(*this == iter); }
+
+    private:
+        const_iterator(const SymbolTable *table, std::shared_ptr<const View> view, uint64_t pos)
+            : table_(table), view_(std::move(view)), pos_(pos) {
+            skip_erased();
+        }
+
+        const SymbolTable *table_ = nullptr;
+        std::shared_ptr<const View> view_;
+        uint64_t pos_ = 0;
+
+        [[nodiscard]] bool at_end() const { return !view_ || pos_ >= view_->size(); }
+        void skip_erased() {
+            while (!at_end() && !table_->entries_[(*view_)[pos_]].second) pos_++;
+        }
+
+        friend class SymbolTable;
+    };
+    using iterator = const_iterator;
+
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable &table)
+        : entries_(table.entries_), slots_(table.slots_), size_(table.size_) {}
+    SymbolTable &operator=(const SymbolTable &table) {
+        if (this != &table) {
+            entries_ = table.entries_;
+            slots_ = table.slots_;
+            size_ = table.size_;
+            invalidate();
+        }
+        return *this;
+    }
+
+    [[nodiscard]] uint64_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    const_iterator begin() const { return const_iterator(this, view(), 0); }
+    const_iterator end() const { return const_iterator(); }
+
+    const_iterator find(std::string_view name) const {
+        if (lookup(name) == npos) return end();
+        auto sorted = view();
+        // erased entries keep their name, so the view stays sorted
+        auto pos = std::lower_bound(
+            sorted->begin(), sorted->end(), name,
+            [this](uint32_t index, std::string_view n) { return entries_[index].first < n; });
+        return const_iterator(this, sorted, pos - sorted->begin());
+    }
+    [[nodiscard]] uint64_t count(std::string_view name) const { return lookup(name) != npos; }
+
+    // direct access without going through the sorted view. returns nullptr if not found
+    std::shared_ptr<T> get(std::string_view name) const {
+        auto index = lookup(name);
+        return index == npos ? nullptr : entries_[index].second;
+    }
+    const std::shared_ptr<T> &at(std::string_view name) const {
+        auto index = lookup(name);
+        if (index == npos) throw std::out_of_range(std::string(name));
+        return entries_[index].second;
+    }
+
+    // entries in insertion order. erased entries have an empty value
+    const std::vector<value_type> &entries() const { return entries_; }
+
+    bool emplace(const std::string &name, std::shared_ptr<T> value) {
+        if (lookup(name) != npos) return false;
+        if ((entries_.size() + 1) * 2 > slots_.size()) rehash();
+        auto index = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back(name, std::move(value));
+        insert_slot(index);
+        size_++;
+        invalidate();
+        return true;
+    }
+
+    uint64_t erase(std::string_view name) {
+        auto index = lookup(name);
+        if (index == npos) return 0;
+        erase_slot(index);
+        // the hole is removed the next time the table is compacted. the view doesn't
+        // change since the iterators skip the holes
+        entries_[index].second = nullptr;
+        size_--;
+        if (entries_.size() > 2 * size_ + 16) rehash();
+        return 1;
+    }
+
+    // changes the key of an entry without changing its insertion order
+    bool rename(std::string_view old_name, const std::string &new_name) {
+        auto index = lookup(old_name);
+        if (index == npos || lookup(new_name) != npos) return false;
+        erase_slot(index);
+        entries_[index].first = new_name;
+        insert_slot(index);
+        invalidate();
+        return true;
+    }
+
+    void clear() {
+        entries_.clear();
+        slots_.clear();
+        size_ = 0;
+        invalidate();
+    }
+
+    // approximated memory footprint of the table itself. the sorted view is left out since
+    // it's only built on demand for iteration
+    [[nodiscard]] uint64_t memory_size() const {
+        return entries_.capacity() * sizeof(value_type) + slots_.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+    // slot values are entry index + 1, 0 means empty
+    static constexpr uint32_t empty_slot = 0;
+
+    std::vector<value_type> entries_;
+    std::vector<uint32_t> slots_;
+    uint64_t size_ = 0;
+
+    // iterators share ownership of the view they walk
+    mutable std::shared_ptr<View> view_;
+    mutable std::atomic<bool> view_valid_ = false;
+    mutable std::mutex view_lock_;
+    // views replaced while iterators were still using them
+    mutable std::vector<std::weak_ptr<View>> retired_views_;
+
+    static uint64_t hash(std::string_view name) { return std::hash<std::string_view>{}(name); }
+
+    void invalidate() { view_valid_.store(false, std::memory_order_release); }
+
+    std::shared_ptr<const View> view() const {
+        if (!view_valid_.load(std::memory_order_acquire)) {
+            std::lock_guard guard(view_lock_);
+            if (!view_valid_.load(std::memory_order_relaxed)) {
+                // don't touch a view that is being iterated
+                if (view_.use_count() > 1) retired_views_.emplace_back(view_);
+                if (view_.use_count() != 1) view_ = std::make_shared<View>();
+                view_->clear();
+                view_->reserve(size_);
+                for (uint32_t i = 0; i < entries_.size(); i++) {
+                    if (entries_[i].second) view_->emplace_back(i);
+                }
+                std::sort(view_->begin(), view_->end(), [this](uint32_t a, uint32_t b) {
+                    return entries_[a].first < entries_[b].first;
+                });
+                view_valid_.store(true, std::memory_order_release);
+            }
+        }
+        return view_;
+    }
+
+    // true if no iterator refers to an entry index
+    bool views_in_use() const {
+        if (view_.use_count() > 1) return true;
+        for (auto const &view : retired_views_) {
+            if (!view.expired()) return true;
+        }
+        retired_views_.clear();
+        return false;
+    }
+
+    uint32_t lookup(std::string_view name) const {
+        if (slots_.empty()) return npos;
+        auto const mask = slots_.size() - 1;
+        for (auto pos = hash(name) & mask;; pos = (pos + 1) & mask) {
+            auto slot = slots_[pos];
+            if (slot == empty_slot) return npos;
+            if (entries_[slot - 1].first == name) return slot - 1;
+        }
+    }
+
+    void insert_slot(uint32_t index) {
+        auto const mask = slots_.size() - 1;
+        auto pos = hash(entries_[index].first) & mask;
+        while (slots_[pos] != empty_slot) pos = (pos + 1) & mask;
+        slots_[pos] = index + 1;
+    }
+
+    // backward shift deletion, so that lookups never need tombstones
+    void erase_slot(uint32_t index) {
+        auto const mask = slots_.size() - 1;
+        auto pos = hash(entries_[index].first) & mask;
+        while (slots_[pos] != index + 1) pos = (pos + 1) & mask;
+        slots_[pos] = empty_slot;
+        for (auto next = (pos + 1) & mask; slots_[next] != empty_slot; next = (next + 1) & mask) {
+            auto ideal = hash(entries_[slots_[next] - 1].first) & mask;
+            // move the entry back if its probe sequence passes through the hole
+            if (((next - ideal) & mask) >= ((next - pos) & mask)) {
+                slots_[pos] = slots_[next];
+                slots_[next] = empty_slot;
+                pos = next;
+            }
+        }
+    }
+
+    // drops the erased entries and rebuilds the index. the entries are moved, so the
+    // holes are kept while iterators still refer to them
+    void rehash() {
+        bool compact = size_ != entries_.size() && !views_in_use();
+        if (compact) {
+            entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                          [](const value_type &entry) { return !entry.second; }),
+                           entries_.end());
+            invalidate();
+        }
+        uint64_t num_slots = 16;
+        while (num_slots < (entries_.size() + 1) * 2) num_slots *= 2;
+        if (!compact && num_slots == slots_.size()) return;
+        slots_.assign(num_slots, empty_slot);
+        for (uint32_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].second) insert_slot(i);
+        }
+    }
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_SYMBOL_HH
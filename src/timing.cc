@@ -0,0 +1,720 @@
+#include "timing.hh"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <unordered_set>
+
+#include "fmt/format.h"
+#include "stmt.hh"
+#include "util.hh"
+
+using fmt::format;
+
+namespace kratos {
+
+namespace {
+Generator *definition(Generator *generator) {
+    if (generator->is_cloned() && generator->def_instance()) return generator->def_instance();
+    return generator;
+}
+
+// nearest source location of the statement
+const std::vector<std::pair<std::string, uint32_t>> &stmt_fn_name_ln(Stmt *stmt) {
+    IRNode *node = stmt;
+    while (node->fn_name_ln.empty()) {
+        auto *parent = node->parent();
+        if (!parent || parent->ir_node_kind() != IRNodeKind::StmtKind) break;
+        node = parent;
+    }
+    return node->fn_name_ln;
+}
+
+bool is_data_input(const Port *port) {
+    return port->port_direction() == PortDirection::In &&
+           port->port_type() != PortType::Clock && port->port_type() != PortType::AsyncReset;
+}
+
+// bits of a variable selected with constant indices. they are analyzed on their own so that
+// the bits assigned from other bits of the same variable don't form a loop
+bool is_bit_range(Var *var) {
+    if (var->type() != VarType::Slice) return false;
+    while (var->type() == VarType::Slice) {
+        auto *slice = static_cast<VarSlice *>(var);
+        if (slice->sliced_by_var()) return false;
+        var = slice->parent_var;
+    }
+    return (var->type() == VarType::Base || var->type() == VarType::PortIO) && !var->is_function();
+}
+
+using LeafDelays = std::vector<std::pair<Var *, PathDelay>>;
+
+class DelayEstimator {
+public:
+    explicit DelayEstimator(const DelayModel &model) : model_(model) {}
+
+    PathDelay gate(uint32_t levels) const { return {levels, levels * model_.gate}; }
+    PathDelay mux(uint32_t levels) const { return {levels, levels * model_.mux}; }
+    PathDelay arithmetic(uint32_t levels) const { return {levels, levels * model_.arithmetic}; }
+
+    // the vars the value depends on, with the worst delay from each of them to the value
+    const LeafDelays &leaves(Var *var) {
+        auto iter = leaves_.find(var);
+        if (iter != leaves_.end()) return iter->second;
+        std::unordered_map<Var *, PathDelay> result;
+        compute_leaves(var, result);
+        auto &entry = leaves_[var];
+        entry.reserve(result.size());
+        for (auto const &[leaf, delay] : result) entry.emplace_back(leaf, delay);
+        // keep the arcs in a deterministic order
+        std::sort(entry.begin(), entry.end(), [](auto const &a, auto const &b) {
+            return a.first->handle_name() < b.first->handle_name();
+        });
+        return entry;
+    }
+
+private:
+    const DelayModel &model_;
+    // expressions are shared, so the leaves are only computed once per node
+    std::unordered_map<Var *, LeafDelays> leaves_;
+
+    void merge(Var *var, const PathDelay &delay, std::unordered_map<Var *, PathDelay> &result) {
+        for (auto const &[leaf, d] : leaves(var)) {
+            auto total = d + delay;
+            auto iter = result.find(leaf);
+            if (iter == result.end()) {
+                result.emplace(leaf, total);
+            } else if (iter->second < total) {
+                iter->second = total;
+            }
+        }
+    }
+
+    void compute_leaves(Var *var, std::unordered_map<Var *, PathDelay> &result) {
+        switch (var->type()) {
+            case VarType::ConstValue:
+            case VarType::Parameter:
+            case VarType::Iter: {
+                return;
+            }
+            case VarType::Slice: {
+                auto *slice = static_cast<VarSlice *>(var);
+                if (is_bit_range(slice)) {
+                    result.emplace(var, PathDelay{});
+                } else if (slice->sliced_by_var()) {
+                    // a mux tree selects the bits
+                    auto *var_slice = static_cast<VarVarSlice *>(slice);
+                    auto delay = mux(clog2(slice->parent_var->width()));
+                    merge(var_slice->sliced_var(), delay, result);
+                    merge(slice->parent_var, delay, result);
+                } else {
+                    merge(slice->parent_var, {}, result);
+                }
+                return;
+            }
+            case VarType::BaseCasted: {
+                merge(static_cast<VarCasted *>(var)->parent_var(), {}, result);
+                return;
+            }
+            case VarType::Expression: {
+                auto *expr = static_cast<Expr *>(var);
+                if (expr->op == ExprOp::Concat) {
+                    for (auto *v : static_cast<VarConcat *>(expr)->vars()) merge(v, {}, result);
+                    return;
+                }
+                if (expr->op == ExprOp::Extend) {
+                    merge(static_cast<VarExtend *>(expr)->parent_var(), {}, result);
+                    return;
+                }
+                auto delay = op_delay(expr);
+                if (expr->op == ExprOp::Conditional) {
+                    merge(static_cast<ConditionalExpr *>(expr)->condition, delay, result);
+                }
+                merge(expr->left, delay, result);
+                if (expr->right) merge(expr->right, delay, result);
+                return;
+            }
+            case VarType::Base:
+            case VarType::PortIO: {
+                if (var->is_function()) {
+                    // the function body is not analyzed
+                    auto delay = gate(1);
+                    for (auto const &iter : static_cast<FunctionCallVar *>(var)->args()) {
+                        merge(iter.second.get(), delay, result);
+                    }
+                    return;
+                }
+                result.emplace(var, PathDelay{});
+                return;
+            }
+        }
+    }
+
+    PathDelay op_delay(const Expr *expr) const { return estimate_op_delay(expr, model_); }
+};
+
+// longest paths through the combinational logic of a single module. child instances are
+// represented by the summaries of their definitions
+class ModuleTiming {
+public:
+    ModuleTiming(Generator *generator, const DelayModel &model,
+                 const std::unordered_map<const Generator *, TimingSummary> &summaries)
+        : generator_(generator), model_(model), estimator_(model) {
+        for (uint64_t i = 0; i < generator->stmts_count(); i++) {
+            add_stmt(generator->get_stmt(i).get(), false);
+        }
+        add_children(summaries);
+        add_bit_ranges();
+        sort_nodes();
+    }
+
+    TimingSummary summary(bool is_top, uint32_t num_paths, std::vector<TimingPath> &paths) {
+        TimingSummary result;
+        std::vector<std::shared_ptr<Port>> inputs, outputs;
+        for (auto const &port_name : generator_->get_port_names()) {
+            auto port = generator_->get_port(port_name);
+            if (is_data_input(port.get())) {
+                inputs.emplace_back(port);
+            } else if (port->port_direction() == PortDirection::Out) {
+                outputs.emplace_back(port);
+            }
+        }
+
+        // launched by the registers
+        {
+            propagate(reg_starts_);
+            std::vector<std::pair<PathDelay, uint32_t>> reg_ends, out_ends;
+            collect_ends(reg_ends, out_ends);
+            add_paths(TimingPathType::RegToReg, reg_ends, num_paths, paths);
+            for (auto const &[delay, node] : out_ends) {
+                result.reg_to_out.emplace(nodes_[node].var->name, delay);
+            }
+            if (is_top) add_paths(TimingPathType::RegToOut, out_ends, num_paths, paths);
+        }
+
+        // launched by each input
+        for (auto const &input : inputs) {
+            auto iter = var_nodes_.find(input.get());
+            if (iter == var_nodes_.end()) continue;
+            propagate({{iter->second, {}}});
+            std::vector<std::pair<PathDelay, uint32_t>> reg_ends, out_ends;
+            collect_ends(reg_ends, out_ends);
+            if (!reg_ends.empty()) {
+                auto worst = std::max_element(reg_ends.begin(), reg_ends.end());
+                result.in_to_reg.emplace(input->name, worst->first);
+            }
+            for (auto const &[delay, node] : out_ends) {
+                result.in_to_out.emplace(std::make_pair(input->name, nodes_[node].var->name),
+                                         delay);
+            }
+            if (is_top) {
+                add_paths(TimingPathType::InToReg, reg_ends, num_paths, paths);
+                add_paths(TimingPathType::InToOut, out_ends, num_paths, paths);
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    struct Node {
+        Var *var;
+        // extra delay to the capturing register if the node is a register input
+        std::optional<PathDelay> reg_end;
+        bool is_output = false;
+    };
+    struct Arc {
+        uint32_t to;
+        PathDelay delay;
+        // nullptr for the arcs through child instances
+        Stmt *stmt;
+    };
+    struct Condition {
+        const LeafDelays *select;
+        PathDelay select_delay;
+        PathDelay mux;
+    };
+
+    Generator *generator_;
+    const DelayModel &model_;
+    DelayEstimator estimator_;
+
+    std::vector<Node> nodes_;
+    std::vector<std::vector<Arc>> arcs_;
+    std::unordered_map<Var *, uint32_t> var_nodes_;
+    // register inputs, i.e. D pins, are different nodes from the register outputs
+    std::unordered_map<Var *, uint32_t> reg_nodes_;
+    std::vector<std::pair<uint32_t, PathDelay>> reg_starts_;
+    // the bit ranges assigned in combinational logic, indexed by the variable
+    std::unordered_map<Var *, std::vector<uint32_t>> range_writes_;
+    std::unordered_map<Var *, uint32_t> range_nodes_;
+    std::unordered_set<Var *> whole_writes_;
+    // the bit ranges that are read
+    std::vector<uint32_t> range_reads_;
+    std::vector<uint32_t> order_;
+    // position of each node in order_
+    std::vector<uint32_t> position_;
+
+    // per propagation
+    std::vector<std::optional<PathDelay>> arrival_;
+    // (node, arc index)
+    std::vector<std::pair<uint32_t, uint32_t>> pred_;
+
+    uint32_t add_node(Var *var) {
+        auto id = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back(Node{var, std::nullopt, false});
+        arcs_.emplace_back();
+        return id;
+    }
+
+    uint32_t var_node(Var *var) {
+        auto iter = var_nodes_.find(var);
+        if (iter != var_nodes_.end()) return iter->second;
+        auto id = add_node(var);
+        var_nodes_.emplace(var, id);
+        if (var->type() == VarType::Slice) {
+            range_reads_.emplace_back(id);
+        } else if (var->type() == VarType::PortIO && var->generator() == generator_) {
+            auto *port = static_cast<Port *>(var);
+            nodes_[id].is_output = port->port_direction() == PortDirection::Out;
+        }
+        return id;
+    }
+
+    uint32_t reg_node(Var *var) {
+        auto iter = reg_nodes_.find(var);
+        if (iter != reg_nodes_.end()) return iter->second;
+        auto id = add_node(var);
+        nodes_[id].reg_end = PathDelay{0, model_.setup};
+        reg_nodes_.emplace(var, id);
+        reg_starts_.emplace_back(var_node(var), PathDelay{0, model_.clock_to_q});
+        return id;
+    }
+
+    uint32_t range_node(Var *var) {
+        auto iter = range_nodes_.find(var);
+        if (iter != range_nodes_.end()) return iter->second;
+        auto id = add_node(var);
+        range_nodes_.emplace(var, id);
+        auto *root = var->get_var_root_parent();
+        range_writes_[root].emplace_back(id);
+        add_arc(id, var_node(root), {}, nullptr);
+        return id;
+    }
+
+    void add_arc(uint32_t from, uint32_t to, const PathDelay &delay, Stmt *stmt) {
+        // blocking assignments may read the value they update
+        if (from == to) return;
+        arcs_[from].emplace_back(Arc{to, delay, stmt});
+    }
+
+    static void get_targets(Var *var, bool sequential, std::vector<Var *> &targets) {
+        if (var->type() == VarType::Expression) {
+            auto *expr = static_cast<Expr *>(var);
+            if (expr->op == ExprOp::Concat) {
+                for (auto *v : static_cast<VarConcat *>(expr)->vars()) {
+                    get_targets(v, sequential, targets);
+                }
+            }
+            return;
+        }
+        // registers break the loops anyway
+        if (!sequential && is_bit_range(var)) {
+            targets.emplace_back(var);
+        } else {
+            targets.emplace_back(var->get_var_root_parent());
+        }
+    }
+
+    void add_stmt(Stmt *stmt, bool sequential) {
+        std::vector<Condition> conditions;
+        switch (stmt->type()) {
+            case StatementType::Assign: {
+                add_assign(static_cast<AssignStmt *>(stmt), sequential, conditions);
+                break;
+            }
+            case StatementType::Block: {
+                auto *block = static_cast<StmtBlock *>(stmt);
+                switch (block->block_type()) {
+                    case StatementBlockType::Sequential:
+                        add_block(block, true, conditions);
+                        break;
+                    case StatementBlockType::Combinational:
+                    case StatementBlockType::Latch:
+                        add_block(block, false, conditions);
+                        break;
+                    default:
+                        // initial blocks and functions are not part of the data path
+                        break;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void add_block(StmtBlock *block, bool sequential, std::vector<Condition> &conditions) {
+        for (auto const &stmt : *block) add_nested_stmt(stmt.get(), sequential, conditions);
+    }
+
+    void add_nested_stmt(Stmt *stmt, bool sequential, std::vector<Condition> &conditions) {
+        switch (stmt->type()) {
+            case StatementType::Assign: {
+                add_assign(static_cast<AssignStmt *>(stmt), sequential, conditions);
+                break;
+            }
+            case StatementType::If: {
+                auto *if_ = static_cast<IfStmt *>(stmt);
+                conditions.emplace_back(
+                    Condition{&estimator_.leaves(if_->predicate().get()), {}, estimator_.mux(1)});
+                add_block(if_->then_body().get(), sequential, conditions);
+                add_block(if_->else_body().get(), sequential, conditions);
+                conditions.pop_back();
+                break;
+            }
+            case StatementType::Switch: {
+                auto *switch_ = static_cast<SwitchStmt *>(stmt);
+                auto const &target = switch_->target();
+                auto const &body = switch_->body();
+                // compare against each case, then a mux tree selects the value
+                conditions.emplace_back(
+                    Condition{&estimator_.leaves(target.get()),
+                              estimator_.gate(clog2(target->width()) + 1),
+                              estimator_.mux(clog2(static_cast<uint32_t>(body.size()) + 1))});
+                for (auto const &iter : body) add_block(iter.second.get(), sequential, conditions);
+                conditions.pop_back();
+                break;
+            }
+            case StatementType::For: {
+                auto *for_ = static_cast<ForStmt *>(stmt);
+                add_block(for_->get_loop_body().get(), sequential, conditions);
+                break;
+            }
+            case StatementType::Block: {
+                add_block(static_cast<StmtBlock *>(stmt), sequential, conditions);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void add_assign(AssignStmt *stmt, bool sequential, const std::vector<Condition> &conditions) {
+        std::vector<Var *> targets;
+        get_targets(stmt->left(), sequential, targets);
+        // the value goes through the muxes of every enclosing branch
+        PathDelay mux;
+        for (auto const &condition : conditions) mux = mux + condition.mux;
+        auto const &leaves = estimator_.leaves(stmt->right());
+        for (auto *target : targets) {
+            if (target->type() == VarType::ConstValue) continue;
+            uint32_t to;
+            if (sequential) {
+                to = reg_node(target);
+            } else if (target->type() == VarType::Slice) {
+                to = range_node(target);
+            } else {
+                to = var_node(target);
+                whole_writes_.emplace(target);
+            }
+            for (auto const &[leaf, delay] : leaves) {
+                add_arc(var_node(leaf), to, delay + mux, stmt);
+            }
+            // the select signals only go through the muxes from their branch inwards
+            PathDelay select_mux = mux;
+            for (auto const &condition : conditions) {
+                for (auto const &[leaf, delay] : *condition.select) {
+                    add_arc(var_node(leaf), to, delay + condition.select_delay + select_mux,
+                            stmt);
+                }
+                select_mux.levels -= condition.mux.levels;
+                select_mux.delay -= condition.mux.delay;
+            }
+        }
+    }
+
+    void add_children(const std::unordered_map<const Generator *, TimingSummary> &summaries) {
+        for (auto const &child : generator_->get_child_generators()) {
+            auto iter = summaries.find(definition(child.get()));
+            auto port_names = child->get_port_names();
+            if (iter == summaries.end()) {
+                // no definition. assume the ports are registered
+                for (auto const &port_name : port_names) {
+                    auto port = child->get_port(port_name);
+                    if (is_data_input(port.get())) {
+                        nodes_[var_node(port.get())].reg_end = PathDelay{0, model_.setup};
+                    } else if (port->port_direction() == PortDirection::Out) {
+                        reg_starts_.emplace_back(var_node(port.get()),
+                                                 PathDelay{0, model_.clock_to_q});
+                    }
+                }
+                continue;
+            }
+            auto const &summary = iter->second;
+            for (auto const &[ports, delay] : summary.in_to_out) {
+                auto in = child->get_port(ports.first);
+                auto out = child->get_port(ports.second);
+                if (!in || !out) continue;
+                add_arc(var_node(in.get()), var_node(out.get()), delay, nullptr);
+            }
+            for (auto const &[port_name, delay] : summary.in_to_reg) {
+                auto port = child->get_port(port_name);
+                if (port) nodes_[var_node(port.get())].reg_end = delay;
+            }
+            for (auto const &[port_name, delay] : summary.reg_to_out) {
+                auto port = child->get_port(port_name);
+                if (port) reg_starts_.emplace_back(var_node(port.get()), delay);
+            }
+        }
+    }
+
+    void add_bit_ranges() {
+        for (auto read : range_reads_) {
+            auto *var = nodes_[read].var;
+            auto *root = var->get_var_root_parent();
+            auto iter = range_writes_.find(root);
+            if (iter == range_writes_.end() || whole_writes_.find(root) != whole_writes_.end()) {
+                // the bits are driven together with the rest of the variable
+                add_arc(var_node(root), read, {}, nullptr);
+            }
+            if (iter == range_writes_.end()) continue;
+            for (auto write : iter->second) {
+                auto *range = nodes_[write].var;
+                if (range->var_low() <= var->var_high() && var->var_low() <= range->var_high()) {
+                    add_arc(write, read, {}, nullptr);
+                }
+            }
+        }
+    }
+
+    void sort_nodes() {
+        std::vector<uint32_t> in_degree(nodes_.size(), 0);
+        for (auto const &arcs : arcs_) {
+            for (auto const &arc : arcs) in_degree[arc.to]++;
+        }
+        std::queue<uint32_t> queue;
+        for (uint32_t i = 0; i < nodes_.size(); i++) {
+            if (!in_degree[i]) queue.emplace(i);
+        }
+        std::vector<bool> visited(nodes_.size(), false);
+        uint32_t next = 0;
+        order_.reserve(nodes_.size());
+        while (order_.size() < nodes_.size()) {
+            if (queue.empty()) {
+                // combinational loop. break it at the first node that's left
+                while (visited[next]) next++;
+                queue.emplace(next);
+            }
+            auto node = queue.front();
+            queue.pop();
+            if (visited[node]) continue;
+            visited[node] = true;
+            order_.emplace_back(node);
+            for (auto const &arc : arcs_[node]) {
+                if (!visited[arc.to] && --in_degree[arc.to] == 0) queue.emplace(arc.to);
+            }
+        }
+        position_.resize(nodes_.size());
+        for (uint32_t i = 0; i < order_.size(); i++) position_[order_[i]] = i;
+    }
+
+    void propagate(const std::vector<std::pair<uint32_t, PathDelay>> &starts) {
+        arrival_.assign(nodes_.size(), std::nullopt);
+        pred_.assign(nodes_.size(), {npos, npos});
+        for (auto const &[node, delay] : starts) {
+            if (!arrival_[node] || *arrival_[node] < delay) arrival_[node] = delay;
+        }
+        for (auto node : order_) {
+            if (!arrival_[node]) continue;
+            auto const &arcs = arcs_[node];
+            for (uint32_t i = 0; i < arcs.size(); i++) {
+                auto const &arc = arcs[i];
+                // the arcs closing a combinational loop are not followed, so the paths end
+                if (position_[arc.to] <= position_[node]) continue;
+                auto delay = *arrival_[node] + arc.delay;
+                if (!arrival_[arc.to] || *arrival_[arc.to] < delay) {
+                    arrival_[arc.to] = delay;
+                    pred_[arc.to] = {node, i};
+                }
+            }
+        }
+    }
+
+    void collect_ends(std::vector<std::pair<PathDelay, uint32_t>> &reg_ends,
+                      std::vector<std::pair<PathDelay, uint32_t>> &out_ends) const {
+        for (uint32_t i = 0; i < nodes_.size(); i++) {
+            if (!arrival_[i]) continue;
+            auto const &node = nodes_[i];
+            if (node.reg_end) reg_ends.emplace_back(*arrival_[i] + *node.reg_end, i);
+            if (node.is_output) out_ends.emplace_back(*arrival_[i], i);
+        }
+    }
+
+    void add_paths(TimingPathType type, std::vector<std::pair<PathDelay, uint32_t>> &ends,
+                   uint32_t num_paths, std::vector<TimingPath> &paths) const {
+        auto num = std::min<uint64_t>(num_paths, ends.size());
+        std::partial_sort(ends.begin(), ends.begin() + num, ends.end(),
+                          [](auto const &a, auto const &b) { return b.first < a.first; });
+        for (uint64_t i = 0; i < num; i++) {
+            auto const &[delay, end] = ends[i];
+            TimingPath path{type, delay, {}};
+            for (auto node = end; node != npos; node = pred_[node].first) {
+                TimingPoint point{nodes_[node].var->handle_name(), {}};
+                auto [from, arc] = pred_[node];
+                if (from != npos && arcs_[from][arc].stmt) {
+                    point.fn_name_ln = stmt_fn_name_ln(arcs_[from][arc].stmt);
+                }
+                // a bit range is both assigned and read. only report the assignment
+                if (!path.points.empty() && path.points.back().name == point.name) {
+                    auto &last = path.points.back();
+                    if (last.fn_name_ln.empty()) last = std::move(point);
+                    continue;
+                }
+                path.points.emplace_back(std::move(point));
+            }
+            std::reverse(path.points.begin(), path.points.end());
+            paths.emplace_back(std::move(path));
+        }
+    }
+};
+
+class TimingAnalysis {
+public:
+    TimingAnalysis(Generator *top, uint32_t num_paths, const DelayModel &model)
+        : top_(top), num_paths_(num_paths), model_(model) {}
+
+    TimingReport analyze() {
+        analyze(top_);
+        std::sort(paths_.begin(), paths_.end(),
+                  [](auto const &a, auto const &b) { return b.delay < a.delay; });
+        if (paths_.size() > num_paths_) paths_.resize(num_paths_);
+        TimingReport report;
+        report.paths = std::move(paths_);
+        for (auto const &[generator, summary] : summaries_) {
+            report.summaries.emplace(generator->handle_name(), summary);
+        }
+        return report;
+    }
+
+private:
+    Generator *top_;
+    uint32_t num_paths_;
+    const DelayModel &model_;
+
+    // indexed by definition, so repeated instances are only analyzed once
+    std::unordered_map<const Generator *, TimingSummary> summaries_;
+    std::vector<TimingPath> paths_;
+
+    void analyze(Generator *generator) {
+        if (summaries_.find(generator) != summaries_.end()) return;
+        for (auto const &child : generator->get_child_generators()) {
+            auto *def = definition(child.get());
+            // external modules without the definition are handled by the parent
+            if (def->external()) continue;
+            analyze(def);
+        }
+        ModuleTiming timing(generator, model_, summaries_);
+        auto summary = timing.summary(generator == top_, num_paths_, paths_);
+        summaries_.emplace(generator, std::move(summary));
+    }
+};
+
+std::string path_type_name(TimingPathType type) {
+    switch (type) {
+        case TimingPathType::RegToReg:
+            return "register to register";
+        case TimingPathType::InToReg:
+            return "input to register";
+        case TimingPathType::RegToOut:
+            return "register to output";
+        case TimingPathType::InToOut:
+            return "input to output";
+    }
+    return "";
+}
+}  // namespace
+
+PathDelay estimate_op_delay(const Expr *expr, const DelayModel &model) {
+    auto gate = [&model](uint32_t levels) { return PathDelay{levels, levels * model.gate}; };
+    auto mux = [&model](uint32_t levels) { return PathDelay{levels, levels * model.mux}; };
+    auto arithmetic = [&model](uint32_t levels) {
+        return PathDelay{levels, levels * model.arithmetic};
+    };
+    auto width = expr->left->width();
+    if (expr->right) width = std::max(width, expr->right->width());
+    auto levels = clog2(width);
+    switch (expr->op) {
+        case ExprOp::UPlus:
+        case ExprOp::Concat:
+        case ExprOp::Extend:
+            return {};
+        case ExprOp::UInvert:
+        case ExprOp::UNot:
+        case ExprOp::And:
+        case ExprOp::Or:
+        case ExprOp::Xor:
+        case ExprOp::LAnd:
+        case ExprOp::LOr:
+            return gate(1);
+        case ExprOp::UOr:
+        case ExprOp::UAnd:
+        case ExprOp::UXor:
+            return gate(levels);
+        case ExprOp::Eq:
+        case ExprOp::Neq:
+            return gate(levels + 1);
+        case ExprOp::UMinus:
+        case ExprOp::Add:
+        case ExprOp::Minus:
+        case ExprOp::LessThan:
+        case ExprOp::GreaterThan:
+        case ExprOp::LessEqThan:
+        case ExprOp::GreaterEqThan:
+            return arithmetic(levels + 1);
+        case ExprOp::Multiply:
+            return arithmetic(2 * levels + 2);
+        case ExprOp::Divide:
+        case ExprOp::Mod:
+        case ExprOp::Power:
+            return arithmetic(width * (levels + 1));
+        case ExprOp::LogicalShiftRight:
+        case ExprOp::SignedShiftRight:
+        case ExprOp::ShiftLeft: {
+            auto type = expr->right->type();
+            // shifting by a constant is only wiring
+            if (type == VarType::ConstValue || type == VarType::Parameter) return {};
+            return gate(clog2(expr->left->width()));
+        }
+        case ExprOp::Conditional:
+            return mux(1);
+    }
+    return {};
+}
+
+std::string TimingReport::to_string() const {
+    std::string result;
+    for (uint64_t i = 0; i < paths.size(); i++) {
+        auto const &path = paths[i];
+        result.append(::format("Path {0}: {1}, {2} levels, delay {3:.2f}\n", i,
+                               path_type_name(path.type), path.delay.levels, path.delay.delay));
+        for (auto const &point : path.points) {
+            if (point.fn_name_ln.empty()) {
+                result.append(::format("    {0}\n", point.name));
+            } else {
+                auto const &[fn, ln] = point.fn_name_ln.front();
+                result.append(::format("    {0} ({1}:{2})\n", point.name, fn, ln));
+            }
+        }
+    }
+    return result;
+}
+
+TimingReport analyze_timing(Generator *top, uint32_t num_paths, const DelayModel &model) {
+    TimingAnalysis analysis(top, num_paths, model);
+    return analysis.analyze();
+}
+
+}  // namespace kratos
@@ -0,0 +1,81 @@
+#ifndef KRATOS_TIMING_HH
+#define KRATOS_TIMING_HH
+
+#include "generator.hh"
+
+namespace kratos {
+
+// unit-less delay of each logic level. the number of levels of an operator is estimated
+// from its width, e.g. an adder takes clog2(width) + 1 levels
+struct DelayModel {
+    // and/or/xor, comparators, reductions, barrel shifters
+    double gate = 1.0;
+    // 2:1 mux, from ternary expressions, if and switch statements and var slicing
+    double mux = 1.0;
+    // adders, subtractors, multipliers and dividers
+    double arithmetic = 1.0;
+    double clock_to_q = 0.0;
+    double setup = 0.0;
+};
+
+struct PathDelay {
+    uint32_t levels = 0;
+    double delay = 0;
+
+    PathDelay operator+(const PathDelay &d) const { return {levels + d.levels, delay + d.delay}; }
+    bool operator<(const PathDelay &d) const {
+        return delay < d.delay || (delay == d.delay && levels < d.levels);
+    }
+};
+
+enum class TimingPathType { RegToReg, InToReg, RegToOut, InToOut };
+
+struct TimingPoint {
+    std::string name;
+    // source location of the statement that drives the point. empty for the start point
+    // and for the hops through child instances
+    std::vector<std::pair<std::string, uint32_t>> fn_name_ln;
+};
+
+struct TimingPath {
+    TimingPathType type;
+    PathDelay delay;
+    // from the start point to the end point. paths through child instances only list the
+    // ports of the instance, and end at the input port if the register is inside the child
+    std::vector<TimingPoint> points;
+};
+
+// worst combinational delays between the ports and the registers of a module, which is
+// all its parent needs to know about it
+struct TimingSummary {
+    // indexed by (input, output)
+    std::map<std::pair<std::string, std::string>, PathDelay> in_to_out;
+    std::map<std::string, PathDelay> in_to_reg;
+    std::map<std::string, PathDelay> reg_to_out;
+};
+
+struct TimingReport {
+    // worst first. register to register paths are reported once per definition, the
+    // ones that start or end at the ports only for the top
+    std::vector<TimingPath> paths;
+    // indexed by the handle name of the definition. clones share the summary of their
+    // definition
+    std::map<std::string, TimingSummary> summaries;
+
+    std::string to_string() const;
+};
+
+// estimates the logic levels and delay of every register to register, input to register
+// and register to output path. clock and async reset ports are not considered as
+// data inputs, and external modules without a definition are assumed to have registered
+// inputs and outputs
+TimingReport analyze_timing(Generator *top, uint32_t num_paths = 10,
+                            const DelayModel &model = {});
+
+// delay from the operands of a single operator to its output. slicing, concatenation
+// and width extension are free
+PathDelay estimate_op_delay(const Expr *expr, const DelayModel &model = {});
+
+}  // namespace kratos
+
+#endif  // KRATOS_TIMING_HH
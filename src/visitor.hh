@@ -0,0 +1,170 @@
+#ifndef KRATOS_VISITOR_HH
+#define KRATOS_VISITOR_HH
+
+#include <type_traits>
+
+#include "generator.hh"
+#include "stmt.hh"
+#include "tb.hh"
+
+namespace kratos {
+
+namespace detail {
+template <typename V, typename N, typename = void>
+struct has_visit : std::false_type {};
+template <typename V, typename N>
+struct has_visit<V, N, std::void_t<decltype(std::declval<V &>().visit(std::declval<N *>()))>>
+    : std::true_type {};
+}  // namespace detail
+
+// statically dispatched statement visitor. unlike IRVisitor, the derived class only
+// declares the visit() overloads it cares about, e.g.
+//     class Foo : public StmtVisitor<Foo> {
+//     public:
+//         void visit(AssignStmt *stmt);
+//     };
+// dispatch is done on the statement type tags without any virtual call. vars and
+// expressions are never visited, and if the visitor only handles top-level
+// statements, i.e. procedural blocks and functions, their bodies are skipped entirely
+template <typename T>
+class StmtVisitor {
+public:
+    // visit every generator under top, including the top itself
+    void visit_root(Generator *top) {
+        if (top->external() || top->skip_incremental()) return;
+        visit_content(top);
+        for (auto const &child : top->get_child_generators()) visit_root(child.get());
+    }
+
+    // visit the statements and functions of the generator only
+    void visit_content(Generator *generator) {
+        if constexpr (handles<Generator>()) derived()->visit(generator);
+        if constexpr (any_stmt()) {
+            for (uint64_t i = 0; i < generator->stmts_count(); i++) {
+                visit_stmt(generator->get_stmt(i).get());
+            }
+            for (auto const &iter : generator->functions()) visit_stmt(iter.second.get());
+        }
+    }
+
+    void visit_stmt(Stmt *stmt) {
+        switch (stmt->type()) {
+            case StatementType::Assign: {
+                dispatch(static_cast<AssignStmt *>(stmt));
+                break;
+            }
+            case StatementType::If: {
+                auto *if_ = static_cast<IfStmt *>(stmt);
+                dispatch(if_);
+                if constexpr (nested()) {
+                    visit_stmt(if_->then_body().get());
+                    visit_stmt(if_->else_body().get());
+                }
+                break;
+            }
+            case StatementType::Switch: {
+                auto *switch_ = static_cast<SwitchStmt *>(stmt);
+                dispatch(switch_);
+                if constexpr (nested()) {
+                    for (auto const &iter : switch_->body()) visit_stmt(iter.second.get());
+                }
+                break;
+            }
+            case StatementType::For: {
+                auto *for_ = static_cast<ForStmt *>(stmt);
+                dispatch(for_);
+                if constexpr (nested()) visit_stmt(for_->get_loop_body().get());
+                break;
+            }
+            case StatementType::Block: {
+                auto *block = static_cast<StmtBlock *>(stmt);
+                switch (block->block_type()) {
+                    case StatementBlockType::Combinational:
+                        dispatch(static_cast<CombinationalStmtBlock *>(block));
+                        break;
+                    case StatementBlockType::Sequential:
+                        dispatch(static_cast<SequentialStmtBlock *>(block));
+                        break;
+                    case StatementBlockType::Scope:
+                        dispatch(static_cast<ScopedStmtBlock *>(block));
+                        break;
+                    case StatementBlockType::Function:
+                        dispatch(static_cast<FunctionStmtBlock *>(block));
+                        break;
+                    case StatementBlockType::Initial:
+                        dispatch(static_cast<InitialStmtBlock *>(block));
+                        break;
+                    case StatementBlockType::Latch:
+                        dispatch(static_cast<LatchStmtBlock *>(block));
+                        break;
+                }
+                if constexpr (nested()) {
+                    // the visitor is allowed to change the block
+                    for (uint64_t i = 0; i < block->size(); i++) {
+                        visit_stmt(block->get_stmt(i).get());
+                    }
+                }
+                break;
+            }
+            case StatementType::ModuleInstantiation: {
+                dispatch(static_cast<ModuleInstantiationStmt *>(stmt));
+                break;
+            }
+            case StatementType::InterfaceInstantiation: {
+                dispatch(static_cast<InterfaceInstantiationStmt *>(stmt));
+                break;
+            }
+            case StatementType::FunctionalCall: {
+                dispatch(static_cast<FunctionCallStmt *>(stmt));
+                break;
+            }
+            case StatementType::Return: {
+                dispatch(static_cast<ReturnStmt *>(stmt));
+                break;
+            }
+            case StatementType::Assert: {
+                dispatch(static_cast<AssertBase *>(stmt));
+                break;
+            }
+            case StatementType::Auxiliary: {
+                dispatch(static_cast<AuxiliaryStmt *>(stmt));
+                break;
+            }
+            case StatementType::Comment:
+            case StatementType::RawString:
+                break;
+        }
+    }
+
+private:
+    // evaluated lazily, since T is still incomplete when the base is instantiated
+    template <typename N>
+    static constexpr bool handles() {
+        return detail::has_visit<T, N>::value;
+    }
+
+    // statements that may show up inside procedural blocks, loops or functions, in which
+    // case the bodies have to be visited
+    static constexpr bool nested() {
+        return handles<AssignStmt>() || handles<IfStmt>() || handles<SwitchStmt>() ||
+               handles<ForStmt>() || handles<ScopedStmtBlock>() || handles<FunctionCallStmt>() ||
+               handles<ReturnStmt>() || handles<AssertBase>() || handles<AuxiliaryStmt>() ||
+               handles<ModuleInstantiationStmt>() || handles<InterfaceInstantiationStmt>();
+    }
+    static constexpr bool any_stmt() {
+        return nested() || handles<CombinationalStmtBlock>() || handles<SequentialStmtBlock>() ||
+               handles<FunctionStmtBlock>() || handles<InitialStmtBlock>() ||
+               handles<LatchStmtBlock>();
+    }
+
+    T *derived() { return static_cast<T *>(this); }
+
+    template <typename N>
+    void dispatch(N *node) {
+        if constexpr (handles<N>()) derived()->visit(node);
+    }
+};
+
+}  // namespace kratos
+
+#endif  // KRATOS_VISITOR_HH
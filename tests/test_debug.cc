@@ -50,6 +50,87 @@ TEST(debug, inst) {  // NOLINT
     EXPECT_TRUE(code.find("unq") == std::string::npos);
 }
 
+TEST(debug, deterministic_ids) {  // NOLINT
+    Context c;
+    auto &parent = c.generator("parent");
+    parent.debug = true;
+    auto &a = parent.var("a", 1);
+    auto parent_stmt = a.assign(constant(0, 1));
+    parent.add_stmt(parent_stmt);
+    std::vector<std::shared_ptr<AssignStmt>> stmts;
+    std::vector<Generator *> children;
+    for (uint32_t i = 0; i < 8; i++) {
+        auto &child = c.generator("child");
+        child.debug = true;
+        auto &b = child.var("b", 1);
+        auto &d = child.var("d", 1);
+        auto comb = child.combinational();
+        stmts.emplace_back(b.assign(constant(1, 1)));
+        stmts.emplace_back(d.assign(constant(0, 1)));
+        comb->add_stmt(stmts[stmts.size() - 2]);
+        comb->add_stmt(stmts.back());
+        parent.add_child_generator("inst" + std::to_string(i), child.shared_from_this());
+        children.emplace_back(&child);
+    }
+
+    inject_instance_ids(&parent);
+    inject_debug_break_points(&parent);
+    // parents come before their children, which follow the instantiation order
+    EXPECT_EQ(parent.generator_id, 0);
+    EXPECT_EQ(parent_stmt->stmt_id(), 0);
+    for (uint32_t i = 0; i < children.size(); i++) {
+        EXPECT_EQ(children[i]->generator_id, static_cast<int>(i + 1));
+        EXPECT_TRUE(children[i]->get_param(break_point_param_name));
+    }
+    for (uint32_t i = 0; i < stmts.size(); i++) {
+        EXPECT_EQ(stmts[i]->stmt_id(), static_cast<int>(i + 1));
+    }
+    EXPECT_EQ(c.max_stmt_id(), static_cast<int>(stmts.size() + 1));
+
+    // functions are numbered in the order they are created, not by name
+    auto &mod = c.generator("mod");
+    mod.debug = true;
+    auto &e = mod.var("e", 1);
+    std::vector<std::shared_ptr<AssignStmt>> func_stmts;
+    for (auto const &name : {"z_func", "a_func"}) {
+        auto func = std::make_shared<FunctionStmtBlock>(&mod, name);
+        mod.add_function(func);
+        auto if_ = std::make_shared<IfStmt>(func->input("cond", 1, false));
+        func_stmts.emplace_back(e.assign(constant(1, 1), AssignmentType::Blocking));
+        if_->add_then_stmt(func_stmts.back());
+        func->add_stmt(if_);
+    }
+    inject_debug_break_points(&mod);
+    EXPECT_EQ(func_stmts[0]->stmt_id(), static_cast<int>(stmts.size() + 1));
+    EXPECT_EQ(func_stmts[1]->stmt_id(), static_cast<int>(stmts.size() + 2));
+}
+
+TEST(debug, verilator_public_db) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &in = mod.port(PortDirection::In, "in", 16);
+    auto &out = mod.port(PortDirection::Out, "out", 16);
+    auto &a = mod.var("a", 16);
+    auto &b = mod.var("b", 16);
+    mod.add_stmt(a.assign(in));
+    mod.add_stmt(b.assign(a));
+    mod.add_stmt(out.assign(b));
+
+    // only the mapped vars are referenced, and a slice keeps the entire var
+    DebugDatabase db;
+    std::map<Generator *, std::map<std::string, std::string>> mapping = {
+        {&mod, {{"x", "a[0]"}, {"y", "in"}}}};
+    db.set_variable_mapping(mapping);
+    auto vars = db.referenced_vars();
+    EXPECT_EQ(vars, (std::unordered_set<const Var *>{&a, &in}));
+
+    insert_verilator_public(&mod, &db, {}, "");
+    EXPECT_FALSE(a.after_var_str().empty());
+    EXPECT_FALSE(in.after_var_str().empty());
+    EXPECT_TRUE(b.after_var_str().empty());
+    EXPECT_TRUE(out.after_var_str().empty());
+}
+
 TEST(debug, clock_breakpoint) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -62,4 +143,80 @@ TEST(debug, clock_breakpoint) {  // NOLINT
     EXPECT_EQ(block->size(), 1);
     EXPECT_EQ(block->block_type(), StatementBlockType::Sequential);
     EXPECT_EQ((*block)[0]->type(), StatementType::FunctionalCall);
-}
\ No newline at end of file
+}
+
+TEST(debug, breakpoint_bitmap) {  // NOLINT
+    Context c;
+    auto &top = c.generator("top");
+    top.port(PortDirection::In, "clk", 1, PortType::Clock);
+    auto &child = c.generator("child");
+    child.debug = true;
+    auto &clk = child.port(PortDirection::In, "clk", 1, PortType::Clock);
+    auto &a = child.port(PortDirection::In, "a", 1);
+    auto &b = child.port(PortDirection::Out, "b", 1);
+    auto &r = child.var("r", 1);
+    auto comb = child.combinational();
+    auto if_ = std::make_shared<IfStmt>(a.shared_from_this());
+    if_->add_then_stmt(b.assign(a));
+    if_->add_else_stmt(b.assign(constant(0, 1)));
+    comb->add_stmt(if_);
+    auto seq = child.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq->add_stmt(r.assign(a));
+    top.add_child_generator("child", child.shared_from_this());
+
+    inject_debug_break_points(&top);
+    inject_breakpoint_bitmap(&top);
+
+    // three break points in the combinational block and one in the sequential block
+    auto port = child.get_port(break_point_hits_name);
+    EXPECT_TRUE(port);
+    EXPECT_EQ(port->width(), 4);
+    EXPECT_EQ(top.get_var(break_point_hits_name)->width(), 4);
+    // the hit vector is cleared first, then set right before the statement
+    EXPECT_EQ(comb->size(), 3);
+    EXPECT_EQ((*comb)[0]->type(), StatementType::Assign);
+    EXPECT_EQ((*comb)[1]->type(), StatementType::Assign);
+    EXPECT_EQ((*comb)[2], if_);
+    EXPECT_EQ(if_->then_body()->size(), 2);
+    EXPECT_EQ(seq->size(), 3);
+    EXPECT_EQ((*seq)[0]->as<AssignStmt>()->assign_type(), AssignmentType::NonBlocking);
+    // one call at the top
+    auto last = top.get_stmt(top.stmts_count() - 1);
+    EXPECT_EQ(last->type(), StatementType::Block);
+    auto block = last->as<StmtBlock>();
+    EXPECT_EQ(block->block_type(), StatementBlockType::Sequential);
+    EXPECT_EQ((*block)[0]->type(), StatementType::FunctionalCall);
+
+    auto layout = extract_breakpoint_bitmap(&top);
+    EXPECT_EQ(layout.size(), 4);
+    for (uint32_t i = 0; i < layout.size(); i++) {
+        EXPECT_EQ(layout[i].first, "top.child");
+        if (i > 0) EXPECT_LT(layout[i - 1].second, layout[i].second);
+    }
+}
+
+TEST(debug, propagate_scope_variable) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &a = mod.var("a", 1);
+    auto &b = mod.var("b", 1);
+    auto &x = mod.var("x", 1);
+    auto comb = mod.combinational();
+    auto outer = std::make_shared<IfStmt>(a.shared_from_this());
+    outer->add_scope_variable("i", "0", false, true);
+    auto inner = std::make_shared<IfStmt>(b.shared_from_this());
+    inner->add_scope_variable("i", "1", false, true);
+    inner->add_scope_variable("j", "2", false, true);
+    auto stmt = x.assign(a);
+    inner->add_then_stmt(stmt);
+    outer->add_then_stmt(inner);
+    comb->add_stmt(outer);
+
+    propagate_scope_variable(&mod);
+    auto const &scope = stmt->scope_context();
+    // the outer scope takes precedence
+    EXPECT_EQ(scope.at("i").second, "0");
+    EXPECT_EQ(scope.at("j").second, "2");
+    EXPECT_EQ(inner->else_body()->scope_context().at("i").second, "1");
+}
@@ -59,6 +59,41 @@ def test_debug_mock():
         assert "verilator public" in content
 
 
+def test_verilator_public_selective():
+    mod = Generator("mod")
+    in1 = mod.input("in1", 16)
+    in2 = mod.input("in2", 16)
+    out1 = mod.output("out1", 16)
+    out2 = mod.output("out2", 16)
+    mod.wire(out1, in1)
+    mod.wire(out2, in2)
+
+    src = verilog(mod, insert_verilator_info=True,
+                  verilator_public_names=["in1"],
+                  verilator_public_regex=r"mod\.out\d")["mod"]
+    lines = src.split("\n")
+
+    def is_public(name):
+        line = [line for line in lines
+                if line.strip().rstrip(",").endswith(name) or
+                (name + " /*verilator public*/") in line]
+        assert len(line) == 1
+        return "verilator public" in line[0]
+
+    assert is_public("in1")
+    assert not is_public("in2")
+    assert is_public("out1")
+    assert is_public("out2")
+
+    # the debug database is needed to know which signals are referenced
+    try:
+        verilog(mod, insert_verilator_info=True,
+                verilator_public_debug_only=True)
+        assert False
+    except ValueError:
+        pass
+
+
 def test_seq_debug():
     class Mod(Generator):
         def __init__(self):
@@ -442,5 +477,50 @@ def test_ssa_debug():
         conn.close()
 
 
+def test_breakpoint_bitmap():
+    def create_mod():
+        m = Generator("mod", True)
+        in_ = m.input("in", 1)
+        clk = m.clock("clk")
+        out = m.output("out", 1)
+        reg = m.var("reg", 1)
+
+        @always_comb
+        def code1():
+            if in_ == 1:
+                out = reg
+            else:
+                out = 0
+
+        @always_ff((posedge, clk))
+        def code2():
+            reg = in_
+
+        m.add_always(code1)
+        m.add_always(code2)
+        return m
+
+    mod = Generator("parent", True)
+    clk = mod.clock("clk")
+    in_ = mod.input("in", 1)
+    outs = [mod.output("out{0}".format(i), 1) for i in range(2)]
+    for i in range(2):
+        child = create_mod()
+        mod.add_child("mod{0}".format(i), child)
+        mod.wire(child.ports.clk, clk)
+        mod.wire(child.ports["in"], in_)
+        mod.wire(outs[i], child.ports.out)
+
+    src = verilog(mod, insert_debug_info=True, debug_breakpoint_bitmap=True)
+    # the batched call only happens at the top
+    assert "breakpoint_hits" in src["parent"]
+    assert "breakpoint_hits" not in src["mod"]
+    assert "KRATOS_BP_HITS" in src["mod"]
+    layout = _kratos.extract_breakpoint_bitmap(mod.internal_generator)
+    # if statement, two branches and the register assignment per instance
+    assert len(layout) == 8
+    assert [name for name, _ in layout] == ["parent.mod0"] * 4 + ["parent.mod1"] * 4
+
+
 if __name__ == "__main__":
     test_ssa_debug()
@@ -1,5 +1,5 @@
 from kratos import Generator, always_ff, posedge, negedge, reduce_add, verilog
-from kratos.formal import output_btor
+from kratos.formal import output_btor, output_aiger, output_blif
 import tempfile
 import os
 import pytest
@@ -51,5 +51,24 @@ def test_output_btor():
         assert len(lines) > 10
 
 
+def test_output_aiger_blif():
+    p = Parent()
+    with tempfile.TemporaryDirectory() as temp:
+        aiger_filename = os.path.join(temp, "test.aig")
+        output_aiger(p, aiger_filename)
+        with open(aiger_filename, "rb") as f:
+            header = f.readline().decode().split()
+        # in, clk and rst as inputs, one register in each child
+        assert header[0] == "aig"
+        assert header[2:5] == ["18", "32", "16"]
+        blif_filename = os.path.join(temp, "test.blif")
+        output_blif(p, blif_filename)
+        with open(blif_filename) as f:
+            content = f.read()
+        assert ".model Parent" in content
+        assert ".latch child_0.out[0]$next child_0.out[0] 0" in content
+        assert content.strip().endswith(".end")
+
+
 if __name__ == "__main__":
     test_output_btor()
@@ -1,14 +1,19 @@
+#include "../src/aig.hh"
 #include "../src/codegen.hh"
 #include "../src/debug.hh"
+#include "../src/elaborate.hh"
 #include "../src/except.hh"
 #include "../src/expr.hh"
 #include "../src/formal.hh"
 #include "../src/fsm.hh"
 #include "../src/generator.hh"
+#include "../src/graph.hh"
 #include "../src/interface.hh"
 #include "../src/pass.hh"
 #include "../src/port.hh"
 #include "../src/stmt.hh"
+#include "../src/summary.hh"
+#include "../src/timing.hh"
 #include "../src/util.hh"
 #include "gtest/gtest.h"
 
@@ -61,6 +66,43 @@ TEST(generator, remove_stmt) {  // NOLINT
     EXPECT_EQ(mod.get_stmt(0), nullptr);
 }
 
+TEST(generator, context_reset) {  // NOLINT
+    Context c;
+    for (auto round = 0; round < 2; round++) {
+        auto &mod = c.generator("mod");
+        auto &a = mod.var("a", 2);
+        for (auto i = 0; i < 16; i++) {
+            auto &child = c.generator("child");
+            auto &in = child.port(PortDirection::In, "in", 2);
+            mod.add_child_generator("child_" + std::to_string(i), child);
+            mod.add_stmt(in.assign(a));
+        }
+        c.enum_("color", {{"red", 0}, {"blue", 1}}, 1);
+        EXPECT_EQ(c.get_generators_by_name("child").size(), 16);
+        c.reset(round == 1);
+        // the context is usable right away
+        EXPECT_FALSE(c.generator_name_exists("mod"));
+        EXPECT_FALSE(c.has_enum("color"));
+        EXPECT_EQ(c.hash_table_size(), 0);
+    }
+    c.wait_reset();
+    auto &mod = c.generator("mod");
+    mod.add_stmt(mod.var("a", 1).assign(constant(1, 1)));
+    EXPECT_EQ(mod.stmts_count(), 1);
+    // cached hierarchies are dropped before the generators are handed off
+    generator_hierarchy(&mod);
+    EXPECT_EQ(c.num_hierarchies(), 1);
+    c.reset();
+    EXPECT_EQ(c.num_hierarchies(), 0);
+
+    // constants are shared with the other context
+    {
+        Context other;
+        EXPECT_THROW(c.reset(true), UserException);
+    }
+    c.reset(true);
+}
+
 TEST(generator, param) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -334,6 +376,35 @@ TEST(pass, fanout) {  // NOLINT
     EXPECT_TRUE(src.find('b') == std::string::npos);
 }
 
+TEST(pass, fanout_long_chain) {  // NOLINT
+    Context c;
+    constexpr uint32_t num_wires = 10000;
+    auto &mod = c.generator("module1");
+    auto &in = mod.port(PortDirection::In, "in", 1);
+    auto &out1 = mod.port(PortDirection::Out, "out1", 1);
+    auto &out2 = mod.port(PortDirection::Out, "out2", 1);
+    Var *pre = &in;
+    for (uint32_t i = 0; i < num_wires; i++) {
+        auto &var = mod.var("w" + std::to_string(i), 1);
+        mod.add_stmt(var.assign(*pre));
+        pre = &var;
+    }
+    // the last wire has two fanouts
+    mod.add_stmt(out1.assign(*pre));
+    mod.add_stmt(out2.assign(*pre));
+
+    remove_fanout_one_wires(&mod);
+    EXPECT_EQ(mod.stmts_count(), 3);
+    EXPECT_EQ(pre->sources().size(), 1);
+    EXPECT_EQ((*pre->sources().begin())->right(), &in);
+    EXPECT_TRUE(mod.get_var("w0")->sources().empty());
+    EXPECT_TRUE(mod.get_var("w0")->sinks().empty());
+
+    remove_unused_vars(&mod);
+    EXPECT_EQ(mod.get_var("w0"), nullptr);
+    EXPECT_NE(mod.get_var(pre->name), nullptr);
+}
+
 TEST(pass, pass_through_module) {  // NOLINT
     Context c;
     auto &mod1 = c.generator("module1");
@@ -596,6 +667,22 @@ TEST(generator, bundle_to_struct) {  // NOLINT
     generate_verilog(&mod1);
 }
 
+TEST(generator, bundle_to_struct_mismatch) {  // NOLINT
+    Context c;
+    auto def1 = PortBundleDefinition("bundle");
+    def1.add_definition("a", 1, 1, false, PortDirection::In, PortType::Data);
+    auto def2 = PortBundleDefinition("bundle");
+    def2.add_definition("a", 2, 1, false, PortDirection::In, PortType::Data);
+    auto &mod1 = c.generator("module1");
+    auto &mod2 = c.generator("module2");
+    auto &mod3 = c.generator("module3");
+    mod2.add_bundle_port_def("p", def1);
+    mod3.add_bundle_port_def("p", def2);
+    mod1.add_child_generator("mod2", mod2.shared_from_this());
+    mod1.add_child_generator("mod3", mod3.shared_from_this());
+    EXPECT_THROW(change_port_bundle_struct(&mod1), UserException);
+}
+
 TEST(generator, fsm) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -714,6 +801,133 @@ TEST(generator, active_low) {  // NOLINT
     EXPECT_THROW(check_active_high(&mod), VarException);
 }
 
+TEST(generator, active_high_summary) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &rst = mod.port(PortDirection::In, "reset", 1, 1, PortType::AsyncReset, false);
+    auto &a = mod.var("a", 1);
+    // used before the sequential block that determines the polarity
+    auto comb = mod.combinational();
+    auto if_ = std::make_shared<IfStmt>(rst.shared_from_this());
+    if_->add_then_stmt(a.assign(constant(0, 1)));
+    comb->add_stmt(if_);
+    auto seq = mod.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, rst.shared_from_this()});
+    EXPECT_NO_THROW(check_active_high(&mod));
+
+    auto seq2 = mod.sequential();
+    seq2->add_condition({BlockEdgeType::Negedge, rst.shared_from_this()});
+    EXPECT_THROW(check_active_high(&mod), VarException);
+}
+
+TEST(pass, module_summary) {  // NOLINT
+    Context c;
+    auto &mod1 = c.generator("mod1");
+    auto &mod2 = c.generator("mod2");
+    auto &in = mod2.port(PortDirection::In, "in", 1);
+    auto &out = mod2.port(PortDirection::Out, "out", 8);
+    mod2.add_stmt(out[std::make_pair(3, 0)].assign(constant(0, 4)));
+    mod2.add_stmt(out[std::make_pair(7, 6)].assign(constant(0, 2)));
+    mod2.add_stmt(out[4].assign(in));
+    mod1.add_child_generator("inst0", mod2.shared_from_this());
+    auto clone = mod2.clone();
+    mod1.add_child_generator("inst1", clone);
+
+    auto bits = driven_bits(&out);
+    EXPECT_EQ(bits.size(), 2);
+    EXPECT_EQ(bits[0], std::make_pair(0u, 4u));
+    EXPECT_EQ(bits[1], std::make_pair(6u, 7u));
+    auto floating = undriven_bits(bits, out.width());
+    EXPECT_EQ(floating.size(), 1);
+    EXPECT_EQ(floating[0], std::make_pair(5u, 5u));
+
+    ModuleSummaries summaries(&mod1);
+    // clones share the summary of their definition
+    EXPECT_EQ(&summaries.get(clone.get()), &summaries.get(&mod2));
+    EXPECT_EQ(summaries.get(&mod2).ports.at("out").driven_bits, bits);
+    EXPECT_THROW(verify_generator_connectivity(&mod1), StmtException);
+}
+
+TEST(generator, timing_analysis) {  // NOLINT
+    Context c;
+    auto &child = c.generator("child");
+    auto &clk = child.port(PortDirection::In, "clk", 1, 1, PortType::Clock, false);
+    auto &a = child.port(PortDirection::In, "a", 8);
+    auto &o = child.port(PortDirection::Out, "o", 8);
+    auto &r = child.var("r", 8);
+    auto seq = child.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq->add_stmt(r.assign(a + constant(1, 8)));
+    child.add_stmt(o.assign(r & a));
+
+    auto &top = c.generator("top");
+    top.port(PortDirection::In, "clk", 1, 1, PortType::Clock, false);
+    auto &in = top.port(PortDirection::In, "in", 8);
+    auto &out = top.port(PortDirection::Out, "out", 8);
+    auto clone = child.clone();
+    top.add_child_generator("inst0", child.shared_from_this());
+    top.add_child_generator("inst1", clone);
+    top.wire(*child.get_port("a"), in);
+    top.wire(*clone->get_port("a"), *child.get_port("o"));
+    top.wire(out, *clone->get_port("o"));
+
+    auto report = analyze_timing(&top);
+    // clones share the summary of their definition
+    EXPECT_EQ(report.summaries.size(), 2);
+    auto const &summary = report.summaries.at(child.handle_name());
+    // 8-bit adder
+    EXPECT_EQ(summary.in_to_reg.at("a").levels, 4);
+    EXPECT_EQ(summary.in_to_out.at({"a", "o"}).levels, 1);
+    EXPECT_EQ(summary.reg_to_out.at("o").levels, 1);
+
+    EXPECT_EQ(report.paths.size(), 5);
+    // through the and gate of inst0 into the adder of inst1
+    EXPECT_EQ(report.paths[0].delay.levels, 5);
+    for (uint64_t i = 1; i < report.paths.size(); i++) {
+        EXPECT_FALSE(report.paths[i - 1].delay < report.paths[i].delay);
+    }
+    auto path = std::find_if(report.paths.begin(), report.paths.end(), [](auto const &p) {
+        return p.type == TimingPathType::InToOut;
+    });
+    EXPECT_NE(path, report.paths.end());
+    EXPECT_EQ(path->delay.levels, 2);
+    EXPECT_EQ(path->points.front().name, "top.in");
+    EXPECT_EQ(path->points.back().name, "top.out");
+    EXPECT_EQ(path->points.size(), 6);
+}
+
+TEST(generator, timing_analysis_bit_range) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &in = mod.port(PortDirection::In, "in", 1);
+    auto &out = mod.port(PortDirection::Out, "out", 2);
+    auto &a = mod.var("a", 2);
+    auto &b = mod.var("b", 1);
+    // the bits of a don't depend on each other
+    mod.add_stmt(a[0].assign(in));
+    mod.add_stmt(b.assign(a[0]));
+    mod.add_stmt(a[1].assign(~b));
+    mod.add_stmt(out.assign(a));
+
+    auto report = analyze_timing(&mod);
+    EXPECT_EQ(report.summaries.at("mod").in_to_out.at({"in", "out"}).levels, 1);
+    EXPECT_EQ(report.paths.size(), 1);
+    std::vector<std::string> names;
+    for (auto const &point : report.paths[0].points) names.emplace_back(point.name);
+    EXPECT_EQ(names, std::vector<std::string>({"mod.in", "mod.a[0]", "mod.b", "mod.a[1]",
+                                               "mod.a", "mod.out"}));
+
+    // a real combinational loop is cut instead of followed
+    auto &loop = c.generator("loop");
+    auto &x = loop.var("x", 1);
+    auto &y = loop.var("y", 1);
+    loop.add_stmt(x.assign(~y));
+    loop.add_stmt(y.assign(x & loop.port(PortDirection::In, "in", 1)));
+    loop.add_stmt(loop.port(PortDirection::Out, "out", 1).assign(y));
+    report = analyze_timing(&loop);
+    EXPECT_EQ(report.paths.size(), 1);
+}
+
 TEST(generator, nested_fsm) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -837,6 +1051,44 @@ TEST(generator, latch_rst) {  // NOLINT
     EXPECT_NO_THROW(check_inferred_latch(&mod));
 }
 
+TEST(generator, latch_many_targets) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &in = mod.port(PortDirection::In, "in", 2);
+    auto comb = mod.combinational();
+    // spans multiple words in the assigned set
+    std::vector<Var *> vars;
+    for (auto i = 0; i < 100; i++) vars.emplace_back(&mod.var("v" + std::to_string(i), 1));
+    auto if_ = std::make_shared<IfStmt>(in.eq(constant(0, 2)));
+    auto switch_ = std::make_shared<SwitchStmt>(in.shared_from_this());
+    for (auto *v : vars) {
+        if_->add_then_stmt(v->assign(constant(0, 1)));
+        switch_->add_switch_case(constant(0, 2).as<Const>(), v->assign(constant(1, 1)));
+        switch_->add_switch_case(constant(1, 2).as<Const>(), v->assign(constant(0, 1)));
+    }
+    // the switch is not full yet
+    if_->add_else_stmt(switch_);
+    comb->add_stmt(if_);
+    EXPECT_THROW(check_inferred_latch(&mod), StmtException);
+
+    for (auto *v : vars) {
+        switch_->add_switch_case(nullptr, v->assign(constant(0, 1)));
+    }
+    EXPECT_NO_THROW(check_inferred_latch(&mod));
+
+    // only the last var is missing in one of the branches
+    auto &last = mod.var("last", 1);
+    if_->add_then_stmt(last.assign(constant(0, 1)));
+    switch_->add_switch_case(constant(0, 2).as<Const>(), last.assign(constant(0, 1)));
+    switch_->add_switch_case(nullptr, last.assign(constant(0, 1)));
+    try {
+        check_inferred_latch(&mod);
+        FAIL();
+    } catch (const StmtException &ex) {
+        EXPECT_NE(std::string(ex.what()).find("last"), std::string::npos);
+    }
+}
+
 TEST(generator, decouple2) {  // NOLINT
     Context c;
     auto &mod1 = c.generator("parent");
@@ -1172,6 +1424,46 @@ TEST(interface, extract_interface_definition) {  // NOLINT
     EXPECT_THROW(mod3.interface(config_1, "bus1", false), UserException);
 }
 
+TEST(interface, definition_hash) {  // NOLINT
+    auto config_0 = std::make_shared<InterfaceDefinition>("Config");
+    config_0->input("read", 1, 1);
+    config_0->output("write", 1, 1);
+    auto config_1 = std::make_shared<InterfaceDefinition>("Config");
+    config_1->output("write", 1, 1);
+    config_1->input("read", 1, 1);
+    EXPECT_EQ(config_0->hash(), config_1->hash());
+    auto modport = config_1->create_modport_def("R");
+    modport->set_input("read");
+    auto modport_hash = modport->hash();
+    // changes should be reflected in the hash
+    config_1->var("v", 1, 1);
+    EXPECT_NE(config_0->hash(), config_1->hash());
+    // the modport doesn't expose the new var
+    EXPECT_EQ(modport_hash, modport->hash());
+    modport->set_output("v");
+    EXPECT_NE(modport_hash, modport->hash());
+
+    // same definition shared across different child instances
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &v = mod.var("v", 1);
+    for (auto i = 0; i < 4; i++) {
+        auto &child = c.generator("child");
+        mod.add_child_generator("child_" + std::to_string(i), child);
+        auto config = std::make_shared<InterfaceDefinition>("Config");
+        config->input("read", 1, 1);
+        config->output("write", 1, 1);
+        auto bus = child.interface(config, "bus", false);
+        child.add_stmt(bus->port("read").assign(child.var("v", 1)));
+        child.add_stmt(child.var("w", 1).assign(bus->port("write")));
+    }
+    mod.add_stmt(v.assign(constant(0, 1)));
+    create_interface_instantiation(&mod);
+    auto result = extract_interface_info(&mod);
+    EXPECT_EQ(result.size(), 1);
+    EXPECT_TRUE(result.find("Config") != result.end());
+}
+
 TEST(pass, multiple_driver) {  // NOLINT
     Context c;
     auto &mod1 = c.generator("mod1");
@@ -1231,6 +1523,70 @@ TEST(pass, multiple_driver) {  // NOLINT
     EXPECT_NO_THROW(check_multiple_driver(&mod5));
 }
 
+TEST(pass, multiple_driver_slice) {  // NOLINT
+    Context c;
+    constexpr uint32_t width = 256;
+    auto &mod1 = c.generator("mod1");
+    auto &in1 = mod1.port(PortDirection::In, "in", 1);
+    auto &out1 = mod1.port(PortDirection::Out, "out", width);
+    for (uint32_t i = 0; i < width; i++) {
+        mod1.add_stmt(out1[i].assign(in1));
+    }
+    EXPECT_NO_THROW(check_multiple_driver(&mod1));
+    // overlaps with the bit 100
+    mod1.add_stmt(out1[std::make_pair(103, 100)].assign(constant(0, 4)));
+    EXPECT_THROW(check_multiple_driver(&mod1), StmtException);
+
+    // children are checked as well
+    auto &mod2 = c.generator("mod2");
+    auto &child = c.generator("child");
+    auto &a = child.var("a", 8);
+    child.add_stmt(a[std::make_pair(7, 4)].assign(constant(0, 4)));
+    child.add_stmt(a[std::make_pair(3, 0)].assign(constant(0, 4)));
+    mod2.add_child_generator("child", child.shared_from_this());
+    EXPECT_NO_THROW(check_multiple_driver(&mod2));
+    child.add_stmt(a[std::make_pair(5, 2)].assign(constant(0, 4)));
+    EXPECT_THROW(check_multiple_driver(&mod2), StmtException);
+
+    // the same bits are driven in every iteration
+    auto &mod3 = c.generator("mod3");
+    auto &clk = mod3.port(PortDirection::In, "clk", 1);
+    auto &b = mod3.var("b", 4);
+    auto seq = mod3.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    auto loop = std::make_shared<ForStmt>("i", 0, 4, 1);
+    seq->add_stmt(loop);
+    loop->add_stmt(b[0].assign(constant(0, 1), AssignmentType::NonBlocking));
+    EXPECT_THROW(check_multiple_driver(&mod3), StmtException);
+
+    // priority encoder. the assignment only happens for some of the iterations
+    auto &mod4 = c.generator("mod4");
+    auto &clk4 = mod4.port(PortDirection::In, "clk", 1);
+    auto &req = mod4.port(PortDirection::In, "req", 4);
+    auto &grant = mod4.var("grant", 1);
+    seq = mod4.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk4.shared_from_this()});
+    loop = std::make_shared<ForStmt>("i", 0, 4, 1);
+    seq->add_stmt(loop);
+    auto if_ = std::make_shared<IfStmt>(req[loop->get_iter_var()]);
+    if_->add_then_stmt(grant.assign(constant(1, 1), AssignmentType::NonBlocking));
+    loop->add_stmt(if_);
+    EXPECT_NO_THROW(check_multiple_driver(&mod4));
+    // a condition outside of the loop doesn't help
+    auto &mod5 = c.generator("mod5");
+    auto &clk5 = mod5.port(PortDirection::In, "clk", 1);
+    auto &en = mod5.port(PortDirection::In, "en", 1);
+    auto &d = mod5.var("d", 4);
+    seq = mod5.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk5.shared_from_this()});
+    loop = std::make_shared<ForStmt>("i", 0, 4, 1);
+    if_ = std::make_shared<IfStmt>(en);
+    if_->add_then_stmt(loop);
+    seq->add_stmt(if_);
+    loop->add_stmt(d[0].assign(constant(0, 1), AssignmentType::NonBlocking));
+    EXPECT_THROW(check_multiple_driver(&mod5), StmtException);
+}
+
 TEST(pass, check_combinational_loop) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -1323,6 +1679,108 @@ TEST(formal, test_remove_async) {  // NOLINT
     EXPECT_TRUE(seq3->get_conditions().empty());
 }
 
+TEST(formal, bit_blast) {  // NOLINT
+    AIG aig;
+    auto a = aig.add_input("a");
+    auto b = aig.add_input("b");
+    // structural hashing
+    EXPECT_EQ(aig.and_(a, b), aig.and_(b, a));
+    EXPECT_EQ(aig.and_(a, AIG::negate(a)), AIG::false_lit);
+    EXPECT_EQ(aig.and_(a, AIG::true_lit), a);
+    EXPECT_EQ(aig.num_ands(), 1u);
+
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &clk = mod.port(PortDirection::In, "clk", 1, PortType::Clock);
+    auto &rst = mod.port(PortDirection::In, "rst", 1, PortType::AsyncReset);
+    auto &in = mod.port(PortDirection::In, "in", 4);
+    auto &out = mod.port(PortDirection::Out, "out", 4);
+    auto &eq = mod.port(PortDirection::Out, "eq", 1);
+    auto &count = mod.var("count", 4);
+    auto seq = mod.sequential();
+    seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq->add_condition({BlockEdgeType::Posedge, rst.shared_from_this()});
+    auto if_ = std::make_shared<IfStmt>(rst);
+    if_->add_then_stmt(count.assign(constant(0, 4)));
+    if_->add_else_stmt(count.assign(count + in));
+    seq->add_stmt(if_);
+    mod.add_stmt(out.assign(count));
+    mod.add_stmt(eq.assign(count.eq(in)));
+
+    aig = bit_blast(&mod);
+    EXPECT_EQ(aig.num_inputs(), 6u);
+    EXPECT_EQ(aig.num_latches(), 4u);
+    EXPECT_EQ(aig.num_outputs(), 5u);
+
+    std::stringstream aiger;
+    aig.write_aiger(aiger);
+    std::string header;
+    std::getline(aiger, header);
+    auto num_ands = std::to_string(aig.num_ands());
+    EXPECT_EQ(header, "aig " + std::to_string(10 + aig.num_ands()) + " 6 4 5 " + num_ands);
+    EXPECT_NE(aiger.str().find("i1 in[0]\n"), std::string::npos);
+
+    std::stringstream blif;
+    aig.write_blif(blif, mod.name);
+    auto str = blif.str();
+    EXPECT_EQ(str.find(".model mod\n"), 0);
+    EXPECT_NE(str.find(".latch count[3]$next count[3] 0\n"), std::string::npos);
+    EXPECT_NE(str.find(".outputs eq out[0] out[1] out[2] out[3]\n"), std::string::npos);
+
+    // count up by in every cycle
+    std::unordered_map<std::string, bool> inputs;
+    for (uint32_t i = 0; i < 4; i++) {
+        inputs.emplace("in[" + std::to_string(i) + "]", (3u >> i) & 1u);
+    }
+    std::vector<bool> latches;
+    for (uint32_t cycle = 0; cycle < 3; cycle++) {
+        auto outputs = aig.evaluate(inputs, latches);
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < 4; i++) {
+            value |= outputs.at("out[" + std::to_string(i) + "]") << i;
+        }
+        EXPECT_EQ(value, cycle * 3);
+        EXPECT_EQ(outputs.at("eq"), cycle == 1);
+    }
+    inputs.emplace("rst", true);
+    (void)aig.evaluate(inputs, latches);
+    EXPECT_EQ(latches, std::vector<bool>(4, false));
+}
+
+TEST(formal, bit_blast_comb_feedback) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    auto &a = mod.port(PortDirection::In, "a", 4);
+    auto &b = mod.port(PortDirection::In, "b", 4);
+    auto &o = mod.port(PortDirection::Out, "o", 4);
+    auto &d = mod.var("d", 4);
+    auto &cc = mod.var("cc", 4);
+    // o goes through cc outside of the block, which only depends on d
+    auto comb = mod.combinational();
+    comb->add_stmt(d.assign(a));
+    comb->add_stmt(o.assign(cc));
+    mod.add_stmt(cc.assign(d + b));
+
+    auto aig = bit_blast(&mod);
+    EXPECT_EQ(aig.num_inputs(), 8u);
+    std::vector<bool> latches;
+    for (uint32_t value_a = 0; value_a < 16; value_a += 5) {
+        for (uint32_t value_b = 0; value_b < 16; value_b += 3) {
+            std::unordered_map<std::string, bool> inputs;
+            for (uint32_t i = 0; i < 4; i++) {
+                inputs.emplace("a[" + std::to_string(i) + "]", (value_a >> i) & 1u);
+                inputs.emplace("b[" + std::to_string(i) + "]", (value_b >> i) & 1u);
+            }
+            auto outputs = aig.evaluate(inputs, latches);
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < 4; i++) {
+                value |= outputs.at("o[" + std::to_string(i) + "]") << i;
+            }
+            EXPECT_EQ(value, (value_a + value_b) % 16);
+        }
+    }
+}
+
 TEST(pass, check_d_flip_flop) {  // NOLINT
     Context c;
     auto &mod = c.generator("mod");
@@ -1640,4 +2098,177 @@ TEST(generator, unwire) {   // NOLINT
     EXPECT_EQ(mod.stmts_count(), 1);
     mod.unwire(b, a);
     EXPECT_EQ(mod.stmts_count(), 0);
-}
\ No newline at end of file
+}
+
+TEST(pass, incremental_verilog) {  // NOLINT
+    Context c;
+    c.set_incremental(true);
+    auto &mod1 = c.generator("module1");
+    auto &in1 = mod1.port(PortDirection::In, "in", 1);
+    auto &out1 = mod1.port(PortDirection::Out, "out", 1);
+
+    auto &mod2 = c.generator("module2");
+    auto &param = mod2.parameter("P", 32);
+    param.set_value(2);
+    auto &in2 = mod2.port(PortDirection::In, "in", 1);
+    auto &out2 = mod2.port(PortDirection::Out, "out", 1);
+    mod2.add_stmt(out2.assign(in2));
+
+    auto &mod3 = c.generator("module3");
+    auto &in3 = mod3.port(PortDirection::In, "in", 1);
+    auto &out3 = mod3.port(PortDirection::Out, "out", 1);
+    mod3.add_stmt(out3.assign(in3));
+
+    mod1.add_child_generator("inst0", mod2.shared_from_this());
+    mod1.add_child_generator("inst1", mod3.shared_from_this());
+    mod1.add_stmt(in2.assign(in1));
+    mod1.add_stmt(in3.assign(out2));
+    mod1.add_stmt(out1.assign(out3));
+
+    VerilogModule verilog(&mod1);
+    PassManager &manager = verilog.pass_manager();
+    manager.add_pass("decouple_generator_ports");
+    manager.add_pass("fix_assignment_type");
+    manager.add_pass("hash_generators_parallel");
+    manager.add_pass("uniquify_generators");
+    manager.add_pass("create_module_instantiation");
+    verilog.run_passes();
+    auto src = verilog.verilog_src();
+    EXPECT_FALSE(mod1.is_dirty());
+    EXPECT_FALSE(mod3.is_dirty());
+    EXPECT_NE(mod3.cached_verilog("/"), nullptr);
+
+    // only the changed module and its ancestors are affected
+    param.set_value(4);
+    EXPECT_TRUE(mod2.is_dirty());
+    EXPECT_TRUE(mod1.is_dirty());
+    EXPECT_FALSE(mod3.is_dirty());
+    EXPECT_TRUE(mod1.is_dirty(DirtyState::Codegen));
+    EXPECT_EQ(mod2.cached_verilog("/"), nullptr);
+    EXPECT_NE(mod3.cached_verilog("/"), nullptr);
+
+    // tag the cached source so that we can tell whether it gets regenerated
+    const std::string tag = "// cached\n";
+    mod3.set_cached_verilog("/", src.at("module3") + tag);
+
+    verilog.run_passes();
+    auto new_src = verilog.verilog_src();
+    EXPECT_EQ(new_src.size(), 3);
+    EXPECT_NE(new_src.at("module2"), src.at("module2"));
+    EXPECT_EQ(new_src.at("module3"), src.at("module3") + tag);
+    // identical to a full codegen
+    c.set_incremental(false);
+    auto full_src = generate_verilog(&mod1);
+    EXPECT_EQ(new_src.at("module1"), full_src.at("module1"));
+    EXPECT_EQ(new_src.at("module2"), full_src.at("module2"));
+    EXPECT_EQ(src.at("module3"), full_src.at("module3"));
+    EXPECT_FALSE(mod2.is_dirty());
+}
+
+TEST(generator, elaboration_cache) {  // NOLINT
+    Context c;
+    ElaborationCache cache(&c);
+    uint32_t num_elaborations = 0;
+    auto elaborate = [&](Generator *gen, const ElaborationCache::ParamValues &values) {
+        num_elaborations++;
+        auto &width = gen->parameter("WIDTH", 32);
+        width.set_initial_value(1);
+        width.set_value(1);
+        auto &mode = gen->parameter("MODE", 32);
+        mode.set_initial_value(values.at("MODE"));
+        mode.set_value(values.at("MODE"));
+        auto &in = gen->port(PortDirection::In, "in", 1);
+        auto &out = gen->port(PortDirection::Out, "out", 1);
+        in.set_width_param(&width);
+        out.set_width_param(&width);
+        // the structure depends on the mode
+        if (values.at("MODE")) {
+            gen->add_stmt(out.assign(~in));
+        } else {
+            gen->add_stmt(out.assign(in));
+        }
+    };
+
+    auto &top = c.generator("top");
+    std::vector<std::pair<int64_t, int64_t>> configs = {{0, 4}, {0, 8}, {1, 8}, {0, 8}};
+    std::vector<std::shared_ptr<Generator>> instances;
+    for (uint64_t i = 0; i < configs.size(); i++) {
+        auto [mode, width] = configs[i];
+        auto inst = cache.instantiate("child", {{"MODE", mode}, {"WIDTH", width}}, {"MODE"},
+                                      elaborate);
+        top.add_child_generator("inst" + std::to_string(i), inst);
+        auto &in = top.port(PortDirection::In, "in" + std::to_string(i), width);
+        top.add_stmt(inst->get_port("in")->assign(in));
+        instances.emplace_back(inst);
+    }
+    EXPECT_EQ(num_elaborations, 2);
+    EXPECT_EQ(cache.num_templates(), 2);
+    EXPECT_FALSE(instances[0]->is_cloned());
+    EXPECT_TRUE(instances[1]->is_cloned());
+    EXPECT_EQ(instances[1]->def_instance(), instances[0].get());
+    EXPECT_EQ(instances[1]->get_port("in")->width(), 8);
+    EXPECT_EQ(instances[3]->def_instance(), instances[1]->def_instance());
+    EXPECT_THROW(cache.instantiate("child", {{"WIDTH", 1}}, {"MODE"}, elaborate), UserException);
+
+    fix_assignment_type(&top);
+    hash_generators(&top, HashStrategy::SequentialHash);
+    uniquify_generators(&top);
+    create_module_instantiation(&top);
+    auto src = generate_verilog(&top);
+    // one definition per structure
+    EXPECT_EQ(src.size(), 3);
+    EXPECT_EQ(instances[1]->name, instances[0]->name);
+    EXPECT_NE(src.at("top").find(".WIDTH(32'h8)"), std::string::npos);
+}
+
+TEST(generator, symbol_table) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("mod");
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < 100; i++) {
+        auto name = "v" + std::to_string(99 - i);
+        mod.var(name, 1);
+        names.emplace_back(name);
+    }
+    mod.port(PortDirection::In, "a", 1);
+    std::sort(names.begin(), names.end());
+    names.insert(names.begin(), "a");
+
+    // iterated in name order
+    std::vector<std::string> result;
+    for (auto const &[name, var] : mod.vars()) {
+        EXPECT_EQ(name, var->name);
+        result.emplace_back(name);
+    }
+    EXPECT_EQ(result, names);
+
+    for (uint32_t i = 0; i < 100; i += 2) mod.remove_var("v" + std::to_string(i));
+    mod.rename_var("v1", "w1");
+    EXPECT_EQ(mod.vars().size(), 51);
+    EXPECT_FALSE(mod.get_var("v1"));
+    EXPECT_FALSE(mod.get_var("v0"));
+    EXPECT_EQ(mod.get_var("w1")->name, "w1");
+    EXPECT_EQ(mod.vars().find("w1")->first, "w1");
+    EXPECT_EQ(mod.get_all_var_names().back(), "w1");
+    EXPECT_TRUE(mod.get_port("a"));
+
+    // iterators stay valid while the table changes, same as std::map
+    result.clear();
+    for (auto const &[name, var] : mod.vars()) {
+        result.emplace_back(name);
+        if (name[0] == 'v') mod.remove_var(name);
+        mod.var("z" + name, 1);
+    }
+    EXPECT_EQ(result.size(), 51);
+    EXPECT_EQ(result.back(), "w1");
+    EXPECT_EQ(mod.vars().size(), 53);
+    EXPECT_EQ(mod.vars().begin()->first, "a");
+    EXPECT_EQ(mod.vars().find("zw1")->first, "zw1");
+
+    // ports are kept when the vars are re-indexed
+    mod.get_var("zw1")->name = "yw1";
+    mod.reindex_vars();
+    EXPECT_TRUE(mod.get_var("yw1"));
+    EXPECT_FALSE(mod.get_var("zw1"));
+    EXPECT_TRUE(mod.has_port("a"));
+}
@@ -680,6 +680,38 @@ def test_simple_pipeline(check_gold):
     check_gold(mod, "test_simple_pipeline", insert_pipeline_stages=True)
 
 
+def test_pipeline_retiming():
+    from _kratos.passes import analyze_timing, TimingPathType
+    mod = Generator("mod", True)
+    mod.clock("clk")
+    a = mod.input("a", 8)
+    b = mod.input("b", 8)
+    c = mod.input("c", 8)
+    valid_in = mod.input("valid_in", 1)
+    out = mod.output("out", 8)
+    valid = mod.output("valid", 1)
+    t = mod.var("t", 8)
+    mod.wire(t, a * b)
+    mod.wire(out, t * c + a)
+    mod.wire(valid, valid_in)
+    for type_str, value_str in (("pipeline", "2"), ("pipeline_retime", "1")):
+        attr = Attribute()
+        attr.type_str = type_str
+        attr.value_str = value_str
+        mod.add_attribute(attr)
+
+    src = verilog(mod, insert_pipeline_stages=True, optimize_fanout=False)["mod"]
+    # the second multiplier and the adder are moved into the second stage
+    assert "t_stage_1 <= t;" in src
+    assert "out <= (t_stage_1 * c_stage_1) + a_stage_1;" in src
+    # valid is delayed as much as the data
+    assert "valid <= valid_in_stage_1;" in src
+    report = analyze_timing(mod.internal_generator)
+    assert all(p.type != TimingPathType.InToOut for p in report.paths)
+    # a multiplier and an adder instead of two multipliers and an adder
+    assert report.paths[0].delay.levels == 12
+
+
 def test_replace(check_gold):
     mod = PassThroughTop()
 
@@ -1877,6 +1909,49 @@ def test_param_set_value_instance():
     assert "child #(\n  .P(32'h3))\ninst()" in src
 
 
+def test_verilog_incremental():
+    child1 = Generator("child1")
+    child2 = Generator("child2")
+    parent = Generator("parent")
+    param = child1.parameter("P", 32, 1)
+    parent.add_child("inst1", child1)
+    parent.add_child("inst2", child2)
+    src = verilog(parent, optimize_passthrough=False, incremental=True)
+    assert not parent.internal_generator.is_dirty()
+    param.value = 2
+    assert parent.internal_generator.is_dirty()
+    assert not child2.internal_generator.is_dirty()
+    new_src = verilog(parent, optimize_passthrough=False, incremental=True)
+    assert new_src["child2"] == src["child2"]
+    assert not parent.internal_generator.is_dirty()
+    # same as a full run
+    assert new_src == verilog(parent, optimize_passthrough=False)
+
+
+def test_specialize():
+    class Child(Generator):
+        def __init__(self):
+            super().__init__("child")
+            p = self.parameter("P", 32, initial_value=4)
+            in_ = self.input("in", p)
+            out = self.output("out", p)
+            self.wire(out, in_)
+
+    parent = Generator("parent")
+    widths = [4, 8, 8]
+    for i, width in enumerate(widths):
+        child = Child.specialize(params={"P": width})
+        assert child.ports["in"].width == width
+        parent.add_child("inst{0}".format(i), child)
+        parent.wire(child.ports["in"], parent.input("in{0}".format(i), width))
+        parent.wire(parent.output("out{0}".format(i), width),
+                    child.ports["out"])
+    src = verilog(parent, optimize_passthrough=False)
+    # only one definition for all the parameter values
+    assert len(src) == 2
+    assert src["parent"].count("child #(\n  .P(32'h8))") == 2
+
+
 def test_ports_vars_iter():
     mod = Generator("mod")
     mod.input("a", 1)
@@ -2238,6 +2313,34 @@ def test_gen_inst_lift(check_gold):
     assert "genvar" not in src
 
 
+def test_gen_inst_lift_groups():
+    # instances of the same definition connected to different arrays are lifted
+    # into separate loops, in the order of first appearance
+    parent = Generator("parent")
+    a_array = parent.var("a", 1, size=8)
+    b_array = parent.var("b", 1, size=8)
+    c_array = parent.var("c", 1, size=8)
+    d_array = parent.var("d", 1, size=8)
+
+    for i in range(8):
+        for prefix, in_array, out_array in (("x", a_array, b_array),
+                                            ("y", c_array, d_array)):
+            child = Generator("child")
+            a = child.input("a", 1)
+            b = child.output("b", 1)
+            child.wire(b, a)
+            # out of order instantiation
+            idx = 7 - i
+            parent.add_child(f"{prefix}_{idx}", child, a=in_array[idx],
+                             b=out_array[idx])
+
+    src = verilog(parent, lift_genvar_instances=True)["parent"]
+    assert src.count("genvar") == 2
+    assert src.index("begin :x") < src.index("begin :y")
+    assert ".a(a[3'(" in src
+    assert ".a(c[3'(" in src
+
+
 def test_add_child_interface_port_wiring(check_gold):
     from kratos import Interface
     mod = Generator("mod")
@@ -2267,6 +2370,55 @@ def test_add_child_interface_port_wiring(check_gold):
                optimize_passthrough=False)
 
 
+def test_memory_usage():
+    from _kratos import compute_memory_usage
+    mod = Generator("mod")
+    a = mod.var("a", 4)
+    b = mod.var("b", 4)
+    mod.wire(a, b + a)
+    child = Generator("child")
+    child.input("in", 4)
+    mod.add_child("child", child)
+    mod.wire(child.ports["in"], a)
+
+    report = compute_memory_usage(mod.internal_generator)
+    assert report.node_kinds["Generator"].count == 2
+    assert report.node_kinds["Port"].count == 1
+    assert report.node_kinds["Expr"].count == 1
+    assert report.total.bytes > 0
+    assert report.modules["child"].bytes > 0
+    c = Generator.get_context()
+    assert c.memory_usage().total.bytes >= report.total.bytes
+
+
+def test_timing_analysis():
+    from _kratos.passes import analyze_timing, TimingPathType
+    mod = Generator("mod", True)
+    clk = mod.clock("clk")
+    a = mod.input("a", 16)
+    out = mod.output("out", 16)
+    b = mod.var("b", 16)
+    c = mod.var("c", 16)
+
+    @always_ff((posedge, clk))
+    def code():
+        b = a
+        c = b * b
+
+    mod.add_always(code)
+    mod.wire(out, c + b)
+
+    report = analyze_timing(mod.internal_generator)
+    path = report.paths[0]
+    # 16-bit multiplier
+    assert path.type == TimingPathType.RegToReg
+    assert path.delay.levels == 10
+    assert [p.name for p in path.points] == ["mod.b", "mod.c"]
+    # points to the multiplication
+    assert len(path.points[-1].fn_name_ln) > 0
+    assert "register to output" in str(report)
+
+
 if __name__ == "__main__":
     from conftest import check_gold_fn
     test_gen_inst_lift(check_gold_fn)
@@ -1,7 +1,10 @@
 #include "../src/context.hh"
 #include "../src/expr.hh"
 #include "../src/generator.hh"
+#include "../src/graph.hh"
+#include "../src/stats.hh"
 #include "../src/stmt.hh"
+#include "../src/visitor.hh"
 #include "gtest/gtest.h"
 
 using namespace kratos;
@@ -18,6 +21,20 @@ public:
     uint32_t current_level() { return level; }
 };
 
+class AssignCounter : public StmtVisitor<AssignCounter> {
+public:
+    void visit(AssignStmt *) { count++; }
+    uint32_t count = 0;
+};
+
+class SequentialCounter : public StmtVisitor<SequentialCounter> {
+public:
+    void visit(SequentialStmtBlock *) { count++; }
+    void visit(Generator *) { generators++; }
+    uint32_t count = 0;
+    uint32_t generators = 0;
+};
+
 TEST(ir, visit_var) {  // NOLINT
     Context c;
     auto &mod = c.generator("test");
@@ -68,4 +85,179 @@ TEST(ir, attribute) {  // NOLINT
     var1.add_attribute(attr);
     EXPECT_EQ(var1.get_attributes().size(), 1);
     EXPECT_EQ(reinterpret_cast<TestAttribute*>(var1.get_attributes()[0]->get())->value(), 42);
-}
\ No newline at end of file
+}
+
+TEST(ir, typed_attribute) {  // NOLINT
+    const AttributeKey<uint32_t> int_key("test-int");
+    const AttributeKey<std::string> str_key("test-str");
+    // keys are registered by name
+    EXPECT_EQ(AttributeKey<uint32_t>("test-int").id(), int_key.id());
+    EXPECT_NE(int_key.id(), str_key.id());
+
+    Context c;
+    auto &mod = c.generator("test");
+    auto &var1 = mod.var("a", 2);
+    EXPECT_FALSE(var1.has_attribute(int_key));
+    EXPECT_EQ(var1.get_attribute(str_key), nullptr);
+    var1.set_attribute(int_key, 42u);
+    var1.set_attribute(str_key, std::string("value"));
+    EXPECT_TRUE(var1.has_attribute(int_key));
+    EXPECT_EQ(*var1.get_attribute(int_key), 42);
+    EXPECT_EQ(*var1.get_attribute(str_key), "value");
+    // the same string is only stored once
+    auto &var2 = mod.var("b", 2);
+    var2.set_attribute(str_key, std::string("value"));
+    EXPECT_EQ(var1.get_attribute(str_key), var2.get_attribute(str_key));
+    var1.remove_attribute(int_key);
+    EXPECT_FALSE(var1.has_attribute(int_key));
+    // and released with the last node holding it
+    std::weak_ptr<const std::string> value = intern_attribute_string("value");
+    EXPECT_FALSE(value.expired());
+    var1.remove_attribute(str_key);
+    var2.remove_attribute(str_key);
+    EXPECT_TRUE(value.expired());
+    // string attributes are independent
+    EXPECT_TRUE(var1.get_attributes().empty());
+}
+
+TEST(ir, memory_usage) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("parent");
+    auto &a = mod.var("a", 4);
+    auto &b = mod.var("b", 4);
+    auto stmt = a.assign(b + a);
+    stmt->fn_name_ln.emplace_back("test_ir.cc", 42);
+    mod.add_stmt(stmt);
+    mod.add_stmt(b[0].assign(constant(1, 1)));
+    for (auto i = 0; i < 2; i++) {
+        auto &child = c.generator("child");
+        auto &in = child.port(PortDirection::In, "in", 4);
+        mod.add_child_generator("child_" + std::to_string(i), child);
+        mod.add_stmt(in.assign(a));
+    }
+
+    auto report = compute_memory_usage(&mod);
+    EXPECT_EQ(report.node_kinds.at("Generator").count, 3);
+    EXPECT_EQ(report.node_kinds.at("Var").count, 2);
+    EXPECT_EQ(report.node_kinds.at("Port").count, 2);
+    EXPECT_EQ(report.node_kinds.at("Expr").count, 1);
+    EXPECT_EQ(report.node_kinds.at("VarSlice").count, 1);
+    EXPECT_EQ(report.node_kinds.at("AssignStmt").count, 4);
+    EXPECT_EQ(report.node_kinds.at("fn_name_ln").count, 1);
+    // constants are not attributed to any generator
+    EXPECT_EQ(report.node_kinds.find("Const"), report.node_kinds.end());
+    EXPECT_EQ(report.generators.size(), 3);
+    EXPECT_EQ(report.modules.size(), 2);
+    EXPECT_EQ(report.modules.at("child").count, report.generators.at("parent.child_0").count * 2);
+
+    uint64_t bytes = 0;
+    for (auto const &iter : report.node_kinds) bytes += iter.second.bytes;
+    EXPECT_EQ(bytes, report.total.bytes);
+    auto context_report = compute_memory_usage(&c);
+    EXPECT_EQ(context_report.total.bytes, report.total.bytes);
+}
+
+TEST(ir, stmt_visitor) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("parent");
+    auto &child = c.generator("child");
+    mod.add_child_generator("inst", child.shared_from_this());
+    auto &a = mod.var("a", 2);
+    auto &b = child.var("b", 2);
+    mod.add_stmt(a.assign(constant(1, 2)));
+    auto seq = mod.sequential();
+    auto if_ = std::make_shared<IfStmt>(a.eq(constant(0, 2)));
+    if_->add_then_stmt(a.assign(constant(2, 2)));
+    if_->add_else_stmt(a.assign(constant(3, 2)));
+    seq->add_stmt(if_);
+    auto comb = child.combinational();
+    comb->add_stmt(b.assign(constant(0, 2)));
+    child.sequential();
+
+    AssignCounter assign_counter;
+    assign_counter.visit_root(&mod);
+    EXPECT_EQ(assign_counter.count, 4);
+
+    SequentialCounter seq_counter;
+    seq_counter.visit_root(&mod);
+    EXPECT_EQ(seq_counter.count, 2);
+    EXPECT_EQ(seq_counter.generators, 2);
+    seq_counter.visit_content(&child);
+    EXPECT_EQ(seq_counter.count, 3);
+}
+
+TEST(ir, hierarchy_index) {  // NOLINT
+    Context c;
+    auto &mod = c.generator("parent");
+    auto &child1 = c.generator("child");
+    auto &child2 = c.generator("child");
+    auto &grandchild = c.generator("grandchild");
+    mod.add_child_generator("inst1", child1.shared_from_this());
+    child1.add_child_generator("inst", grandchild.shared_from_this());
+
+    auto graph = generator_hierarchy(&mod);
+    // cached until the hierarchy changes
+    EXPECT_EQ(graph, generator_hierarchy(&mod));
+    EXPECT_EQ(graph->get_leveled_generators().size(), 3);
+    EXPECT_EQ(graph->get_sorted_generators().back(), &mod);
+
+    // the old snapshot is untouched
+    mod.add_child_generator("inst2", child2.shared_from_this());
+    auto new_graph = generator_hierarchy(&mod);
+    EXPECT_NE(graph, new_graph);
+    EXPECT_FALSE(graph->has_node(&child2));
+    EXPECT_TRUE(new_graph->has_node(&child2));
+    EXPECT_EQ(new_graph->get_leveled_generators()[1].size(), 2);
+
+    // same as building it from scratch
+    auto check = [&](const GeneratorGraph *g) {
+        GeneratorGraph expected(&mod);
+        auto sorted = g->get_sorted_generators();
+        auto expected_sorted = expected.get_sorted_generators();
+        EXPECT_EQ(sorted.size(), expected_sorted.size());
+        std::unordered_map<Generator *, uint64_t> index;
+        for (uint64_t i = 0; i < sorted.size(); i++) index.emplace(sorted[i], i);
+        for (auto *gen : sorted) {
+            auto *node = expected.get_node(gen);
+            if (node->parent) EXPECT_LT(index.at(gen), index.at(node->parent));
+            EXPECT_EQ(const_cast<GeneratorGraph *>(g)->get_node(gen)->path, node->path);
+        }
+        auto levels = g->get_leveled_generators();
+        auto expected_levels = expected.get_leveled_generators();
+        EXPECT_EQ(levels.size(), expected_levels.size());
+        for (uint64_t i = 0; i < levels.size(); i++) {
+            EXPECT_EQ(std::set<Generator *>(levels[i].begin(), levels[i].end()),
+                      std::set<Generator *>(expected_levels[i].begin(), expected_levels[i].end()));
+        }
+    };
+    check(new_graph.get());
+
+    mod.rename_child_generator(child1.shared_from_this(), "inst3");
+    graph = generator_hierarchy(&mod);
+    EXPECT_EQ(const_cast<GeneratorGraph *>(graph.get())->get_node(&grandchild)->path,
+              "parent.inst3.inst");
+    check(graph.get());
+
+    mod.remove_child_generator(child1.shared_from_this());
+    graph = generator_hierarchy(&mod);
+    EXPECT_FALSE(graph->has_node(&grandchild));
+    EXPECT_EQ(graph->get_leveled_generators().size(), 2);
+    check(graph.get());
+
+    // the orderings are only recomputed once the updates are done
+    graph.reset();
+    new_graph.reset();
+    mod.add_child_generator("inst1", child1.shared_from_this());
+    mod.remove_child_generator(child2.shared_from_this());
+    graph = generator_hierarchy(&mod);
+    EXPECT_TRUE(graph->sorted());
+    check(graph.get());
+
+    // the entry is dropped with its root
+    {
+        auto root = std::make_shared<Generator>(&c, "root");
+        generator_hierarchy(root.get());
+        EXPECT_EQ(c.num_hierarchies(), 2);
+    }
+    EXPECT_EQ(c.num_hierarchies(), 1);
+}
@@ -1,5 +1,6 @@
 #include <random>
 #include "../src/eval.hh"
+#include "../src/pass.hh"
 #include "../src/sim.hh"
 #include "../src/stmt.hh"
 #include "../src/util.hh"
@@ -330,4 +331,100 @@ TEST(sim, ternary) {    // NOLINT
     sim.set(&a, 1);
     result = (*sim.eval_expr(&cond))[0];
     EXPECT_EQ(result, 42);
-}
\ No newline at end of file
+}
+
+TEST(sim, toggle_activity) {    // NOLINT
+    Context context;
+    auto &mod = context.generator("mod");
+    auto &clk = mod.port(PortDirection::In, "clk", 1, PortType::Clock);
+    mod.port(PortDirection::In, "clk_en", 1, PortType::ClockEnable);
+    auto &a = mod.port(PortDirection::In, "a", 4);
+    auto &b = mod.port(PortDirection::In, "b", 4);
+    auto &busy = mod.var("busy", 4);
+    auto &idle = mod.var("idle", 4);
+    auto seq_busy = mod.sequential();
+    seq_busy->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq_busy->add_stmt(busy.assign(a));
+    auto seq_idle = mod.sequential();
+    seq_idle->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+    seq_idle->add_stmt(idle.assign(b));
+
+    Simulator sim(&mod);
+    sim.set_toggle_count(true);
+    sim.set(&clk, 0);
+    sim.set(&b, 0);
+    for (uint32_t i = 0; i < 8; i++) {
+        sim.set(&a, i % 2 ? 0xF : 0);
+        sim.set(&clk, 1);
+        sim.set(&clk, 0);
+    }
+    EXPECT_EQ(sim.num_cycles(), 8);
+    // the first value is not a toggle
+    EXPECT_EQ(sim.toggle_count(&busy), 7 * 4);
+    EXPECT_EQ(sim.toggle_count(&busy[0]), 7 * 4);
+    EXPECT_EQ(sim.toggle_count(&idle), 0);
+
+    auto profile = sim.activity_profile();
+    EXPECT_EQ(profile.cycles, 8);
+    EXPECT_DOUBLE_EQ(profile.signals.at("mod.busy").activity, 7.0 / 8);
+    EXPECT_EQ(profile.register_groups.size(), 2);
+    auto const &group = profile.register_groups[0];
+    EXPECT_EQ(group.block, seq_busy.get());
+    EXPECT_EQ(group.registers, std::vector<std::string>{"mod.busy"});
+    EXPECT_DOUBLE_EQ(group.activity.activity, 7.0 / 8);
+    EXPECT_EQ(profile.register_groups[1].activity.toggles, 0);
+    EXPECT_GT(profile.generators.at("mod").toggles, 7 * 4);
+
+    // only the idle registers are worth gating
+    auto_insert_clock_enable(&mod, profile, 0.5);
+    EXPECT_EQ(seq_busy->get_stmt(0)->type(), StatementType::Assign);
+    EXPECT_EQ(seq_idle->get_stmt(0)->type(), StatementType::If);
+}
+
+TEST(sim, check_equivalence) {    // NOLINT
+    Context context;
+    auto build = [&context](const std::string &name, bool bug) -> Generator & {
+        auto &mod = context.generator(name);
+        auto &clk = mod.port(PortDirection::In, "clk", 1, PortType::Clock);
+        auto &rst = mod.port(PortDirection::In, "rst", 1, PortType::AsyncReset);
+        auto &a = mod.port(PortDirection::In, "a", 8);
+        auto &b = mod.port(PortDirection::In, "b", 8);
+        auto &out = mod.port(PortDirection::Out, "out", 8);
+        auto &sum = mod.port(PortDirection::Out, "sum", 8);
+        auto &value = mod.var("value", 8);
+        auto seq = mod.sequential();
+        seq->add_condition({BlockEdgeType::Posedge, clk.shared_from_this()});
+        seq->add_condition({BlockEdgeType::Posedge, rst.shared_from_this()});
+        auto if_ = std::make_shared<IfStmt>(rst);
+        if_->add_then_stmt(value.assign(constant(0, 8)));
+        if_->add_else_stmt(value.assign(a));
+        seq->add_stmt(if_);
+        mod.add_stmt(out.assign(value));
+        // only differs when both MSBs are set
+        if (bug) {
+            mod.add_stmt(sum.assign((a & constant(0x7F, 8)) + b));
+        } else {
+            mod.add_stmt(sum.assign(a + b));
+        }
+        return mod;
+    };
+    auto &ref = build("reference", false);
+    auto &same = build("same", false);
+    auto &diff = build("diff", true);
+
+    auto result = check_equivalence(&ref, &same, 100);
+    EXPECT_TRUE(result.equivalent());
+    EXPECT_EQ(result.cycles, 100);
+
+    result = check_equivalence(&ref, &diff, 100);
+    EXPECT_FALSE(result.equivalent());
+    auto const &mismatch = *result.mismatch;
+    EXPECT_EQ(mismatch.port, "sum");
+    EXPECT_EQ(mismatch.cycle, result.cycles);
+    EXPECT_TRUE(mismatch.inputs.at("a") & 0x80);
+    EXPECT_NE(result.to_string().find("on sum"), std::string::npos);
+
+    auto &other = context.generator("other");
+    other.port(PortDirection::In, "a", 8);
+    EXPECT_THROW(check_equivalence(&ref, &other), UserException);
+}
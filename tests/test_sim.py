@@ -55,5 +55,56 @@ def test_expr():
     assert sim.get(b) == 12
 
 
+def test_toggle_activity():
+    mod = Generator("mod")
+    clk = mod.clock("clk")
+    a = mod.input("a", 4)
+    b = mod.var("b", 4)
+
+    @always_ff((posedge, clk))
+    def code():
+        b = a
+
+    mod.add_always(code)
+
+    sim = Simulator(mod)
+    sim.count_toggles()
+    sim.set(clk, 0)
+    for i in range(4):
+        sim.set(a, 0xF if i % 2 else 0)
+        sim.cycle()
+    assert sim.toggle_count(b) == 3 * 4
+    profile = sim.activity_profile()
+    assert profile.cycles == 4
+    assert profile.signals["mod.b"].activity == 3 / 4
+    assert profile.register_groups[0].registers == ["mod.b"]
+
+
+def test_check_equivalence():
+    from kratos.sim import check_equivalence
+
+    def build(name, shift):
+        mod = Generator(name)
+        a = mod.input("a", 8)
+        out = mod.output("out", 8)
+        if shift:
+            mod.wire(out, a << 1)
+        else:
+            mod.wire(out, a + a)
+        return mod
+
+    result = check_equivalence(build("reference", False), build("shift", True), 200)
+    assert result.equivalent()
+    assert result.cycles == 200
+
+    mod = Generator("mod")
+    a = mod.input("a", 8)
+    mod.wire(mod.output("out", 8), a + 1)
+    result = check_equivalence(build("ref2", False), mod)
+    assert not result.equivalent()
+    assert result.mismatch.cycle == result.cycles
+    assert result.mismatch.port == "out"
+
+
 if __name__ == "__main__":
     test_expr()